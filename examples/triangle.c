@@ -6,13 +6,12 @@
 #include "../ggt_gl_utils.h"
 
 float triangle_angle;
+int viewport_width, viewport_height;
 
 GLuint gl_program_id;
-GLuint gl_position_location;
-GLuint gl_color_location;
 
-GLuint gl_buffer_position;
-GLuint gl_buffer_color;
+ggtgl_stream_buffer gl_stream;
+ggtgl_vertex_layout gl_layout;
 
 int ggtp_init(){
 	// Create window
@@ -23,6 +22,8 @@ int ggtp_init(){
     
 	// Inititalize variables
 	triangle_angle = 0.f;
+	viewport_width = 600;
+	viewport_height = 600;
     
 	// Initialize OpenGL
 	const char vertex_shader[] = ""
@@ -44,16 +45,18 @@ int ggtp_init(){
 		"}";
 	
 	gl_program_id = ggtgl_load_shaders_by_text(vertex_shader, fragment_shader);
-	gl_position_location = glGetAttribLocation(gl_program_id, "a_position");
-	gl_color_location = glGetAttribLocation(gl_program_id, "a_color");
-    
-	glUseProgram(gl_program_id);
+	ggtgl_use_program(gl_program_id);
 	
-    glEnableVertexAttribArray(gl_position_location);
-    glEnableVertexAttribArray(gl_color_location);
+	// Room for one frame of positions and colors
+	ggtgl_stream_buffer_create(&gl_stream, GL_ARRAY_BUFFER, 256);
 	
-	glGenBuffers(1, &gl_buffer_position);
-	glGenBuffers(1, &gl_buffer_color);
+	// Positions and colors in separate streams, both pointed at the frame's data
+	ggtgl_vertex_attribute attributes[] = {
+		{"a_position", 0, 4, GL_FLOAT,         GL_FALSE, 0, 0, 0, 0},
+		{"a_color",    1, 4, GL_UNSIGNED_BYTE, GL_TRUE,  0, 0, 0, 0},
+	};
+	GLuint buffers[] = {gl_stream.buffer, gl_stream.buffer};
+	ggtgl_vertex_layout_create(&gl_layout, gl_program_id, attributes, 2, buffers, 0);
     
 	ggtgl_check_error();
     
@@ -67,7 +70,9 @@ int ggtp_loop(ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events events){
 				return GGT_FAILURE;
 			} break;
 			case GGTP_EVENT_RESIZE: {
-				glViewport(0, 0, events.data[i].info.size.x, events.data[i].info.size.y);
+				// Applied in ggtp_draw, ggtp_loop may not own the OpenGL context
+				viewport_width = events.data[i].info.size.x;
+				viewport_height = events.data[i].info.size.y;
 			} break;
 			default: {
 			} break;
@@ -89,25 +94,28 @@ void ggtp_draw(){
 		cos(a1), sin(a1), 0.f, 1.f,
 		cos(a2), sin(a2), 0.f, 1.f,
 	};
-	ggtgl_set_buffer_data(gl_buffer_position, positions, 12, GL_DYNAMIC_DRAW);
+	GLintptr positions_offset = ggtgl_stream_buffer_write(&gl_stream, positions, sizeof(positions));
     
 	GLubyte colors[] = {
 		255,   0,   0, 255,
         0, 255,   0, 255,
         0,   0, 255, 255,
 	};
-	ggtgl_set_buffer_data(gl_buffer_color, colors, 12, GL_DYNAMIC_DRAW);
+	GLintptr colors_offset = ggtgl_stream_buffer_write(&gl_stream, colors, sizeof(colors));
     
 	// Draw them
+	glViewport(0, 0, viewport_width, viewport_height);
 	glClearColor(0.f, 0.f, 0.f, 1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	
-    glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_position);
-    glVertexAttribPointer(gl_position_location, 4, GL_FLOAT,         GL_FALSE, 0, (void *)0);
-    glBindBuffer(GL_ARRAY_BUFFER, gl_buffer_color);
-    glVertexAttribPointer(gl_color_location,    4, GL_UNSIGNED_BYTE, GL_TRUE,  0, (void *)0);
-    
-	glDrawArrays(GL_TRIANGLES, 0, 3);
+	// -1 if the data didn't fit in the frame's region
+	if(positions_offset >= 0 && colors_offset >= 0){
+		ggtgl_vertex_layout_set_stream(&gl_layout, 0, gl_stream.buffer, positions_offset);
+		ggtgl_vertex_layout_set_stream(&gl_layout, 1, gl_stream.buffer, colors_offset);
+		ggtgl_vertex_layout_bind(&gl_layout);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	ggtgl_stream_buffer_end_frame(&gl_stream);
 }
 
 
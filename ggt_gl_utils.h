@@ -5,15 +5,60 @@
 //  - ggtgl_check_error()
 //  - ggtgl_set_buffer_data(GLuint buffer_id, T *vertices, GLuint draw_mode)
 //  - ggtgl_load_texture(GLuint *texture_id, const char *image_path) if
-//    stb_image.h was included before this
+//    stb_image.h was included before this, and ggtgl_load_texture_async,
+//    which decodes on worker threads and uploads a bit every frame
+//  - ggtgl_load_compressed_texture(GLuint *texture_id, const char *path) for
+//    DDS and KTX2 files in BCn, ETC2 or ASTC
 //  - ggtgl_load_shaders_by_text(const char *vertex_shader_text, const char
-//    *fragment_shader_text)
+//    *fragment_shader_text), which keeps the linked programs in a cache
+//    under ggtp_user_file_path when the driver supports program binaries
+//  - ggtgl_load_shaders(const char *file_path) for a file with both stages
+//  - ggtgl_compile_shaders_async and ggtgl_load_shaders_async, to submit many
+//    programs at once and pick them up over the next frames
+//  - ggtgl_has_extension(const char *name) and ggtgl_version()
+//  - ggtgl_use_program, ggtgl_bind_buffer, ggtgl_bind_texture and friends,
+//    which skip the GL call when it wouldn't change anything
+//  - ggtgl_stream_buffer, a ring for vertex/index data that changes every
+//    frame, instead of calling ggtgl_set_buffer_data every frame
+//  - ggtgl_vertex_layout, vertex attributes baked once into a vertex array
+//  - ggtgl_sprite_batch, which draws 2D sprites with one draw call for each
+//    run of them with the same texture and program
+//  - ggtgl_instancing, to draw a mesh many times with a transform and color
+//    per instance in one instanced draw call (or a few, from uniform arrays,
+//    without instanced arrays)
+//  - ggtgl_atlas, which packs images (glyphs, sprites...) into one texture, or
+//    a texture array when they don't fit
 //
 // Usage:
 //  - To compile this, #define GGT_GL_IMPLEMENTATION and #include the header
 //
 // Options:
 //  - GGTGL_MAX_INFO_LOG_LENGTH for the maximum length of shader error info logs
+//  - GGTGL_MAX_TEXTURE_UNITS for the texture units the state cache tracks (16
+//    by default)
+//  - GGTGL_MAX_VERTEX_ATTRIBUTES and GGTGL_MAX_VERTEX_STREAMS for the size of
+//    a ggtgl_vertex_layout (16 and 4 by default)
+//  - GGTGL_NO_PROGRAM_CACHE to always compile shaders from their text
+//  - GGTGL_MAX_SHADERS for the most async shader handles alive at once (256
+//    by default), and GGTGL_SHADERS_PER_UPDATE for how many programs
+//    ggtgl_update_shaders may block on without GL_KHR_parallel_shader_compile
+//    (4 by default)
+//  - GGTGL_INSTANCE_BATCH for the instances per draw call without instanced
+//    arrays (16 by default) and GGTGL_INSTANCE_MESHES for the meshes an
+//    instancing keeps the instance ids of then (8 by default)
+//  - GGTGL_ATLAS_MAX_RECTS for the free and used rectangles an atlas layer
+//    keeps track of (4096 of each by default)
+//  - GGTGL_SPRITE_BATCH_SIZE for the most sprites in one draw call (4096 by
+//    default, at most 16384) and GGTGL_SPRITE_PROGRAMS for the programs a
+//    sprite batch keeps the attribute locations of (4 by default)
+//  - GGTGL_STREAM_REGIONS, the frames a stream buffer can be ahead of the GPU
+//    (3 by default), and GGTGL_STREAM_ALIGNMENT for the alignment of what
+//    is written to it (16 by default)
+//  - GGTGL_TEXTURE_THREADS for the threads that decode async textures (2 by
+//    default), GGTGL_TEXTURE_UPLOAD_SIZE for the bytes uploaded per frame
+//    (4MB by default), GGTGL_MAX_TEXTURE_LOADS for the most async textures
+//    in flight (256 by default) and GGTGL_TEXTURE_PLACEHOLDER for the RGBA
+//    color they have until then (0xFF808080 by default)
 //
 
 
@@ -26,17 +71,424 @@ void _ggtgl_check_error(int line, const char *file);
 void _ggtgl_set_buffer_data(GLuint buffer, void *vert, unsigned int size, GLuint mode);
 #define ggtgl_set_buffer_data(b, v, s, t) _ggtgl_set_buffer_data(b, v, s*sizeof(v[0]), t)
 
+#ifndef GGTGL_MAX_TEXTURE_UNITS
+#define GGTGL_MAX_TEXTURE_UNITS 16
+#endif
+
+// Shadow of the GL state of the main context. The functions below only call
+// GL when the value changes. Everything starts unknown, and ggtgl_reset_state
+// makes it unknown again, which is needed after changing any of it with GL
+// calls directly. The functions in this header keep it up to date, and the
+// ones that upload data or point attributes at a buffer always bind, so
+// they never write to the wrong object when the cache is stale
+typedef struct {
+    GLuint program;
+    GLuint vertex_array;
+    GLuint array_buffer, element_array_buffer, pixel_unpack_buffer;
+    GLuint active_texture; // Unit index
+    GLuint textures[GGTGL_MAX_TEXTURE_UNITS]; // GL_TEXTURE_2D of each unit
+    unsigned int attribs, attribs_known; // A bit per vertex attribute array, enabled or not
+    int blend, depth_test, depth_write;
+    GLenum blend_source, blend_destination, depth_function;
+    
+    // Calls made and skipped since the last ggtgl_reset_state_counters
+    unsigned int calls, skipped;
+} ggtgl_state;
+
+const ggtgl_state *ggtgl_get_state(void);
+void ggtgl_reset_state(void);
+void ggtgl_reset_state_counters(void);
+
+void ggtgl_use_program(GLuint program);
+void ggtgl_bind_vertex_array(GLuint vertex_array);
+// Other targets than GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER and
+// GL_PIXEL_UNPACK_BUFFER are passed on
+void ggtgl_bind_buffer(GLenum target, GLuint buffer);
+// Other targets than GL_TEXTURE_2D are passed on (after the unit is made active)
+void ggtgl_bind_texture(GLuint unit, GLenum target, GLuint texture);
+void ggtgl_enable_attrib(GLuint index);
+void ggtgl_disable_attrib(GLuint index);
+// source and destination are only set while enabled
+void ggtgl_set_blend(int enabled, GLenum source, GLenum destination);
+void ggtgl_set_depth(int test, int write, GLenum function);
+
+// file_path is found with ggtp_program_file_path. The file has both stages,
+// each after a "#vertex" or "#fragment" line, and anything before the first
+// one (e.g. #version) goes in both. '#include "name"' lines are replaced by
+// the named file, relative to the one including it. Compile errors keep
+// the file's line numbers (those in included files count from their start)
 GLuint ggtgl_load_shaders(const char *file_path);
 GLuint ggtgl_load_shaders_by_text(const char *vertex_text, const char *fragment_text);
 
+// Async programs. The compile and link are submitted right away and only
+// checked in ggtgl_update_shaders, so the driver can build many of them in
+// parallel. Handles are 0 when there are GGTGL_MAX_SHADERS alive
+typedef unsigned int ggtgl_shader;
+typedef enum {
+    GGTGL_SHADER_PENDING,
+    GGTGL_SHADER_READY,
+    GGTGL_SHADER_FAILED,
+} ggtgl_shader_status;
+
+ggtgl_shader ggtgl_compile_shaders_async(const char *vertex_text, const char *fragment_text);
+ggtgl_shader ggtgl_load_shaders_async(const char *file_path);
+// Call once per frame. Picks up the programs the driver is done with
+void ggtgl_update_shaders(void);
+// Blocks until every submitted program is done, e.g. when a loading screen ends
+void ggtgl_finish_shaders(void);
+ggtgl_shader_status ggtgl_shader_get_status(ggtgl_shader shader);
+// 0 until the shader is GGTGL_SHADER_READY
+GLuint ggtgl_shader_program(ggtgl_shader shader);
+// Deletes the program and frees the handle
+void ggtgl_free_shader(ggtgl_shader shader);
+
 #ifdef STBI_INCLUDE_STB_IMAGE_H
+// RGBA with mipmaps, flipped so the first row is the bottom one. .dds and
+// .ktx2 files are loaded as in ggtgl_load_compressed_texture
 void ggtgl_load_texture(GLuint *texture, const char *path);
 #endif
 
+// A 2D DDS or KTX2 file with the mipmaps it has, in the GPU format it was
+// stored in (BC1-7, ETC2/EAC, ASTC or RGBA8) and with its rows as they are,
+// so export them bottom row first. When the driver can't sample the format,
+// BC1-5 are decoded to RGBA instead. Supercompressed KTX2 isn't supported
+int ggtgl_load_compressed_texture(GLuint *texture, const char *path);
+int ggtgl_supports_compressed_format(GLenum format);
+
+// Returns the texture right away, with a 1x1 placeholder color. The image is
+// decoded on worker threads and ggtgl_update_textures uploads it through a
+// ring of pixel unpack buffers, smallest mipmap first, so it sharpens over
+// the next frames (without them, e.g. WebGL 1, one whole texture per frame).
+// Takes the files ggtgl_load_texture does, but only .dds and .ktx2 without
+// stb_image.h. 0 if there are GGTGL_MAX_TEXTURE_LOADS in flight
+GLuint ggtgl_load_texture_async(const char *path);
+// Call once per frame, before drawing
+void ggtgl_update_textures(void);
+// How many async textures are still decoding or uploading, e.g. for a loading screen
+int ggtgl_textures_loading(void);
+// Joins the decoding threads and frees what they use. Loads still in flight
+// keep their placeholder. Call before the context goes away
+void ggtgl_stop_texture_loads(void);
+
 #ifdef __EMSCRIPTEN__
 #define GGTGL_OPENGL_ES 1
 #endif
 
+int ggtgl_has_extension(const char *name);
+// major * 10 + minor, e.g. 33 for 3.3 (or OpenGL ES 3.0 for 30)
+int ggtgl_version(void);
+
+#ifndef GGTGL_STREAM_REGIONS
+#define GGTGL_STREAM_REGIONS 3
+#endif
+
+typedef enum {
+    GGTGL_STREAM_PERSISTENT,     // glBufferStorage, mapped once (GL 4.4 or ARB_buffer_storage)
+    GGTGL_STREAM_UNSYNCHRONIZED, // glMapBufferRange without implicit syncs (GL 3.0 or ARB_map_buffer_range)
+    GGTGL_STREAM_SUBDATA,        // glBufferSubData, for GLES and WebGL
+} ggtgl_stream_backend;
+
+// One buffer split in GGTGL_STREAM_REGIONS regions of frame_size bytes.
+// Every frame writes to the next region, after waiting on the fence of the
+// frame that last used it (which has normally signaled long before)
+typedef struct {
+    GLuint buffer;
+    GLenum target;
+    ggtgl_stream_backend backend;
+    GLsizeiptr frame_size;
+    GLsizeiptr offset; // In the current region
+    unsigned int region;
+    int region_ready;
+    int fenced;
+    unsigned char *mapping; // The whole buffer, for GGTGL_STREAM_PERSISTENT
+    GLsync fences[GGTGL_STREAM_REGIONS];
+} ggtgl_stream_buffer;
+
+// target is e.g. GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER. Picks the best
+// backend the context supports
+int ggtgl_stream_buffer_create(ggtgl_stream_buffer *stream, GLenum target, GLsizeiptr frame_size);
+void ggtgl_stream_buffer_destroy(ggtgl_stream_buffer *stream);
+// Copies the data into this frame's region and leaves the buffer bound to
+// the target. Returns the offset to use in glVertexAttribPointer or
+// glDrawElements, or -1 if this frame's region is full
+GLintptr ggtgl_stream_buffer_write(ggtgl_stream_buffer *stream, const void *data, GLsizeiptr size);
+// Call after the last draw of the frame that uses the buffer
+void ggtgl_stream_buffer_end_frame(ggtgl_stream_buffer *stream);
+
+#ifndef GGTGL_MAX_VERTEX_ATTRIBUTES
+#define GGTGL_MAX_VERTEX_ATTRIBUTES 16
+#endif
+
+#ifndef GGTGL_MAX_VERTEX_STREAMS
+#define GGTGL_MAX_VERTEX_STREAMS 4
+#endif
+
+// Attributes in the same stream share a buffer, e.g. interleaved with the
+// vertex size as stride. divisor is 0 for per vertex data, or the instances
+// that share each value. integer attributes (GL 3.0, GLES 3.0) reach the
+// shader as ints (int, ivec, uint, uvec) instead of being turned into
+// floats, and ignore normalized
+typedef struct {
+    const char *name;
+    unsigned int stream;
+    GLint size; // Components, 1 to 4
+    GLenum type;
+    GLboolean normalized;
+    GLsizei stride;
+    size_t offset;
+    GLuint divisor;
+    int integer;
+} ggtgl_vertex_attribute;
+
+typedef struct {
+    struct {
+        GLuint location;
+        unsigned int stream;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        GLsizei stride;
+        size_t offset;
+        GLuint divisor;
+        int integer;
+    } attributes[GGTGL_MAX_VERTEX_ATTRIBUTES];
+    int attribute_count;
+    GLuint buffers[GGTGL_MAX_VERTEX_STREAMS];
+    GLintptr stream_offsets[GGTGL_MAX_VERTEX_STREAMS];
+    GLuint index_buffer;
+    GLuint vertex_array; // 0 without vertex arrays (GL 2.1, WebGL 1)
+    int dirty;
+} ggtgl_vertex_layout;
+
+// Finds the attributes in program and bakes them with the buffers (one per
+// stream, 0 for the ones set later with ggtgl_vertex_layout_set_stream) and
+// index_buffer (or 0) into a vertex array. Attributes the program doesn't
+// use are left out. The vertex array bound before is bound again after
+int ggtgl_vertex_layout_create(ggtgl_vertex_layout *layout, GLuint program, const ggtgl_vertex_attribute *attributes,
+                               int attribute_count, const GLuint *buffers, GLuint index_buffer);
+void ggtgl_vertex_layout_destroy(ggtgl_vertex_layout *layout);
+// Points a stream somewhere else, e.g. to this frame's data in a
+// ggtgl_stream_buffer. offset is added to its attributes' offsets. Leaves
+// the vertex array that was bound bound
+void ggtgl_vertex_layout_set_stream(ggtgl_vertex_layout *layout, unsigned int stream, GLuint buffer, GLintptr offset);
+// Binds the vertex array. Without them, sets up the attribute pointers,
+// unless the layout is still set up from the last call
+void ggtgl_vertex_layout_bind(ggtgl_vertex_layout *layout);
+
+#ifndef GGTGL_SPRITE_BATCH_SIZE
+#define GGTGL_SPRITE_BATCH_SIZE 4096
+#endif
+
+#ifndef GGTGL_SPRITE_PROGRAMS
+#define GGTGL_SPRITE_PROGRAMS 4
+#endif
+
+typedef struct {
+    float x, y; // Center, in pixels from the top left
+    float width, height;
+    float rotation; // Radians, clockwise on screen
+    float u0, v0, u1, v1;
+    ggt_u32 color; // Multiplies the texture, 0xAABBGGRR
+} ggtgl_sprite;
+
+typedef struct {
+    float x, y, u, v;
+    ggt_u32 color;
+} ggtgl_sprite_vertex;
+
+typedef struct {
+    ggtgl_stream_buffer vertices;
+    GLuint indices;
+    GLuint default_program;
+    struct {
+        GLuint program;
+        GLint projection_location;
+        unsigned int projection_frame;
+        ggtgl_vertex_layout layout;
+    } programs[GGTGL_SPRITE_PROGRAMS];
+    int next_program;
+    
+    ggtgl_sprite_vertex vertices_data[GGTGL_SPRITE_BATCH_SIZE * 4];
+    int count;
+    GLuint program, texture;
+    float projection[16];
+    unsigned int frame;
+    
+    // Of the last frame
+    unsigned int draw_calls, sprites;
+} ggtgl_sprite_batch;
+
+// max_sprites is the most sprites drawn in a frame. The batch is big, so it's
+// better not on the stack
+int ggtgl_sprite_batch_create(ggtgl_sprite_batch *batch, int max_sprites);
+void ggtgl_sprite_batch_destroy(ggtgl_sprite_batch *batch);
+// Starts a frame drawn on a width x height pixels viewport
+void ggtgl_sprite_batch_begin(ggtgl_sprite_batch *batch, int width, int height);
+// Draws the sprites after this with program, or the default one for 0. It
+// needs a_position, a_uv and a_color attributes and u_projection and
+// u_texture uniforms like the default one
+void ggtgl_sprite_batch_set_program(ggtgl_sprite_batch *batch, GLuint program);
+void ggtgl_sprite_batch_draw(ggtgl_sprite_batch *batch, GLuint texture, const ggtgl_sprite *sprite);
+// Draws what is left and ends the frame
+void ggtgl_sprite_batch_end(ggtgl_sprite_batch *batch);
+
+#ifdef GGT_MATH_H
+inline void ggtgl_sprite_batch_draw(ggtgl_sprite_batch *batch, GLuint texture, Vec2 position, Vec2 size, float rotation = 0.f,
+                                    Vec2 uv0 = Vec2(0.f), Vec2 uv1 = Vec2(1.f), ggt_u32 color = 0xFFFFFFFF){
+    ggtgl_sprite sprite = {position.x, position.y, size.x, size.y, rotation, uv0.x, uv0.y, uv1.x, uv1.y, color};
+    ggtgl_sprite_batch_draw(batch, texture, &sprite);
+}
+#endif
+
+#ifndef GGTGL_INSTANCE_BATCH
+#define GGTGL_INSTANCE_BATCH 16
+#endif
+#ifndef GGTGL_INSTANCE_MESHES
+#define GGTGL_INSTANCE_MESHES 8
+#endif
+
+// The vertex shader gets the instance from ggtgl_instance_transform(), a
+// mat4, and ggtgl_instance_color(), a vec4 from an RGBA color (0xAABBGGRR),
+// declared by the text of ggtgl_instancing_glsl put after its #version.
+// With instanced arrays they read these attributes:
+//  - a_instance_transform0 to a_instance_transform3, vec4 columns of the
+//    transform for GGTGL_INSTANCE_MAT4
+//  - a_instance_transform0 to a_instance_transform2, vec4 rows of the top of
+//    the transform for GGTGL_INSTANCE_MAT3X4
+//  - a_instance_color
+// Without them (GL 2.1, WebGL 1), GGTGL_INSTANCE_BATCH instances are drawn
+// at a time from the uniform arrays u_instance_transforms and
+// u_instance_colors, indexed by the a_instance_id attribute. That is one
+// vec4 per instance and row or column, so lower it for shaders with many
+// uniforms of their own (GLES 2 only has 128 vec4s for sure)
+typedef enum {
+    GGTGL_INSTANCE_MAT4, // 16 floats, column major like Mat4
+    GGTGL_INSTANCE_MAT3X4, // 12 floats, the first 3 rows
+} ggtgl_instance_format;
+
+typedef struct {
+    ggtgl_stream_buffer data;
+    ggtgl_instance_format format;
+    int max_instances;
+    int instanced;
+    ggt_u32 *white; // Colors for draws without any
+    float *rows; // Mat4 transforms turned into rows, for GGTGL_INSTANCE_MAT3X4
+    
+    // Without instanced arrays, the uniforms of the last program drawn with
+    // and the instance of each vertex of the meshes
+    GLuint program;
+    GLint transforms_location, colors_location;
+    struct {
+        GLuint buffer;
+        int vertices;
+    } ids[GGTGL_INSTANCE_MESHES];
+    
+    // Since the last ggtgl_instancing_end_frame
+    unsigned int draw_calls, instances;
+} ggtgl_instancing;
+
+// max_instances is the most instances drawn in a frame
+int ggtgl_instancing_create(ggtgl_instancing *instancing, ggtgl_instance_format format, int max_instances);
+void ggtgl_instancing_destroy(ggtgl_instancing *instancing);
+const char *ggtgl_instancing_glsl(const ggtgl_instancing *instancing);
+// How many times the mesh has to be in its buffers, one copy after the
+// other (and its indices too, each copy's offset by the vertices of one):
+// 1 with instanced arrays, GGTGL_INSTANCE_BATCH without. The copies are
+// drawn as one range then, so a draw has to start at the first copy (at
+// vertex 0 for ggtgl_instancing_draw_arrays) and count is for one copy
+int ggtgl_instancing_batch(const ggtgl_instancing *instancing);
+// Fills attributes (up to 5) with the per instance attributes, to add to the
+// ones of the mesh when creating its ggtgl_vertex_layout. They use stream
+// (and stream + 1 for the colors). Returns how many there are
+int ggtgl_instancing_attributes(const ggtgl_instancing *instancing, unsigned int stream, ggtgl_vertex_attribute *attributes);
+// The buffer to create the layout with for stream, for a mesh with vertices
+// vertices in each copy. 0 with instanced arrays, where it is set when
+// drawing. The instancing keeps GGTGL_INSTANCE_MESHES of them
+GLuint ggtgl_instancing_ids(ggtgl_instancing *instancing, int vertices);
+// Draws instance_count instances of the layout's mesh with the program bound
+// with ggtgl_use_program. stream is the one given to ggtgl_instancing_attributes
+// and colors may be NULL for white
+void ggtgl_instancing_draw_arrays(ggtgl_instancing *instancing, ggtgl_vertex_layout *layout, unsigned int stream,
+                                  const float *transforms, const ggt_u32 *colors, int instance_count,
+                                  GLenum mode, GLint first, GLsizei count);
+void ggtgl_instancing_draw_elements(ggtgl_instancing *instancing, ggtgl_vertex_layout *layout, unsigned int stream,
+                                    const float *transforms, const ggt_u32 *colors, int instance_count,
+                                    GLenum mode, GLsizei count, GLenum type, GLintptr offset);
+void ggtgl_instancing_end_frame(ggtgl_instancing *instancing);
+// Mat4s (16 floats each) in the instancing's format, NULL if there are more
+// than max_instances
+const float *_ggtgl_instancing_transforms(ggtgl_instancing *instancing, const float *matrices, int instance_count);
+
+#ifdef GGT_MATH_H
+inline void ggtgl_instancing_draw_arrays(ggtgl_instancing *instancing, ggtgl_vertex_layout *layout, unsigned int stream,
+                                         const Mat4 *transforms, const ggt_u32 *colors, int instance_count,
+                                         GLenum mode, GLint first, GLsizei count){
+    const float *values = _ggtgl_instancing_transforms(instancing, &transforms[0].values[0][0], instance_count);
+    if(values)
+        ggtgl_instancing_draw_arrays(instancing, layout, stream, values, colors, instance_count, mode, first, count);
+}
+inline void ggtgl_instancing_draw_elements(ggtgl_instancing *instancing, ggtgl_vertex_layout *layout, unsigned int stream,
+                                           const Mat4 *transforms, const ggt_u32 *colors, int instance_count,
+                                           GLenum mode, GLsizei count, GLenum type, GLintptr offset){
+    const float *values = _ggtgl_instancing_transforms(instancing, &transforms[0].values[0][0], instance_count);
+    if(values)
+        ggtgl_instancing_draw_elements(instancing, layout, stream, values, colors, instance_count, mode, count, type, offset);
+}
+#endif
+
+#ifndef GGTGL_ATLAS_MAX_RECTS
+#define GGTGL_ATLAS_MAX_RECTS 4096
+#endif
+
+typedef struct {
+    int x, y, width, height;
+} ggtgl_atlas_rect;
+
+typedef struct {
+    int x, y, width, height; // In pixels
+    int layer; // Always 0 for GL_TEXTURE_2D
+    float u0, v0, u1, v1; // v0 is the top
+} ggtgl_atlas_entry;
+
+typedef struct {
+    ggtgl_atlas_rect free_rects[GGTGL_ATLAS_MAX_RECTS]; // Can overlap each other
+    ggtgl_atlas_rect used_rects[GGTGL_ATLAS_MAX_RECTS]; // With padding
+    int free_count, used_count;
+    int removed; // Since the free rectangles were last rebuilt from the used ones
+    unsigned char *pixels; // RGBA copy of the layer
+    ggtgl_atlas_rect dirty; // What ggtgl_atlas_update uploads, empty when width is 0
+} ggtgl_atlas_layer;
+
+typedef struct {
+    GLuint texture;
+    GLenum target; // GL_TEXTURE_2D, or GL_TEXTURE_2D_ARRAY with max_layers > 1
+    int width, height, padding;
+    int layer_count, max_layers, texture_layers;
+    ggtgl_atlas_layer *layers;
+} ggtgl_atlas;
+
+// Images are kept padding pixels apart, so filtering doesn't bleed between
+// them. With max_layers > 1 the texture is a GL_TEXTURE_2D_ARRAY that gets
+// another layer when an image doesn't fit the ones it has. Without texture
+// arrays (GL 2.1, WebGL 1) it's one GL_TEXTURE_2D
+int ggtgl_atlas_create(ggtgl_atlas *atlas, int width, int height, int padding, int max_layers);
+void ggtgl_atlas_destroy(ggtgl_atlas *atlas);
+// Finds room for an RGBA image with top to bottom rows. It's only copied,
+// and uploaded with the rest of the changes in ggtgl_atlas_update. Fails
+// right away for images bigger than an empty layer
+int ggtgl_atlas_insert(ggtgl_atlas *atlas, int width, int height, const void *pixels, ggtgl_atlas_entry *entry);
+// Does nothing for an entry that isn't in the atlas (anymore)
+void ggtgl_atlas_remove(ggtgl_atlas *atlas, const ggtgl_atlas_entry *entry);
+// Uploads the parts of each layer that changed. Call before drawing with it.
+// Both functions leave the texture that was bound bound
+void ggtgl_atlas_update(ggtgl_atlas *atlas);
+
+#ifdef GGT_MATH_H
+inline int ggtgl_atlas_insert(ggtgl_atlas *atlas, Vec2i size, const void *pixels, ggtgl_atlas_entry *entry){
+    return ggtgl_atlas_insert(atlas, size.x, size.y, pixels, entry);
+}
+#endif
+
 #endif
 
 #ifdef GGT_GL_IMPLEMENTATION
@@ -84,8 +536,212 @@ void _ggtgl_check_error(int line, const char *file){
     }
 }
 
+// Drops the errors raised so far, so that glGetError only reports new ones.
+// Bounded, as a lost context may keep reporting one
+void _ggtgl_clear_errors(void){
+    for(int i = 0; i < 32 && glGetError() != GL_NO_ERROR; i++);
+}
+
+#define _GGTGL_UNKNOWN 0xFFFFFFFF
+
+ggtgl_state _ggtgl_state;
+int _ggtgl_state_known;
+// The last layout set up without a vertex array, which is still in place
+ggtgl_vertex_layout *_ggtgl_current_layout;
+
+const ggtgl_state *ggtgl_get_state(void){
+    return &_ggtgl_state;
+}
+
+void ggtgl_reset_state(void){
+    unsigned int calls = _ggtgl_state.calls, skipped = _ggtgl_state.skipped;
+    memset(&_ggtgl_state, 0xFF, sizeof(ggtgl_state));
+    _ggtgl_state.attribs = _ggtgl_state.attribs_known = 0;
+    _ggtgl_state.calls = calls;
+    _ggtgl_state.skipped = skipped;
+    _ggtgl_state_known = 1;
+    _ggtgl_current_layout = NULL;
+}
+
+void ggtgl_reset_state_counters(void){
+    _ggtgl_state.calls = _ggtgl_state.skipped = 0;
+}
+
+// Returns 1 if value changed (and updates it), so the GL call is needed
+int _ggtgl_state_changed(GLuint *cached, GLuint value){
+    if(!_ggtgl_state_known)
+        ggtgl_reset_state();
+    if(*cached == value){
+        _ggtgl_state.skipped++;
+        return 0;
+    }
+    *cached = value;
+    _ggtgl_state.calls++;
+    return 1;
+}
+
+void ggtgl_use_program(GLuint program){
+    if(_ggtgl_state_changed(&_ggtgl_state.program, program))
+        glUseProgram(program);
+}
+
+void ggtgl_bind_vertex_array(GLuint vertex_array){
+    if(_ggtgl_state_changed(&_ggtgl_state.vertex_array, vertex_array)){
+        glBindVertexArray(vertex_array);
+        // These belong to the vertex array
+        _ggtgl_state.element_array_buffer = _GGTGL_UNKNOWN;
+        _ggtgl_state.attribs_known = 0;
+    }
+}
+
+// For the helpers that change a vertex array: binds even if the cache says
+// it is bound, and leaves the cache right
+void _ggtgl_bind_vertex_array_now(GLuint vertex_array){
+    if(!_ggtgl_state_known)
+        ggtgl_reset_state();
+    _ggtgl_state.vertex_array = vertex_array;
+    _ggtgl_state.element_array_buffer = _GGTGL_UNKNOWN;
+    _ggtgl_state.attribs_known = 0;
+    _ggtgl_state.calls++;
+    glBindVertexArray(vertex_array);
+}
+
+// Asked to GL, so that it is put back as it really was
+GLuint _ggtgl_bound_vertex_array(void){
+    GLint vertex_array = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertex_array);
+    return (GLuint)vertex_array;
+}
+
+GLuint *_ggtgl_cached_buffer(GLenum target){
+    switch(target){
+        case GL_ARRAY_BUFFER: return &_ggtgl_state.array_buffer;
+        case GL_ELEMENT_ARRAY_BUFFER: return &_ggtgl_state.element_array_buffer;
+        case GL_PIXEL_UNPACK_BUFFER: return &_ggtgl_state.pixel_unpack_buffer;
+        default: return NULL;
+    }
+}
+
+void ggtgl_bind_buffer(GLenum target, GLuint buffer){
+    GLuint *cached = _ggtgl_cached_buffer(target);
+    if(!cached){
+        _ggtgl_state.calls++;
+        glBindBuffer(target, buffer);
+    }else if(_ggtgl_state_changed(cached, buffer)){
+        glBindBuffer(target, buffer);
+    }
+}
+
+// For the helpers that upload to the buffer or point at it: binds even if
+// the cache says it is bound, and leaves the cache right
+void _ggtgl_bind_buffer_now(GLenum target, GLuint buffer){
+    if(!_ggtgl_state_known)
+        ggtgl_reset_state();
+    GLuint *cached = _ggtgl_cached_buffer(target);
+    if(cached)
+        *cached = buffer;
+    _ggtgl_state.calls++;
+    glBindBuffer(target, buffer);
+}
+
+// Deleting a bound buffer unbinds it
+void _ggtgl_state_delete_buffer(GLuint buffer){
+    if(_ggtgl_state.array_buffer == buffer)
+        _ggtgl_state.array_buffer = 0;
+    if(_ggtgl_state.element_array_buffer == buffer)
+        _ggtgl_state.element_array_buffer = 0;
+    if(_ggtgl_state.pixel_unpack_buffer == buffer)
+        _ggtgl_state.pixel_unpack_buffer = 0;
+}
+
+void ggtgl_bind_texture(GLuint unit, GLenum target, GLuint texture){
+    if(_ggtgl_state_changed(&_ggtgl_state.active_texture, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    if(target != GL_TEXTURE_2D || unit >= GGTGL_MAX_TEXTURE_UNITS){
+        _ggtgl_state.calls++;
+        glBindTexture(target, texture);
+    }else if(_ggtgl_state_changed(&_ggtgl_state.textures[unit], texture)){
+        glBindTexture(target, texture);
+    }
+}
+
+// On whatever unit is active, for the texture loading functions. Always
+// binds, as they upload to it
+void _ggtgl_bind_texture_2d(GLuint texture){
+    GLuint unit = _ggtgl_state.active_texture;
+    if(_ggtgl_state_known && unit < GGTGL_MAX_TEXTURE_UNITS)
+        _ggtgl_state.textures[unit] = texture;
+    else if(_ggtgl_state_known)
+        memset(_ggtgl_state.textures, 0xFF, sizeof(_ggtgl_state.textures)); // Don't know the unit
+    _ggtgl_state.calls++;
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+// Of the active unit, asked to GL so that it is put back as it really was
+GLuint _ggtgl_bound_texture_2d(void){
+    GLint texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    return (GLuint)texture;
+}
+
+void _ggtgl_set_attrib(GLuint index, int enabled){
+    if(!_ggtgl_state_known)
+        ggtgl_reset_state();
+    unsigned int bit = (index < 32) ? (1u << index) : 0;
+    if(bit && (_ggtgl_state.attribs_known & bit) && !!(_ggtgl_state.attribs & bit) == enabled){
+        _ggtgl_state.skipped++;
+        return;
+    }
+    _ggtgl_state.calls++;
+    _ggtgl_state.attribs_known |= bit;
+    if(enabled){
+        _ggtgl_state.attribs |= bit;
+        glEnableVertexAttribArray(index);
+    }else{
+        _ggtgl_state.attribs &= ~bit;
+        glDisableVertexAttribArray(index);
+    }
+}
+
+void ggtgl_enable_attrib(GLuint index){
+    _ggtgl_set_attrib(index, 1);
+}
+
+void ggtgl_disable_attrib(GLuint index){
+    _ggtgl_set_attrib(index, 0);
+}
+
+void _ggtgl_set_capability(GLenum capability, int *cached, int enabled){
+    if(_ggtgl_state_changed((GLuint *)cached, (GLuint)(enabled != 0))){
+        if(enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+}
+
+void ggtgl_set_blend(int enabled, GLenum source, GLenum destination){
+    _ggtgl_set_capability(GL_BLEND, &_ggtgl_state.blend, enabled);
+    if(enabled && (source != _ggtgl_state.blend_source || destination != _ggtgl_state.blend_destination)){
+        _ggtgl_state.blend_source = source;
+        _ggtgl_state.blend_destination = destination;
+        _ggtgl_state.calls++;
+        glBlendFunc(source, destination);
+    }else if(enabled){
+        _ggtgl_state.skipped++;
+    }
+}
+
+void ggtgl_set_depth(int test, int write, GLenum function){
+    _ggtgl_set_capability(GL_DEPTH_TEST, &_ggtgl_state.depth_test, test);
+    if(_ggtgl_state_changed((GLuint *)&_ggtgl_state.depth_write, (GLuint)(write != 0)))
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    if(test && _ggtgl_state_changed(&_ggtgl_state.depth_function, function))
+        glDepthFunc(function);
+}
+
 void _ggtgl_set_buffer_data(GLuint buffer, void *vert, unsigned int size, GLuint mode){
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    _ggtgl_bind_buffer_now(GL_ARRAY_BUFFER, buffer);
     glBufferData(GL_ARRAY_BUFFER, size, vert, mode);
 }
 
@@ -93,104 +749,2597 @@ void _ggtgl_set_buffer_data(GLuint buffer, void *vert, unsigned int size, GLuint
 #define GGTGL_MAX_INFO_LOG_LENGTH 400
 #endif
 
-GLuint ggtgl_load_shaders_by_text(const char *vertex_text, const char *fragment_text){
-    char error_message[GGTGL_MAX_INFO_LOG_LENGTH];
+// Compiles and links without checking anything in between, so the driver
+// can do it in the background. shaders gets the ids for _ggtgl_finish_program
+GLuint _ggtgl_start_program(const char *vertex_text, const char *fragment_text, int retrievable, GLuint shaders[2]){
+    shaders[0] = glCreateShader(GL_VERTEX_SHADER);
+    shaders[1] = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(shaders[0], 1, &vertex_text, NULL);
+    glCompileShader(shaders[0]);
+    glShaderSource(shaders[1], 1, &fragment_text, NULL);
+    glCompileShader(shaders[1]);
     
-    // Create the shaders
-    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    GLuint program_id = glCreateProgram();
+    glAttachShader(program_id, shaders[0]);
+    glAttachShader(program_id, shaders[1]);
+#ifdef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    if(retrievable)
+        glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+    glLinkProgram(program_id);
+    return program_id;
+}
+
+// Waits for the driver if it isn't done yet, prints the errors and deletes
+// the shaders. Returns GL_TRUE if the program linked
+GLint _ggtgl_finish_program(GLuint program_id, GLuint shaders[2]){
+    char error_message[GGTGL_MAX_INFO_LOG_LENGTH];
+    const char *stages[2] = {"vertex", "fragment"};
     
     GLint result = GL_FALSE;
     GLsizei info_log_length = 0;
     
-    // Compile Vertex Shader
-    glShaderSource(vertex_shader_id, 1, &vertex_text, NULL);
-    glCompileShader(vertex_shader_id);
-    
-    // Check Fragment Shader
-    glGetShaderiv(vertex_shader_id, GL_COMPILE_STATUS, &result);
+    glGetProgramiv(program_id, GL_LINK_STATUS, &result);
     if(result == GL_FALSE){
-        glGetShaderiv(vertex_shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
+        // Check the shaders first, their logs say more than the link one
+        for(int i = 0; i < 2; i++){
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+            if(compiled == GL_FALSE){
+                glGetShaderiv(shaders[i], GL_INFO_LOG_LENGTH, &info_log_length);
+                if(info_log_length > 0){
+                    if(info_log_length > GGTGL_MAX_INFO_LOG_LENGTH)
+                        info_log_length = GGTGL_MAX_INFO_LOG_LENGTH;
+                    glGetShaderInfoLog(shaders[i], info_log_length, NULL, error_message);
+                    printf("Couldn't compile %s shader:\n%s\n\n", stages[i], error_message);
+                }
+            }
+        }
+        
+        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_log_length);
         if(info_log_length > 0){
             if(info_log_length > GGTGL_MAX_INFO_LOG_LENGTH)
                 info_log_length = GGTGL_MAX_INFO_LOG_LENGTH;
-            glGetShaderInfoLog(vertex_shader_id, info_log_length, NULL, error_message);
-            printf("Couldn't compile vertex shader:\n%s\n\n", error_message);
+            glGetProgramInfoLog(program_id, info_log_length, NULL, error_message);
+            printf("Couldn't link shader:\n%s\n\n", error_message);
+            glValidateProgram(program_id);
         }
     }
     
-    // Compile Fragment Shader
-    glShaderSource(fragment_shader_id, 1, &fragment_text , NULL);
-    glCompileShader(fragment_shader_id);
+    for(int i = 0; i < 2; i++){
+        glDetachShader(program_id, shaders[i]);
+        glDeleteShader(shaders[i]);
+    }
+    return result;
+}
+
+GLuint _ggtgl_compile_program(const char *vertex_text, const char *fragment_text, int retrievable){
+    GLuint shaders[2];
+    GLuint program_id = _ggtgl_start_program(vertex_text, fragment_text, retrievable, shaders);
+    _ggtgl_finish_program(program_id, shaders);
+    return program_id;
+}
+
+#if !defined(GGTGL_NO_PROGRAM_CACHE) && (defined(GGTGL_OPENGL_ES) || !defined(GL_PROGRAM_BINARY_LENGTH))
+#define GGTGL_NO_PROGRAM_CACHE // WebGL has no program binaries
+#endif
+
+#ifndef GGTGL_NO_PROGRAM_CACHE
+
+#define GGTGL_PROGRAM_CACHE_MAGIC 0x42544747 // 'GGTB'
+
+typedef struct {
+    ggt_u32 magic;
+    GLenum format;
+    ggt_u64 key; // Again, in case two keys end up with the same file name
+    ggt_u32 size;
+} _ggtgl_program_cache_header;
+
+// FNV-1a, continued from hash
+ggt_u64 _ggtgl_hash_text(ggt_u64 hash, const char *text){
+    if(text)
+        for(; *text; text++)
+            hash = (hash ^ (ggt_u8)*text) * 1099511628211ull;
+    return (hash ^ 0xFF) * 1099511628211ull; // Separates "ab" + "c" from "a" + "bc"
+}
+
+// 0 if the driver can't give out program binaries
+ggt_u64 _ggtgl_program_cache_key(const char *vertex_text, const char *fragment_text){
+    static int supported = -1;
+    if(supported < 0){
+        GLint formats = 0;
+        if(ggtgl_version() >= 41 || ggtgl_has_extension("GL_ARB_get_program_binary"))
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        supported = (formats > 0);
+    }
+    if(!supported)
+        return 0;
+    
+    // A driver update changes the version string, which drops the old binaries
+    ggt_u64 hash = 14695981039346656037ull;
+    hash = _ggtgl_hash_text(hash, (const char *)glGetString(GL_VENDOR));
+    hash = _ggtgl_hash_text(hash, (const char *)glGetString(GL_RENDERER));
+    hash = _ggtgl_hash_text(hash, (const char *)glGetString(GL_VERSION));
+    hash = _ggtgl_hash_text(hash, vertex_text);
+    hash = _ggtgl_hash_text(hash, fragment_text);
+    return hash ? hash : 1;
+}
+
+void _ggtgl_program_cache_path(ggt_u64 key, char *dst){
+    char name[64];
+    sprintf(name, "program_%016llx.ggtb", (unsigned long long)key);
+    ggtp_user_file_path(name, dst);
+}
+
+// 0 if it isn't cached or the driver rejects the binary
+GLuint _ggtgl_load_cached_program(ggt_u64 key){
+    char path[1024];
+    _ggtgl_program_cache_path(key, path);
+    FILE *file = fopen(path, "rb");
+    if(!file)
+        return 0;
     
-    // Check Fragment Shader
-    glGetShaderiv(fragment_shader_id, GL_COMPILE_STATUS, &result);
-    if(result == GL_FALSE){
-        glGetShaderiv(fragment_shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
-        if(info_log_length > 0){
-            if(info_log_length > GGTGL_MAX_INFO_LOG_LENGTH)
-                info_log_length = GGTGL_MAX_INFO_LOG_LENGTH;
-            glGetShaderInfoLog(fragment_shader_id, info_log_length, NULL, error_message);
-            printf("Couldn't compile fragment shader:\n%s\n\n", error_message);
+    // The size in the header is only trusted if the file holds that much
+    long file_size = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+    fseek(file, 0, SEEK_SET);
+    
+    GLuint program_id = 0;
+    _ggtgl_program_cache_header header;
+    if(file_size >= (long)sizeof(header) && fread(&header, sizeof(header), 1, file) == 1 &&
+       header.magic == GGTGL_PROGRAM_CACHE_MAGIC && header.key == key &&
+       header.size <= (unsigned long)file_size - sizeof(header)){
+        void *binary = malloc(header.size ? header.size : 1);
+        if(binary && fread(binary, 1, header.size, file) == header.size){
+            program_id = glCreateProgram();
+            glProgramBinary(program_id, header.format, binary, (GLsizei)header.size);
+            GLint result = GL_FALSE;
+            glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+            if(result == GL_FALSE){
+                glDeleteProgram(program_id);
+                program_id = 0;
+                // glProgramBinary leaves GL_INVALID_ENUM around for formats the driver dropped
+                glGetError();
+            }
         }
+        free(binary);
     }
+    fclose(file);
+    return program_id;
+}
+
+void _ggtgl_store_cached_program(ggt_u64 key, GLuint program_id){
+    GLint length = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+        return;
     
-    // Link the program
-    GLuint program_id = glCreateProgram();
-    glAttachShader(program_id, vertex_shader_id);
-    glAttachShader(program_id, fragment_shader_id);
-    glLinkProgram(program_id);
+    _ggtgl_program_cache_header header;
+    header.magic = GGTGL_PROGRAM_CACHE_MAGIC;
+    header.format = 0;
+    header.key = key;
+    header.size = 0;
+    void *binary = malloc(length);
+    if(!binary)
+        return; // Only a cache, the program still works
+    GLsizei size = 0;
+    glGetProgramBinary(program_id, length, &size, &header.format, binary);
+    header.size = (ggt_u32)size;
     
-    // Check the program
-    glGetProgramiv(program_id, GL_LINK_STATUS, &result);
-    if(result == GL_FALSE){
-        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_log_length);
-        if(info_log_length > 0){
-            if(info_log_length > GGTGL_MAX_INFO_LOG_LENGTH)
-                info_log_length = GGTGL_MAX_INFO_LOG_LENGTH;
-            glGetProgramInfoLog(program_id, info_log_length, NULL, error_message);
-            printf("Couldn't link shader:\n%s\n\n", error_message);
-            glValidateProgram(program_id);
+    // Written next to it and renamed, so a crash never leaves half a binary
+    char path[1024], temporary_path[1040];
+    _ggtgl_program_cache_path(key, path);
+    sprintf(temporary_path, "%s.tmp", path);
+    FILE *file = size > 0 ? fopen(temporary_path, "wb") : NULL;
+    if(file){
+        int written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary, 1, size, file) == (size_t)size;
+        fclose(file);
+        remove(path);
+        if(!written || rename(temporary_path, path) != 0){
+            printf("ggtgl_load_shaders_by_text error: Couldn't write %s\n", path);
+            remove(temporary_path);
+        }
+    }
+    free(binary);
+}
+
+#endif
+
+GLuint ggtgl_load_shaders_by_text(const char *vertex_text, const char *fragment_text){
+#ifndef GGTGL_NO_PROGRAM_CACHE
+    ggt_u64 key = _ggtgl_program_cache_key(vertex_text, fragment_text);
+    if(key){
+        GLuint program_id = _ggtgl_load_cached_program(key);
+        if(program_id)
+            return program_id;
+        
+        // Missing or stale, so build it and (re)write the cache
+        program_id = _ggtgl_compile_program(vertex_text, fragment_text, 1);
+        GLint result = GL_FALSE;
+        glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+        if(result == GL_TRUE)
+            _ggtgl_store_cached_program(key, program_id);
+        return program_id;
+    }
+#endif
+    return _ggtgl_compile_program(vertex_text, fragment_text, 0);
+}
+
+typedef struct {
+    char *data;
+    size_t size, capacity;
+} _ggtgl_text;
+
+void _ggtgl_text_append(_ggtgl_text *text, const char *data, size_t size){
+    if(text->size + size + 1 > text->capacity){
+        while(text->size + size + 1 > text->capacity)
+            text->capacity = text->capacity ? text->capacity * 2 : 4096;
+        text->data = (char *)realloc(text->data, text->capacity);
+    }
+    memcpy(text->data + text->size, data, size);
+    text->size += size;
+    text->data[text->size] = '\0';
+}
+
+#define _GGTGL_MAX_INCLUDE_DEPTH 16
+
+// Appends the file to text with its #includes expanded
+int _ggtgl_expand_shader_file(_ggtgl_text *text, const char *path, int depth){
+    if(depth > _GGTGL_MAX_INCLUDE_DEPTH){
+        printf("ggtgl_load_shaders error: Includes nested too deep at %s\n", path);
+        return GGT_FAILURE;
+    }
+    FILE *file = fopen(path, "rb");
+    if(!file){
+        printf("ggtgl_load_shaders error: Couldn't open %s\n", path);
+        return GGT_FAILURE;
+    }
+    long size = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+    fseek(file, 0, SEEK_SET);
+    char *data = (size >= 0) ? (char *)malloc(size + 1) : NULL;
+    if(!data){
+        printf("ggtgl_load_shaders error: Couldn't read %s\n", path);
+        fclose(file);
+        return GGT_FAILURE;
+    }
+    size_t read = fread(data, 1, size, file);
+    fclose(file);
+    data[read] = '\0';
+    
+    int result = GGT_SUCCESS;
+    int line_number = 1;
+    for(char *line = data; *line && result == GGT_SUCCESS; line_number++){
+        char *end = strchr(line, '\n');
+        size_t length = end ? (size_t)(end - line) + 1 : strlen(line);
+        
+        char *directive = line;
+        while(*directive == ' ' || *directive == '\t')
+            directive++;
+        char *name = NULL, *name_end = NULL;
+        if(!strncmp(directive, "#include", 8)){
+            name = strchr(directive, '"');
+            name_end = name ? strchr(name + 1, '"') : NULL;
+        }
+        if(name_end && name_end < line + length){
+            // Relative to the directory of this file
+            char include_path[1024];
+            const char *slash = strrchr(path, '/');
+            const char *backslash = strrchr(path, '\\');
+            if(backslash > slash)
+                slash = backslash;
+            int directory_length = slash ? (int)(slash - path) + 1 : 0;
+            snprintf(include_path, sizeof(include_path), "%.*s%.*s", directory_length, path, (int)(name_end - name - 1), name + 1);
+            result = _ggtgl_expand_shader_file(text, include_path, depth + 1);
+            // Back to this file's numbering for the lines after it
+            char line_directive[32];
+            int directive_length = snprintf(line_directive, sizeof(line_directive), "\n#line %d\n", line_number + 1);
+            _ggtgl_text_append(text, line_directive, directive_length);
+        }else{
+            _ggtgl_text_append(text, line, length);
         }
+        line += length;
+    }
+    free(data);
+    return result;
+}
+
+// Before GLSL 3.30 and ES 3.00, "#line N" numbers the next line N + 1
+int _ggtgl_has_legacy_line_directives(const char *text){
+    const char *version = strstr(text, "#version");
+    if(!version)
+        return 1; // GLSL 1.10
+    int number = atoi(version + 8);
+    const char *end = strchr(version, '\n');
+    const char *es = strstr(version, " es");
+    return number < 300 || (number < 330 && !(es && (!end || es < end)));
+}
+
+// Appends a #line that makes next_line the number of the line after it
+void _ggtgl_text_append_line_directive(_ggtgl_text *text, int next_line, int legacy){
+    char directive[32];
+    int length = snprintf(directive, sizeof(directive), "#line %d\n", legacy ? next_line - 1 : next_line);
+    _ggtgl_text_append(text, directive, length);
+}
+
+// Splits the expanded file in the two stages. Returns GGT_FAILURE if one is missing
+int _ggtgl_read_shader_file(const char *file_path, _ggtgl_text *vertex, _ggtgl_text *fragment){
+    char path[1024];
+    ggtp_program_file_path(file_path, path);
+    _ggtgl_text text = {NULL, 0, 0};
+    memset(vertex, 0, sizeof(_ggtgl_text));
+    memset(fragment, 0, sizeof(_ggtgl_text));
+    if(!_ggtgl_expand_shader_file(&text, path, 0)){
+        free(text.data);
+        return GGT_FAILURE;
     }
     
-    glDeleteShader(vertex_shader_id);
-    glDeleteShader(fragment_shader_id);
+    // Each stage leaves out the other's lines, so a #line after its marker
+    // keeps the compiler's line numbers matching the file. The #line
+    // directives in the text (left after includes) give the number of the
+    // next line and are rewritten for the version's meaning
+    int legacy = _ggtgl_has_legacy_line_directives(text.data);
+    int stage = 0; // Both, vertex or fragment
+    int found[2] = {0, 0};
+    int line_number = 1;
+    for(char *line = text.data; line && *line; line_number++){
+        char *end = strchr(line, '\n');
+        size_t length = end ? (size_t)(end - line) + 1 : strlen(line);
+        
+        char *directive = line;
+        while(*directive == ' ' || *directive == '\t')
+            directive++;
+        if(!strncmp(directive, "#vertex", 7) || !strncmp(directive, "#fragment", 9)){
+            stage = (directive[1] == 'v') ? 1 : 2;
+            found[stage - 1] = 1;
+            _ggtgl_text_append_line_directive((stage == 1) ? vertex : fragment, line_number + 1, legacy);
+        }else if(!strncmp(directive, "#line", 5)){
+            line_number = atoi(directive + 5) - 1;
+            if(stage != 2)
+                _ggtgl_text_append_line_directive(vertex, line_number + 1, legacy);
+            if(stage != 1)
+                _ggtgl_text_append_line_directive(fragment, line_number + 1, legacy);
+        }else{
+            if(stage != 2)
+                _ggtgl_text_append(vertex, line, length);
+            if(stage != 1)
+                _ggtgl_text_append(fragment, line, length);
+        }
+        line += length;
+    }
+    free(text.data);
     
+    if(!found[0] || !found[1]){
+        printf("ggtgl_load_shaders error: %s needs a #vertex and a #fragment section\n", path);
+        free(vertex->data);
+        free(fragment->data);
+        return GGT_FAILURE;
+    }
+    return GGT_SUCCESS;
+}
+
+GLuint ggtgl_load_shaders(const char *file_path){
+    _ggtgl_text vertex, fragment;
+    if(!_ggtgl_read_shader_file(file_path, &vertex, &fragment))
+        return 0;
+    GLuint program_id = ggtgl_load_shaders_by_text(vertex.data, fragment.data);
+    free(vertex.data);
+    free(fragment.data);
     return program_id;
 }
 
-#ifdef STBI_INCLUDE_STB_IMAGE_H
-void ggtgl_load_texture(GLuint *texture, const char *path){
-    int width, height, channels;
-    u8* image = stbi_load(path, &width, &height, &channels, 0);
-    if(image == NULL){
-        printf("ggtgl_load_texture error: Couldn't load image\n");
-        return;
+#ifndef GGTGL_MAX_SHADERS
+#define GGTGL_MAX_SHADERS 256
+#endif
+
+#ifndef GGTGL_SHADERS_PER_UPDATE
+#define GGTGL_SHADERS_PER_UPDATE 4
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef struct {
+    GLuint program;
+    GLuint shaders[2];
+    ggtgl_shader_status status;
+    int used;
+    ggt_u64 cache_key;
+} _ggtgl_shader_slot;
+
+struct {
+    _ggtgl_shader_slot slots[GGTGL_MAX_SHADERS];
+    int parallel; // -1 until checked
+} _ggtgl_shader_state = {{{0}}, -1};
+
+ggtgl_shader ggtgl_compile_shaders_async(const char *vertex_text, const char *fragment_text){
+    unsigned int index = 0;
+    while(index < GGTGL_MAX_SHADERS && _ggtgl_shader_state.slots[index].used)
+        index++;
+    if(index == GGTGL_MAX_SHADERS){
+        printf("ggtgl_compile_shaders_async error: Too many shaders, increase GGTGL_MAX_SHADERS\n");
+        return 0;
     }
+    if(_ggtgl_shader_state.parallel < 0)
+        _ggtgl_shader_state.parallel = ggtgl_has_extension("GL_KHR_parallel_shader_compile") || ggtgl_has_extension("GL_ARB_parallel_shader_compile");
     
-    // Flip texture Y axis
-    int i, j;
-    for(j = 0; j*2<height; j++){
-        int index1 = j * width * channels;
-        int index2 = (height - 1 - j) * width * channels;
-        for(i=width*channels; i>0; i--){
-            u8 temp = image[index1];
-            image[index1] = image[index2];
-            image[index2] = temp;
-            ++index1;
-            ++index2;
+    _ggtgl_shader_slot *slot = &_ggtgl_shader_state.slots[index];
+    memset(slot, 0, sizeof(_ggtgl_shader_slot));
+    slot->used = 1;
+#ifndef GGTGL_NO_PROGRAM_CACHE
+    slot->cache_key = _ggtgl_program_cache_key(vertex_text, fragment_text);
+    if(slot->cache_key){
+        slot->program = _ggtgl_load_cached_program(slot->cache_key);
+        if(slot->program){
+            slot->status = GGTGL_SHADER_READY;
+            return index + 1;
         }
     }
+#endif
+    slot->program = _ggtgl_start_program(vertex_text, fragment_text, slot->cache_key != 0, slot->shaders);
+    slot->status = GGTGL_SHADER_PENDING;
+    return index + 1;
+}
+
+ggtgl_shader ggtgl_load_shaders_async(const char *file_path){
+    _ggtgl_text vertex, fragment;
+    if(!_ggtgl_read_shader_file(file_path, &vertex, &fragment))
+        return 0;
+    ggtgl_shader shader = ggtgl_compile_shaders_async(vertex.data, fragment.data);
+    free(vertex.data);
+    free(fragment.data);
+    return shader;
+}
+
+void _ggtgl_finish_shader(_ggtgl_shader_slot *slot){
+    if(_ggtgl_finish_program(slot->program, slot->shaders) == GL_TRUE){
+#ifndef GGTGL_NO_PROGRAM_CACHE
+        if(slot->cache_key)
+            _ggtgl_store_cached_program(slot->cache_key, slot->program);
+#endif
+        slot->status = GGTGL_SHADER_READY;
+    }else{
+        glDeleteProgram(slot->program);
+        slot->program = 0;
+        slot->status = GGTGL_SHADER_FAILED;
+    }
+}
+
+void ggtgl_update_shaders(void){
+    int blocking = 0;
+    for(unsigned int i = 0; i < GGTGL_MAX_SHADERS; i++){
+        _ggtgl_shader_slot *slot = &_ggtgl_shader_state.slots[i];
+        if(!slot->used || slot->status != GGTGL_SHADER_PENDING)
+            continue;
+        if(_ggtgl_shader_state.parallel){
+            // Never waits, the driver says whether it's done
+            GLint done = GL_FALSE;
+            glGetProgramiv(slot->program, GL_COMPLETION_STATUS_KHR, &done);
+            if(done == GL_FALSE)
+                continue;
+        }else if(blocking++ == GGTGL_SHADERS_PER_UPDATE){
+            // Every status query may wait for the driver, so spread them over frames
+            break;
+        }
+        _ggtgl_finish_shader(slot);
+    }
+}
+
+void ggtgl_finish_shaders(void){
+    for(unsigned int i = 0; i < GGTGL_MAX_SHADERS; i++){
+        _ggtgl_shader_slot *slot = &_ggtgl_shader_state.slots[i];
+        if(slot->used && slot->status == GGTGL_SHADER_PENDING)
+            _ggtgl_finish_shader(slot);
+    }
+}
+
+ggtgl_shader_status ggtgl_shader_get_status(ggtgl_shader shader){
+    if(shader == 0 || shader > GGTGL_MAX_SHADERS || !_ggtgl_shader_state.slots[shader - 1].used)
+        return GGTGL_SHADER_FAILED;
+    return _ggtgl_shader_state.slots[shader - 1].status;
+}
+
+GLuint ggtgl_shader_program(ggtgl_shader shader){
+    if(ggtgl_shader_get_status(shader) != GGTGL_SHADER_READY)
+        return 0;
+    return _ggtgl_shader_state.slots[shader - 1].program;
+}
+
+void ggtgl_free_shader(ggtgl_shader shader){
+    if(shader == 0 || shader > GGTGL_MAX_SHADERS || !_ggtgl_shader_state.slots[shader - 1].used)
+        return;
+    _ggtgl_shader_slot *slot = &_ggtgl_shader_state.slots[shader - 1];
+    if(slot->status == GGTGL_SHADER_PENDING){
+        for(int i = 0; i < 2; i++)
+            glDeleteShader(slot->shaders[i]);
+    }
+    if(slot->program)
+        glDeleteProgram(slot->program);
+    memset(slot, 0, sizeof(_ggtgl_shader_slot));
+}
+
+int ggtgl_has_extension(const char *name){
+    size_t length = strlen(name);
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    if(extensions){
+        for(const char *found = strstr(extensions, name); found; found = strstr(found + 1, name)){
+            if((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+                return 1;
+        }
+        return 0;
+    }
     
-    glGenTextures(1, texture);
-    glBindTexture(GL_TEXTURE_2D, *texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    
-    stbi_image_free(image);
+#ifdef GL_NUM_EXTENSIONS
+    // Core profiles only list them one by one (and flag GL_EXTENSIONS as an error)
+    glGetError();
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for(GLint i = 0; i < count; i++){
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if(extension && !strcmp(extension, name))
+            return 1;
+    }
+#endif
+    return 0;
 }
+
+int ggtgl_version(void){
+    const char *version = (const char *)glGetString(GL_VERSION);
+    if(!version)
+        return 0;
+    while(*version && (*version < '0' || *version > '9'))
+        version++; // Skip "OpenGL ES "
+    int major = 0, minor = 0;
+    if(sscanf(version, "%d.%d", &major, &minor) < 2)
+        return 0;
+    return major * 10 + minor;
+}
+
+#ifndef GGTGL_STREAM_ALIGNMENT
+#define GGTGL_STREAM_ALIGNMENT 16
+#endif
+
+int _ggtgl_has_sync(void){
+#ifdef GGTGL_OPENGL_ES
+    return ggtgl_version() >= 30;
+#else
+    return ggtgl_version() >= 32 || ggtgl_has_extension("GL_ARB_sync");
 #endif
+}
+
+int ggtgl_stream_buffer_create(ggtgl_stream_buffer *stream, GLenum target, GLsizeiptr frame_size){
+    memset(stream, 0, sizeof(ggtgl_stream_buffer));
+    stream->target = target;
+    stream->frame_size = (frame_size + GGTGL_STREAM_ALIGNMENT - 1) / GGTGL_STREAM_ALIGNMENT * GGTGL_STREAM_ALIGNMENT;
+    GLsizeiptr total_size = stream->frame_size * GGTGL_STREAM_REGIONS;
+    
+    _ggtgl_clear_errors();
+    glGenBuffers(1, &stream->buffer);
+    _ggtgl_bind_buffer_now(target, stream->buffer);
+    
+#ifdef GGTGL_OPENGL_ES
+    stream->backend = GGTGL_STREAM_SUBDATA;
+#else
+    int version = ggtgl_version();
+    stream->fenced = _ggtgl_has_sync();
+    if(stream->fenced && (version >= 44 || ggtgl_has_extension("GL_ARB_buffer_storage"))){
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, total_size, NULL, flags);
+        stream->mapping = (unsigned char *)glMapBufferRange(target, 0, total_size, flags);
+        if(stream->mapping){
+            stream->backend = GGTGL_STREAM_PERSISTENT;
+            return GGT_SUCCESS;
+        }
+        // Storage is immutable, so start over with a new buffer
+        glDeleteBuffers(1, &stream->buffer);
+        _ggtgl_state_delete_buffer(stream->buffer);
+        glGenBuffers(1, &stream->buffer);
+        _ggtgl_bind_buffer_now(target, stream->buffer);
+    }
+    stream->backend = (version >= 30 || ggtgl_has_extension("GL_ARB_map_buffer_range")) ? GGTGL_STREAM_UNSYNCHRONIZED : GGTGL_STREAM_SUBDATA;
+#endif
+    
+    glBufferData(target, total_size, NULL, GL_STREAM_DRAW);
+    return (glGetError() == GL_NO_ERROR) ? GGT_SUCCESS : GGT_FAILURE;
+}
+
+void ggtgl_stream_buffer_destroy(ggtgl_stream_buffer *stream){
+    for(int i = 0; i < GGTGL_STREAM_REGIONS; i++)
+        if(stream->fences[i])
+            glDeleteSync(stream->fences[i]);
+    if(stream->mapping){
+        _ggtgl_bind_buffer_now(stream->target, stream->buffer);
+        glUnmapBuffer(stream->target);
+    }
+    glDeleteBuffers(1, &stream->buffer);
+    _ggtgl_state_delete_buffer(stream->buffer);
+    memset(stream, 0, sizeof(ggtgl_stream_buffer));
+}
+
+// Before the first write of a frame, make sure the GPU is done reading the region
+void _ggtgl_stream_buffer_begin_region(ggtgl_stream_buffer *stream){
+    GLsync fence = stream->fences[stream->region];
+    if(fence){
+        while(1){
+            GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            if(result != GL_TIMEOUT_EXPIRED)
+                break;
+        }
+        glDeleteSync(fence);
+        stream->fences[stream->region] = 0;
+    }else if(stream->backend == GGTGL_STREAM_UNSYNCHRONIZED && stream->region == 0 && !stream->fenced){
+        // No fences, so orphan the storage every time around instead
+        glBufferData(stream->target, stream->frame_size * GGTGL_STREAM_REGIONS, NULL, GL_STREAM_DRAW);
+    }
+    stream->region_ready = 1;
+}
+
+GLintptr ggtgl_stream_buffer_write(ggtgl_stream_buffer *stream, const void *data, GLsizeiptr size){
+    GLsizeiptr aligned_size = (size + GGTGL_STREAM_ALIGNMENT - 1) / GGTGL_STREAM_ALIGNMENT * GGTGL_STREAM_ALIGNMENT;
+    if(stream->offset + aligned_size > stream->frame_size){
+        printf("ggtgl_stream_buffer_write error: The frame's region is full\n");
+        return -1;
+    }
+    
+    _ggtgl_bind_buffer_now(stream->target, stream->buffer);
+    if(!stream->region_ready)
+        _ggtgl_stream_buffer_begin_region(stream);
+    
+    GLintptr offset = stream->region * stream->frame_size + stream->offset;
+    stream->offset += aligned_size;
+    switch(stream->backend){
+        case GGTGL_STREAM_PERSISTENT: {
+            memcpy(stream->mapping + offset, data, size);
+        } break;
+#ifndef GGTGL_OPENGL_ES
+        case GGTGL_STREAM_UNSYNCHRONIZED: {
+            void *mapping = glMapBufferRange(stream->target, offset, size,
+                                             GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            if(!mapping)
+                return -1;
+            memcpy(mapping, data, size);
+            glUnmapBuffer(stream->target);
+        } break;
+#endif
+        default: {
+            glBufferSubData(stream->target, offset, size, data);
+        } break;
+    }
+    return offset;
+}
+
+void ggtgl_stream_buffer_end_frame(ggtgl_stream_buffer *stream){
+    if(stream->region_ready && stream->fenced)
+        stream->fences[stream->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream->region = (stream->region + 1) % GGTGL_STREAM_REGIONS;
+    stream->offset = 0;
+    stream->region_ready = 0;
+}
+
+int _ggtgl_has_vertex_arrays(void){
+    static int supported = -1;
+    if(supported < 0){
+#ifdef GGTGL_OPENGL_ES
+        supported = ggtgl_version() >= 30;
+#else
+        supported = ggtgl_version() >= 30 || ggtgl_has_extension("GL_ARB_vertex_array_object");
+#endif
+    }
+    return supported;
+}
+
+int _ggtgl_has_integer_attributes(void){
+    static int supported = -1;
+    if(supported < 0)
+        supported = ggtgl_version() >= 30;
+    return supported;
+}
+
+int _ggtgl_has_instancing(void){
+    static int supported = -1;
+    if(supported < 0){
+#ifdef GGTGL_OPENGL_ES
+        supported = ggtgl_version() >= 30;
+#else
+        supported = ggtgl_version() >= 33 || ggtgl_has_extension("GL_ARB_instanced_arrays");
+#endif
+    }
+    return supported;
+}
+
+// Points the attributes of a stream (or every stream, for -1) at their buffer
+void _ggtgl_vertex_layout_point(ggtgl_vertex_layout *layout, int stream){
+    for(int i = 0; i < layout->attribute_count; i++){
+        if(stream >= 0 && layout->attributes[i].stream != (unsigned int)stream)
+            continue;
+        unsigned int attribute_stream = layout->attributes[i].stream;
+        // Not given yet, ggtgl_vertex_layout_set_stream points it later
+        if(!layout->buffers[attribute_stream])
+            continue;
+        _ggtgl_bind_buffer_now(GL_ARRAY_BUFFER, layout->buffers[attribute_stream]);
+        void *pointer = (void *)(layout->stream_offsets[attribute_stream] + layout->attributes[i].offset);
+        if(layout->attributes[i].integer)
+            glVertexAttribIPointer(layout->attributes[i].location, layout->attributes[i].size, layout->attributes[i].type,
+                                   layout->attributes[i].stride, pointer);
+        else
+            glVertexAttribPointer(layout->attributes[i].location, layout->attributes[i].size, layout->attributes[i].type,
+                                  layout->attributes[i].normalized, layout->attributes[i].stride, pointer);
+    }
+}
+
+// Everything but the pointers, which _ggtgl_vertex_layout_point sets
+void _ggtgl_vertex_layout_enable(ggtgl_vertex_layout *layout){
+    unsigned int used = 0;
+    for(int i = 0; i < layout->attribute_count; i++){
+        GLuint location = layout->attributes[i].location;
+        used |= (location < 32) ? (1u << location) : 0;
+        ggtgl_enable_attrib(location);
+        if(_ggtgl_has_instancing())
+            glVertexAttribDivisor(location, layout->attributes[i].divisor);
+    }
+    // Leftovers of another layout would read past the end of their buffers
+    const ggtgl_state *state = ggtgl_get_state();
+    for(GLuint location = 0; location < 32; location++)
+        if((state->attribs_known & state->attribs & ~used) & (1u << location))
+            ggtgl_disable_attrib(location);
+    ggtgl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, layout->index_buffer);
+}
+
+int ggtgl_vertex_layout_create(ggtgl_vertex_layout *layout, GLuint program, const ggtgl_vertex_attribute *attributes,
+                               int attribute_count, const GLuint *buffers, GLuint index_buffer){
+    memset(layout, 0, sizeof(ggtgl_vertex_layout));
+    if(attribute_count > GGTGL_MAX_VERTEX_ATTRIBUTES){
+        printf("ggtgl_vertex_layout_create error: Too many attributes, increase GGTGL_MAX_VERTEX_ATTRIBUTES\n");
+        return GGT_FAILURE;
+    }
+    for(int i = 0; i < attribute_count; i++){
+        if(attributes[i].stream >= GGTGL_MAX_VERTEX_STREAMS){
+            printf("ggtgl_vertex_layout_create error: %s is in stream %u, increase GGTGL_MAX_VERTEX_STREAMS\n", attributes[i].name, attributes[i].stream);
+            return GGT_FAILURE;
+        }
+        if(attributes[i].divisor && !_ggtgl_has_instancing()){
+            printf("ggtgl_vertex_layout_create error: %s has a divisor, but instanced arrays aren't supported\n", attributes[i].name);
+            return GGT_FAILURE;
+        }
+        if(attributes[i].integer && !_ggtgl_has_integer_attributes()){
+            printf("ggtgl_vertex_layout_create error: %s is integer, but integer attributes aren't supported\n", attributes[i].name);
+            return GGT_FAILURE;
+        }
+        GLint location = glGetAttribLocation(program, attributes[i].name);
+        if(location < 0)
+            continue;
+        int index = layout->attribute_count++;
+        layout->attributes[index].location = (GLuint)location;
+        layout->attributes[index].stream = attributes[i].stream;
+        layout->attributes[index].size = attributes[i].size;
+        layout->attributes[index].type = attributes[i].type;
+        layout->attributes[index].normalized = attributes[i].normalized;
+        layout->attributes[index].stride = attributes[i].stride;
+        layout->attributes[index].offset = attributes[i].offset;
+        layout->attributes[index].divisor = attributes[i].divisor;
+        layout->attributes[index].integer = attributes[i].integer;
+        layout->buffers[attributes[i].stream] = buffers[attributes[i].stream];
+    }
+    layout->index_buffer = index_buffer;
+    layout->dirty = 1;
+    
+    if(_ggtgl_has_vertex_arrays()){
+        GLuint previous = _ggtgl_bound_vertex_array();
+        glGenVertexArrays(1, &layout->vertex_array);
+        _ggtgl_bind_vertex_array_now(layout->vertex_array);
+        _ggtgl_vertex_layout_enable(layout);
+        _ggtgl_vertex_layout_point(layout, -1);
+        _ggtgl_bind_vertex_array_now(previous);
+        layout->dirty = 0;
+    }
+    return GGT_SUCCESS;
+}
+
+void ggtgl_vertex_layout_destroy(ggtgl_vertex_layout *layout){
+    if(layout->vertex_array){
+        if(ggtgl_get_state()->vertex_array == layout->vertex_array)
+            ggtgl_bind_vertex_array(0);
+        glDeleteVertexArrays(1, &layout->vertex_array);
+    }
+    if(_ggtgl_current_layout == layout)
+        _ggtgl_current_layout = NULL;
+    memset(layout, 0, sizeof(ggtgl_vertex_layout));
+}
+
+void ggtgl_vertex_layout_set_stream(ggtgl_vertex_layout *layout, unsigned int stream, GLuint buffer, GLintptr offset){
+    if(stream >= GGTGL_MAX_VERTEX_STREAMS || (layout->buffers[stream] == buffer && layout->stream_offsets[stream] == offset))
+        return;
+    layout->buffers[stream] = buffer;
+    layout->stream_offsets[stream] = offset;
+    if(layout->vertex_array){
+        GLuint previous = _ggtgl_bound_vertex_array();
+        _ggtgl_bind_vertex_array_now(layout->vertex_array);
+        _ggtgl_vertex_layout_point(layout, (int)stream);
+        _ggtgl_bind_vertex_array_now(previous);
+    }else{
+        layout->dirty = 1;
+    }
+}
+
+void ggtgl_vertex_layout_bind(ggtgl_vertex_layout *layout){
+    if(layout->vertex_array){
+        ggtgl_bind_vertex_array(layout->vertex_array);
+        return;
+    }
+    if(_ggtgl_current_layout == layout && !layout->dirty){
+        ggtgl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, layout->index_buffer);
+        return;
+    }
+    _ggtgl_vertex_layout_enable(layout);
+    _ggtgl_vertex_layout_point(layout, -1);
+    _ggtgl_current_layout = layout;
+    layout->dirty = 0;
+}
+
+#ifndef GGTGL_TEXTURE_THREADS
+#define GGTGL_TEXTURE_THREADS 2
+#endif
+
+#ifndef GGTGL_TEXTURE_UPLOAD_SIZE
+#define GGTGL_TEXTURE_UPLOAD_SIZE (4 * 1024 * 1024)
+#endif
+
+#ifndef GGTGL_MAX_TEXTURE_LOADS
+#define GGTGL_MAX_TEXTURE_LOADS 256
+#endif
+
+#ifndef GGTGL_TEXTURE_PLACEHOLDER
+#define GGTGL_TEXTURE_PLACEHOLDER 0xFF808080
+#endif
+
+// Compressed formats, from the extensions that add them
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT         0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT        0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT        0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT        0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT        0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT  0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT  0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT  0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RED_RGTC1
+#define GL_COMPRESSED_RED_RGTC1                 0x8DBB
+#define GL_COMPRESSED_SIGNED_RED_RGTC1          0x8DBC
+#define GL_COMPRESSED_RG_RGTC2                  0x8DBD
+#define GL_COMPRESSED_SIGNED_RG_RGTC2           0x8DBE
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM           0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM     0x8E8D
+#define GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT     0x8E8E
+#define GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT   0x8E8F
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_R11_EAC                   0x9270
+#define GL_COMPRESSED_SIGNED_R11_EAC            0x9271
+#define GL_COMPRESSED_RG11_EAC                  0x9272
+#define GL_COMPRESSED_SIGNED_RG11_EAC           0x9273
+#define GL_COMPRESSED_RGB8_ETC2                 0x9274
+#define GL_COMPRESSED_SRGB8_ETC2                0x9275
+#define GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2  0x9276
+#define GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9277
+#define GL_COMPRESSED_RGBA8_ETC2_EAC            0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC     0x9279
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR         0x93B0
+#define GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR 0x93D0
+#endif
+#ifndef GL_SRGB8_ALPHA8
+#define GL_SRGB8_ALPHA8                         0x8C43
+#endif
+
+typedef enum {
+    _GGTGL_FORMAT_PLAIN, // RGBA8
+    _GGTGL_FORMAT_S3TC,
+    _GGTGL_FORMAT_S3TC_SRGB,
+    _GGTGL_FORMAT_RGTC,
+    _GGTGL_FORMAT_BPTC,
+    _GGTGL_FORMAT_ETC2,
+    _GGTGL_FORMAT_ASTC,
+} _ggtgl_format_family;
+
+typedef struct {
+    GLenum format;
+    ggt_u32 dxgi_format, vk_format; // DDS and KTX2 ids, 0 if it has none
+    int block_size; // Bytes per 4x4 block
+    _ggtgl_format_family family;
+} _ggtgl_texture_format;
+
+// ASTC is found in _ggtgl_find_texture_format, its vk_formats are 157 to 184
+_ggtgl_texture_format _ggtgl_texture_formats[] = {
+    {GL_RGBA,                                       28,  37,  0, _GGTGL_FORMAT_PLAIN},
+    {GL_SRGB8_ALPHA8,                               29,  43,  0, _GGTGL_FORMAT_PLAIN},
+    {GL_COMPRESSED_RGB_S3TC_DXT1_EXT,                0, 131,  8, _GGTGL_FORMAT_S3TC},
+    {GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,               0, 132,  8, _GGTGL_FORMAT_S3TC_SRGB},
+    {GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,              71, 133,  8, _GGTGL_FORMAT_S3TC},
+    {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT,        72, 134,  8, _GGTGL_FORMAT_S3TC_SRGB},
+    {GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,              74, 135, 16, _GGTGL_FORMAT_S3TC},
+    {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT,        75, 136, 16, _GGTGL_FORMAT_S3TC_SRGB},
+    {GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,              77, 137, 16, _GGTGL_FORMAT_S3TC},
+    {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,        78, 138, 16, _GGTGL_FORMAT_S3TC_SRGB},
+    {GL_COMPRESSED_RED_RGTC1,                       80, 139,  8, _GGTGL_FORMAT_RGTC},
+    {GL_COMPRESSED_SIGNED_RED_RGTC1,                81, 140,  8, _GGTGL_FORMAT_RGTC},
+    {GL_COMPRESSED_RG_RGTC2,                        83, 141, 16, _GGTGL_FORMAT_RGTC},
+    {GL_COMPRESSED_SIGNED_RG_RGTC2,                 84, 142, 16, _GGTGL_FORMAT_RGTC},
+    {GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT,         95, 143, 16, _GGTGL_FORMAT_BPTC},
+    {GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT,           96, 144, 16, _GGTGL_FORMAT_BPTC},
+    {GL_COMPRESSED_RGBA_BPTC_UNORM,                 98, 145, 16, _GGTGL_FORMAT_BPTC},
+    {GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,           99, 146, 16, _GGTGL_FORMAT_BPTC},
+    {GL_COMPRESSED_RGB8_ETC2,                        0, 147,  8, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_SRGB8_ETC2,                       0, 148,  8, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,    0, 149,  8, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2,   0, 150,  8, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_RGBA8_ETC2_EAC,                   0, 151, 16, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC,            0, 152, 16, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_R11_EAC,                          0, 153,  8, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_SIGNED_R11_EAC,                   0, 154,  8, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_RG11_EAC,                         0, 155, 16, _GGTGL_FORMAT_ETC2},
+    {GL_COMPRESSED_SIGNED_RG11_EAC,                  0, 156, 16, _GGTGL_FORMAT_ETC2},
+};
+
+typedef struct {
+    unsigned char *pixels; // Every level, largest first
+    int width, height, levels;
+    GLenum format; // GL_RGBA, GL_SRGB8_ALPHA8 or a compressed format
+    int block_width, block_height, block_size; // 1, 1 and 4 for the first two
+    _ggtgl_format_family family;
+} _ggtgl_image;
+
+// Fills the format fields of image. Returns GGT_FAILURE if it isn't known
+int _ggtgl_find_texture_format(_ggtgl_image *image, ggt_u32 dxgi_format, ggt_u32 vk_format){
+    static const ggt_u8 astc_blocks[14][2] = {{4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6},
+                                              {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}};
+    if(vk_format >= 157 && vk_format <= 184){
+        int index = (vk_format - 157) / 2;
+        int srgb = (vk_format - 157) % 2;
+        image->format = (srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR : GL_COMPRESSED_RGBA_ASTC_4x4_KHR) + index;
+        image->block_width = astc_blocks[index][0];
+        image->block_height = astc_blocks[index][1];
+        image->block_size = 16;
+        image->family = _GGTGL_FORMAT_ASTC;
+        return GGT_SUCCESS;
+    }
+    
+    for(size_t i = 0; i < sizeof(_ggtgl_texture_formats) / sizeof(_ggtgl_texture_formats[0]); i++){
+        _ggtgl_texture_format *format = &_ggtgl_texture_formats[i];
+        if((dxgi_format && format->dxgi_format == dxgi_format) || (vk_format && format->vk_format == vk_format)){
+            image->format = format->format;
+            image->family = format->family;
+            image->block_width = image->block_height = format->block_size ? 4 : 1;
+            image->block_size = format->block_size ? format->block_size : 4;
+            return GGT_SUCCESS;
+        }
+    }
+    return GGT_FAILURE;
+}
+
+int _ggtgl_level_width(const _ggtgl_image *image, int level){
+    return (image->width >> level) ? (image->width >> level) : 1;
+}
+
+int _ggtgl_level_height(const _ggtgl_image *image, int level){
+    return (image->height >> level) ? (image->height >> level) : 1;
+}
+
+// Rows of pixels, or of blocks for compressed formats
+int _ggtgl_level_rows(const _ggtgl_image *image, int level){
+    return (_ggtgl_level_height(image, level) + image->block_height - 1) / image->block_height;
+}
+
+size_t _ggtgl_row_size(const _ggtgl_image *image, int level){
+    return (size_t)((_ggtgl_level_width(image, level) + image->block_width - 1) / image->block_width) * image->block_size;
+}
+
+size_t _ggtgl_level_size(const _ggtgl_image *image, int level){
+    return _ggtgl_row_size(image, level) * _ggtgl_level_rows(image, level);
+}
+
+size_t _ggtgl_level_offset(const _ggtgl_image *image, int level){
+    size_t offset = 0;
+    for(int i = 0; i < level; i++)
+        offset += _ggtgl_level_size(image, i);
+    return offset;
+}
+
+// Filled on the GL thread by _ggtgl_detect_texture_formats, so the decode
+// threads can read it. A bit per _ggtgl_format_family
+ggt_u32 _ggtgl_supported_formats;
+
+void _ggtgl_detect_texture_formats(void){
+    if(_ggtgl_supported_formats)
+        return;
+    ggt_u32 supported = 1 << _GGTGL_FORMAT_PLAIN;
+    if(ggtgl_has_extension("GL_EXT_texture_compression_s3tc") || ggtgl_has_extension("GL_WEBGL_compressed_texture_s3tc")){
+        supported |= 1 << _GGTGL_FORMAT_S3TC;
+        if(ggtgl_has_extension("GL_EXT_texture_sRGB") || ggtgl_has_extension("GL_EXT_texture_compression_s3tc_srgb") ||
+           ggtgl_has_extension("GL_WEBGL_compressed_texture_s3tc_srgb"))
+            supported |= 1 << _GGTGL_FORMAT_S3TC_SRGB;
+    }
+#ifndef GGTGL_OPENGL_ES
+    int version = ggtgl_version();
+    if(version >= 30)
+        supported |= 1 << _GGTGL_FORMAT_RGTC;
+    if(version >= 42)
+        supported |= 1 << _GGTGL_FORMAT_BPTC;
+    if(version >= 43)
+        supported |= 1 << _GGTGL_FORMAT_ETC2;
+#endif
+    if(ggtgl_has_extension("GL_ARB_texture_compression_rgtc") || ggtgl_has_extension("GL_EXT_texture_compression_rgtc"))
+        supported |= 1 << _GGTGL_FORMAT_RGTC;
+    if(ggtgl_has_extension("GL_ARB_texture_compression_bptc") || ggtgl_has_extension("GL_EXT_texture_compression_bptc"))
+        supported |= 1 << _GGTGL_FORMAT_BPTC;
+    if(ggtgl_has_extension("GL_ARB_ES3_compatibility") || ggtgl_has_extension("GL_WEBGL_compressed_texture_etc"))
+        supported |= 1 << _GGTGL_FORMAT_ETC2;
+    if(ggtgl_has_extension("GL_KHR_texture_compression_astc_ldr") || ggtgl_has_extension("GL_WEBGL_compressed_texture_astc"))
+        supported |= 1 << _GGTGL_FORMAT_ASTC;
+    _ggtgl_supported_formats = supported;
+}
+
+int ggtgl_supports_compressed_format(GLenum format){
+    _ggtgl_detect_texture_formats();
+    for(size_t i = 0; i < sizeof(_ggtgl_texture_formats) / sizeof(_ggtgl_texture_formats[0]); i++)
+        if(_ggtgl_texture_formats[i].format == format)
+            return (_ggtgl_supported_formats >> _ggtgl_texture_formats[i].family) & 1;
+    if(format >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR && format < GL_COMPRESSED_RGBA_ASTC_4x4_KHR + 14)
+        return (_ggtgl_supported_formats >> _GGTGL_FORMAT_ASTC) & 1;
+    if(format >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR && format < GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR + 14)
+        return (_ggtgl_supported_formats >> _GGTGL_FORMAT_ASTC) & 1;
+    return 0;
+}
+
+//
+// DDS and KTX2
+//
+
+ggt_u32 _ggtgl_read_u32(const unsigned char *data){
+    return (ggt_u32)data[0] | ((ggt_u32)data[1] << 8) | ((ggt_u32)data[2] << 16) | ((ggt_u32)data[3] << 24);
+}
+
+ggt_u64 _ggtgl_read_u64(const unsigned char *data){
+    return (ggt_u64)_ggtgl_read_u32(data) | ((ggt_u64)_ggtgl_read_u32(data + 4) << 32);
+}
+
+#define _GGTGL_FOURCC(a, b, c, d) ((ggt_u32)(a) | ((ggt_u32)(b) << 8) | ((ggt_u32)(c) << 16) | ((ggt_u32)(d) << 24))
+
+// Copies the levels out of the file. Levels are found in order by offset
+// or, when offsets is NULL, one after the other from data
+int _ggtgl_copy_levels(_ggtgl_image *image, const unsigned char *file, size_t file_size, size_t data_offset, const ggt_u64 *offsets){
+    size_t total_size = _ggtgl_level_offset(image, image->levels);
+    image->pixels = (unsigned char *)malloc(total_size);
+    if(!image->pixels)
+        return GGT_FAILURE;
+    size_t offset = data_offset;
+    for(int level = 0; level < image->levels; level++){
+        size_t size = _ggtgl_level_size(image, level);
+        if(offsets)
+            offset = (size_t)offsets[level];
+        if(offset > file_size || size > file_size - offset){
+            free(image->pixels);
+            image->pixels = NULL;
+            return GGT_FAILURE;
+        }
+        memcpy(image->pixels + _ggtgl_level_offset(image, level), file + offset, size);
+        offset += size;
+    }
+    return GGT_SUCCESS;
+}
+
+// Checked before anything is sized from the header: a level count past the
+// 1x1 level would make level sizes of 0
+int _ggtgl_valid_image_size(const _ggtgl_image *image){
+    if(image->width <= 0 || image->height <= 0)
+        return GGT_FAILURE;
+    int largest = (image->width > image->height) ? image->width : image->height;
+    int max_levels = 1;
+    while(largest >>= 1)
+        max_levels++;
+    return (image->levels <= max_levels) ? GGT_SUCCESS : GGT_FAILURE;
+}
+
+int _ggtgl_parse_dds(_ggtgl_image *image, const unsigned char *file, size_t size, const char *path){
+    if(size < 128 || _ggtgl_read_u32(file) != _GGTGL_FOURCC('D', 'D', 'S', ' ') || _ggtgl_read_u32(file + 4) != 124){
+        printf("ggtgl_load_compressed_texture error: %s isn't a DDS file\n", path);
+        return GGT_FAILURE;
+    }
+    const unsigned char *header = file + 4;
+    image->height = (int)_ggtgl_read_u32(header + 8);
+    image->width = (int)_ggtgl_read_u32(header + 12);
+    image->levels = (int)_ggtgl_read_u32(header + 24);
+    image->levels = image->levels ? image->levels : 1;
+    if(!_ggtgl_valid_image_size(image)){
+        printf("ggtgl_load_compressed_texture error: %s has a bad size or level count\n", path);
+        return GGT_FAILURE;
+    }
+    ggt_u32 flags = _ggtgl_read_u32(header + 76);
+    ggt_u32 fourcc = _ggtgl_read_u32(header + 80);
+    ggt_u32 caps2 = _ggtgl_read_u32(header + 108);
+    size_t data_offset = 128;
+    
+    ggt_u32 dxgi_format = 0;
+    int opaque = 0;
+    if((flags & 0x4) && fourcc == _GGTGL_FOURCC('D', 'X', '1', '0')){
+        if(size < 148){
+            printf("ggtgl_load_compressed_texture error: %s is truncated\n", path);
+            return GGT_FAILURE;
+        }
+        dxgi_format = _ggtgl_read_u32(file + 128);
+        if(_ggtgl_read_u32(file + 132) != 3 || (_ggtgl_read_u32(file + 136) & 0x4) || _ggtgl_read_u32(file + 140) > 1)
+            caps2 |= 0x200; // Not a single 2D texture
+        data_offset = 148;
+    }else if(flags & 0x4){
+        if(fourcc == _GGTGL_FOURCC('D', 'X', 'T', '1')) dxgi_format = 71;
+        else if(fourcc == _GGTGL_FOURCC('D', 'X', 'T', '3')) dxgi_format = 74;
+        else if(fourcc == _GGTGL_FOURCC('D', 'X', 'T', '5')) dxgi_format = 77;
+        else if(fourcc == _GGTGL_FOURCC('A', 'T', 'I', '1') || fourcc == _GGTGL_FOURCC('B', 'C', '4', 'U')) dxgi_format = 80;
+        else if(fourcc == _GGTGL_FOURCC('A', 'T', 'I', '2') || fourcc == _GGTGL_FOURCC('B', 'C', '5', 'U')) dxgi_format = 83;
+    }else if((flags & 0x40) && _ggtgl_read_u32(header + 84) == 32 && _ggtgl_read_u32(header + 88) == 0xFF &&
+             _ggtgl_read_u32(header + 92) == 0xFF00 && _ggtgl_read_u32(header + 96) == 0xFF0000){
+        dxgi_format = 28; // Only uncompressed layout that is uploaded as it is
+        // X8R8G8B8 style files leave the alpha byte undefined
+        opaque = !(flags & 0x1) || _ggtgl_read_u32(header + 100) != 0xFF000000;
+    }
+    
+    if(caps2 & (0x200 | 0x200000)){
+        printf("ggtgl_load_compressed_texture error: %s isn't a 2D texture\n", path);
+        return GGT_FAILURE;
+    }
+    if(!dxgi_format || !_ggtgl_find_texture_format(image, dxgi_format, 0)){
+        printf("ggtgl_load_compressed_texture error: %s has an unsupported format\n", path);
+        return GGT_FAILURE;
+    }
+    if(!_ggtgl_copy_levels(image, file, size, data_offset, NULL)){
+        printf("ggtgl_load_compressed_texture error: %s is truncated\n", path);
+        return GGT_FAILURE;
+    }
+    if(opaque){
+        size_t total = _ggtgl_level_offset(image, image->levels);
+        for(size_t i = 3; i < total; i += 4)
+            image->pixels[i] = 255;
+    }
+    return GGT_SUCCESS;
+}
+
+int _ggtgl_parse_ktx2(_ggtgl_image *image, const unsigned char *file, size_t size, const char *path){
+    static const unsigned char identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    if(size < 80 || memcmp(file, identifier, 12) != 0){
+        printf("ggtgl_load_compressed_texture error: %s isn't a KTX2 file\n", path);
+        return GGT_FAILURE;
+    }
+    ggt_u32 vk_format = _ggtgl_read_u32(file + 12);
+    image->width = (int)_ggtgl_read_u32(file + 20);
+    image->height = (int)_ggtgl_read_u32(file + 24);
+    ggt_u32 depth = _ggtgl_read_u32(file + 28);
+    ggt_u32 layers = _ggtgl_read_u32(file + 32);
+    ggt_u32 faces = _ggtgl_read_u32(file + 36);
+    image->levels = (int)_ggtgl_read_u32(file + 40);
+    image->levels = image->levels ? image->levels : 1;
+    ggt_u32 supercompression = _ggtgl_read_u32(file + 44);
+    
+    if(depth > 0 || layers > 0 || faces > 1 || image->height == 0){
+        printf("ggtgl_load_compressed_texture error: %s isn't a 2D texture\n", path);
+        return GGT_FAILURE;
+    }
+    if(!_ggtgl_valid_image_size(image)){
+        printf("ggtgl_load_compressed_texture error: %s has a bad size or level count\n", path);
+        return GGT_FAILURE;
+    }
+    if(supercompression != 0){
+        printf("ggtgl_load_compressed_texture error: %s is supercompressed (e.g. Basis), transcode it to a GPU format offline\n", path);
+        return GGT_FAILURE;
+    }
+    if(!vk_format || !_ggtgl_find_texture_format(image, 0, vk_format)){
+        printf("ggtgl_load_compressed_texture error: %s has an unsupported format\n", path);
+        return GGT_FAILURE;
+    }
+    if(size < 80 + (size_t)image->levels * 24 || image->levels > 32){
+        printf("ggtgl_load_compressed_texture error: %s is truncated\n", path);
+        return GGT_FAILURE;
+    }
+    
+    ggt_u64 offsets[32];
+    for(int level = 0; level < image->levels; level++){
+        offsets[level] = _ggtgl_read_u64(file + 80 + level * 24);
+        if(_ggtgl_read_u64(file + 80 + level * 24 + 8) != _ggtgl_level_size(image, level)){
+            printf("ggtgl_load_compressed_texture error: %s has a level of the wrong size\n", path);
+            return GGT_FAILURE;
+        }
+    }
+    if(!_ggtgl_copy_levels(image, file, size, 0, offsets)){
+        printf("ggtgl_load_compressed_texture error: %s is truncated\n", path);
+        return GGT_FAILURE;
+    }
+    return GGT_SUCCESS;
+}
+
+//
+// BC1-5 decoding, for drivers without them
+//
+
+void _ggtgl_decode_color_block(const unsigned char *block, unsigned char texels[16][4], int three_color_mode){
+    unsigned char colors[4][4];
+    ggt_u32 endpoints[2] = {(ggt_u32)block[0] | ((ggt_u32)block[1] << 8), (ggt_u32)block[2] | ((ggt_u32)block[3] << 8)};
+    for(int i = 0; i < 2; i++){
+        ggt_u32 r = (endpoints[i] >> 11) & 31, g = (endpoints[i] >> 5) & 63, b = endpoints[i] & 31;
+        colors[i][0] = (unsigned char)((r << 3) | (r >> 2));
+        colors[i][1] = (unsigned char)((g << 2) | (g >> 4));
+        colors[i][2] = (unsigned char)((b << 3) | (b >> 2));
+        colors[i][3] = 255;
+    }
+    for(int c = 0; c < 3; c++){
+        if(endpoints[0] > endpoints[1] || !three_color_mode){
+            colors[2][c] = (unsigned char)((2 * colors[0][c] + colors[1][c] + 1) / 3);
+            colors[3][c] = (unsigned char)((colors[0][c] + 2 * colors[1][c] + 1) / 3);
+        }else{
+            colors[2][c] = (unsigned char)((colors[0][c] + colors[1][c]) / 2);
+            colors[3][c] = 0;
+        }
+    }
+    colors[2][3] = 255;
+    colors[3][3] = (endpoints[0] > endpoints[1] || !three_color_mode) ? 255 : 0;
+    
+    ggt_u32 indices = _ggtgl_read_u32(block + 4);
+    for(int i = 0; i < 16; i++)
+        memcpy(texels[i], colors[(indices >> (i * 2)) & 3], 4);
+}
+
+// BC3 alpha and BC4/BC5 channels. Writes channel of each texel
+void _ggtgl_decode_channel_block(const unsigned char *block, unsigned char texels[16][4], int channel){
+    int values[8];
+    values[0] = block[0];
+    values[1] = block[1];
+    if(values[0] > values[1]){
+        for(int i = 2; i < 8; i++)
+            values[i] = ((8 - i) * values[0] + (i - 1) * values[1] + 3) / 7;
+    }else{
+        for(int i = 2; i < 6; i++)
+            values[i] = ((6 - i) * values[0] + (i - 1) * values[1] + 2) / 5;
+        values[6] = 0;
+        values[7] = 255;
+    }
+    ggt_u64 indices = 0;
+    for(int i = 0; i < 6; i++)
+        indices |= (ggt_u64)block[2 + i] << (i * 8);
+    for(int i = 0; i < 16; i++)
+        texels[i][channel] = (unsigned char)values[(indices >> (i * 3)) & 7];
+}
+
+// Replaces the BC1-5 levels of image with RGBA ones. Returns GGT_FAILURE for
+// the formats it can't decode
+int _ggtgl_decompress_image(_ggtgl_image *image){
+    _ggtgl_image decoded = *image;
+    decoded.format = (image->family == _GGTGL_FORMAT_S3TC_SRGB) ? GL_SRGB8_ALPHA8 : GL_RGBA;
+    decoded.family = _GGTGL_FORMAT_PLAIN;
+    decoded.block_width = decoded.block_height = 1;
+    decoded.block_size = 4;
+    
+    GLenum format = image->format;
+    int bc1 = (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ||
+               format == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT);
+    int bc2 = (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT);
+    int bc3 = (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT || format == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT);
+    int bc4 = (format == GL_COMPRESSED_RED_RGTC1);
+    int bc5 = (format == GL_COMPRESSED_RG_RGTC2);
+    if(!bc1 && !bc2 && !bc3 && !bc4 && !bc5)
+        return GGT_FAILURE;
+    decoded.pixels = (unsigned char *)malloc(_ggtgl_level_offset(&decoded, decoded.levels));
+    if(!decoded.pixels)
+        return GGT_FAILURE;
+    
+    for(int level = 0; level < image->levels; level++){
+        const unsigned char *block = image->pixels + _ggtgl_level_offset(image, level);
+        unsigned char *destination = decoded.pixels + _ggtgl_level_offset(&decoded, level);
+        int width = _ggtgl_level_width(image, level), height = _ggtgl_level_height(image, level);
+        for(int y = 0; y < height; y += 4){
+            for(int x = 0; x < width; x += 4, block += image->block_size){
+                unsigned char texels[16][4];
+                if(bc4 || bc5){
+                    memset(texels, 0, sizeof(texels));
+                    _ggtgl_decode_channel_block(block, texels, 0);
+                    if(bc5)
+                        _ggtgl_decode_channel_block(block + 8, texels, 1);
+                    for(int i = 0; i < 16; i++)
+                        texels[i][3] = 255;
+                }else{
+                    _ggtgl_decode_color_block(block + (bc1 ? 0 : 8), texels, bc1);
+                    if(bc2)
+                        for(int i = 0; i < 16; i++)
+                            texels[i][3] = (unsigned char)(((block[i / 2] >> ((i % 2) * 4)) & 15) * 17);
+                    if(bc3)
+                        _ggtgl_decode_channel_block(block, texels, 3);
+                }
+                for(int row = 0; row < 4 && y + row < height; row++)
+                    for(int column = 0; column < 4 && x + column < width; column++)
+                        memcpy(destination + ((size_t)(y + row) * width + x + column) * 4, texels[row * 4 + column], 4);
+            }
+        }
+    }
+    free(image->pixels);
+    *image = decoded;
+    return GGT_SUCCESS;
+}
+
+int _ggtgl_is_container(const char *path){
+    const char *extension = strrchr(path, '.');
+    return extension && (!strcmp(extension, ".dds") || !strcmp(extension, ".DDS") ||
+                         !strcmp(extension, ".ktx2") || !strcmp(extension, ".KTX2"));
+}
+
+// DDS or KTX2, decoded to RGBA when the driver can't take the format.
+// Needs _ggtgl_detect_texture_formats to have run on the GL thread
+int _ggtgl_read_container(const char *path, _ggtgl_image *image){
+    FILE *file = fopen(path, "rb");
+    if(!file){
+        printf("ggtgl_load_compressed_texture error: Couldn't open %s\n", path);
+        return GGT_FAILURE;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = (unsigned char *)malloc(size > 0 ? (size_t)size : 1);
+    size_t read = fread(data, 1, (size_t)(size > 0 ? size : 0), file);
+    fclose(file);
+    
+    const char *extension = strrchr(path, '.');
+    int result = (extension[1] == 'd' || extension[1] == 'D') ? _ggtgl_parse_dds(image, data, read, path) : _ggtgl_parse_ktx2(image, data, read, path);
+    free(data);
+    if(!result)
+        return GGT_FAILURE;
+    
+    if(!((_ggtgl_supported_formats >> image->family) & 1)){
+        if(!_ggtgl_decompress_image(image)){
+            printf("ggtgl_load_compressed_texture error: The driver can't sample the format of %s (0x%x)\n", path, image->format);
+            free(image->pixels);
+            return GGT_FAILURE;
+        }
+    }
+    return GGT_SUCCESS;
+}
+
+// Decodes with stb_image as RGBA, flipping the rows while copying them out,
+// and builds the mipmaps with a box filter. DDS and KTX2 files are read as
+// they are instead
+int _ggtgl_decode_image(const char *path, _ggtgl_image *image){
+    memset(image, 0, sizeof(_ggtgl_image));
+    if(_ggtgl_is_container(path))
+        return _ggtgl_read_container(path, image);
+#ifdef STBI_INCLUDE_STB_IMAGE_H
+    int width, height, channels;
+    unsigned char *decoded = stbi_load(path, &width, &height, &channels, 4);
+    if(decoded == NULL)
+        return GGT_FAILURE;
+    
+    image->width = width;
+    image->height = height;
+    image->format = GL_RGBA;
+    image->family = _GGTGL_FORMAT_PLAIN;
+    image->block_width = image->block_height = 1;
+    image->block_size = 4;
+    image->levels = 1;
+    while((width >> image->levels) || (height >> image->levels))
+        image->levels++;
+    image->pixels = (unsigned char *)malloc(_ggtgl_level_offset(image, image->levels));
+    if(!image->pixels){
+        stbi_image_free(decoded);
+        return GGT_FAILURE;
+    }
+    
+    size_t row_size = (size_t)width * 4;
+    for(int y = 0; y < height; y++)
+        memcpy(image->pixels + y * row_size, decoded + (height - 1 - y) * row_size, row_size);
+    stbi_image_free(decoded);
+    
+    for(int level = 1; level < image->levels; level++){
+        const unsigned char *source = image->pixels + _ggtgl_level_offset(image, level - 1);
+        unsigned char *destination = image->pixels + _ggtgl_level_offset(image, level);
+        int source_width = _ggtgl_level_width(image, level - 1), source_height = _ggtgl_level_height(image, level - 1);
+        int level_width = _ggtgl_level_width(image, level), level_height = _ggtgl_level_height(image, level);
+        for(int y = 0; y < level_height; y++){
+            const unsigned char *row0 = source + (size_t)(y * 2) * source_width * 4;
+            const unsigned char *row1 = source + (size_t)(y * 2 + 1 < source_height ? y * 2 + 1 : y * 2) * source_width * 4;
+            unsigned char *out = destination + (size_t)y * level_width * 4;
+            for(int x = 0; x < level_width; x++){
+                int x0 = x * 2 * 4;
+                int x1 = (x * 2 + 1 < source_width ? x * 2 + 1 : x * 2) * 4;
+                for(int c = 0; c < 4; c++)
+                    out[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+    return GGT_SUCCESS;
+#else
+    printf("ggtgl_load_texture_async error: %s needs stb_image.h\n", path);
+    return GGT_FAILURE;
+#endif
+}
+
+// Specifies a level of the bound GL_TEXTURE_2D. NULL pixels only allocate it
+void _ggtgl_specify_level(const _ggtgl_image *image, int level, const void *pixels){
+    int width = _ggtgl_level_width(image, level), height = _ggtgl_level_height(image, level);
+    if(image->family == _GGTGL_FORMAT_PLAIN){
+        glTexImage2D(GL_TEXTURE_2D, level, image->format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }else{
+#ifdef GGTGL_OPENGL_ES
+        // WebGL doesn't take NULL here, so allocate every level at once instead
+        if(!pixels){
+            if(level == 0)
+                glTexStorage2D(GL_TEXTURE_2D, image->levels, image->format, width, height);
+            return;
+        }
+#endif
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, image->format, width, height, 0, (GLsizei)_ggtgl_level_size(image, level), pixels);
+    }
+}
+
+// Uploads rows (of blocks, for compressed formats) into a level of the bound
+// GL_TEXTURE_2D. pixels can be an offset into a bound pixel unpack buffer
+void _ggtgl_upload_rows(const _ggtgl_image *image, int level, int row, int rows, const void *pixels){
+    int width = _ggtgl_level_width(image, level);
+    int y = row * image->block_height;
+    int height = rows * image->block_height;
+    if(y + height > _ggtgl_level_height(image, level))
+        height = _ggtgl_level_height(image, level) - y;
+    if(image->family == _GGTGL_FORMAT_PLAIN)
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    else
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, height, image->format, (GLsizei)(rows * _ggtgl_row_size(image, level)), pixels);
+}
+
+// GL_TEXTURE_BASE_LEVEL and GL_TEXTURE_MAX_LEVEL, which OpenGL ES 2 and WebGL 1 lack
+int _ggtgl_has_texture_levels(void){
+#ifdef GGTGL_OPENGL_ES
+    static int supported = -1;
+    if(supported < 0)
+        supported = ggtgl_version() >= 30;
+    return supported;
+#else
+    return 1;
+#endif
+}
+
+int _ggtgl_has_pixel_buffers(void){
+    static int supported = -1;
+    if(supported < 0){
+#ifdef GGTGL_OPENGL_ES
+        supported = ggtgl_version() >= 30;
+#else
+        supported = ggtgl_version() >= 21 || ggtgl_has_extension("GL_ARB_pixel_buffer_object");
+#endif
+    }
+    return supported;
+}
+
+// Sets up the bound GL_TEXTURE_2D with every level of the image
+void _ggtgl_specify_texture(const _ggtgl_image *image){
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (image->levels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if(_ggtgl_has_texture_levels())
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image->levels - 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for(int level = 0; level < image->levels; level++)
+        _ggtgl_specify_level(image, level, image->pixels + _ggtgl_level_offset(image, level));
+}
+
+int _ggtgl_create_texture(GLuint *texture, const _ggtgl_image *image){
+    glGenTextures(1, texture);
+    _ggtgl_bind_texture_2d(*texture);
+    _ggtgl_specify_texture(image);
+    return GGT_SUCCESS;
+}
+
+#ifdef STBI_INCLUDE_STB_IMAGE_H
+void ggtgl_load_texture(GLuint *texture, const char *path){
+    _ggtgl_image image;
+    _ggtgl_detect_texture_formats();
+    if(!_ggtgl_decode_image(path, &image)){
+        printf("ggtgl_load_texture error: Couldn't load image\n");
+        return;
+    }
+    _ggtgl_create_texture(texture, &image);
+    free(image.pixels);
+}
+#endif
+
+int ggtgl_load_compressed_texture(GLuint *texture, const char *path){
+    _ggtgl_image image;
+    memset(&image, 0, sizeof(_ggtgl_image));
+    _ggtgl_detect_texture_formats();
+    if(!_ggtgl_is_container(path)){
+        printf("ggtgl_load_compressed_texture error: %s isn't a .dds or .ktx2 file\n", path);
+        return GGT_FAILURE;
+    }
+    if(!_ggtgl_read_container(path, &image))
+        return GGT_FAILURE;
+    _ggtgl_create_texture(texture, &image);
+    free(image.pixels);
+    return GGT_SUCCESS;
+}
+
+typedef enum {
+    _GGTGL_TEXTURE_FREE,
+    _GGTGL_TEXTURE_QUEUED,
+    _GGTGL_TEXTURE_DECODING,
+    _GGTGL_TEXTURE_DECODED,
+    _GGTGL_TEXTURE_FAILED,
+} _ggtgl_texture_load_state;
+
+typedef struct {
+    char path[1024];
+    GLuint texture;
+    _ggtgl_texture_load_state state;
+    _ggtgl_image image;
+    int level, row; // Next to upload, going from the smallest level up
+} _ggtgl_texture_load;
+
+struct {
+    _ggtgl_texture_load loads[GGTGL_MAX_TEXTURE_LOADS];
+    ggt_u32 lock; // Guards the states and stopping, the rest belongs to whoever moved it last
+    ggt_semaphore work;
+    ggt_thread threads[GGTGL_TEXTURE_THREADS];
+    int thread_count;
+    int stopping;
+    int started;
+    int frame_spent; // By a row too big for the ring, see _ggtgl_upload_texture_load
+    int pixel_buffers; // Otherwise every level goes straight from memory at once
+    ggtgl_stream_buffer upload;
+} _ggtgl_texture_state;
+
+// Takes the next queued load. Returns NULL if there isn't one
+_ggtgl_texture_load *_ggtgl_next_texture_load(void){
+    _ggtgl_texture_load *load = NULL;
+    _ggt_platform_lock(&_ggtgl_texture_state.lock);
+    for(int i = 0; i < GGTGL_MAX_TEXTURE_LOADS && !load; i++){
+        if(_ggtgl_texture_state.loads[i].state == _GGTGL_TEXTURE_QUEUED){
+            load = &_ggtgl_texture_state.loads[i];
+            load->state = _GGTGL_TEXTURE_DECODING;
+        }
+    }
+    _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+    return load;
+}
+
+void _ggtgl_decode_texture_load(_ggtgl_texture_load *load){
+    int result = _ggtgl_decode_image(load->path, &load->image);
+    if(result){
+        load->level = load->image.levels - 1;
+        load->row = 0;
+    }else{
+        printf("ggtgl_load_texture_async error: Couldn't load %s\n", load->path);
+    }
+    _ggt_platform_lock(&_ggtgl_texture_state.lock);
+    load->state = result ? _GGTGL_TEXTURE_DECODED : _GGTGL_TEXTURE_FAILED;
+    _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+}
+
+int _ggtgl_texture_worker(void *data){
+    while(1){
+        ggtp_semaphore_wait(_ggtgl_texture_state.work, -1);
+        _ggt_platform_lock(&_ggtgl_texture_state.lock);
+        int stopping = _ggtgl_texture_state.stopping;
+        _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+        if(stopping)
+            break;
+        _ggtgl_texture_load *load = _ggtgl_next_texture_load();
+        if(load)
+            _ggtgl_decode_texture_load(load);
+    }
+    return 0;
+}
+
+void _ggtgl_start_texture_loads(void){
+    _ggtgl_detect_texture_formats();
+    // WebGL 1 and OpenGL ES 2 have no pixel unpack buffers
+    if(_ggtgl_has_pixel_buffers()){
+        _ggtgl_texture_state.pixel_buffers = ggtgl_stream_buffer_create(&_ggtgl_texture_state.upload, GL_PIXEL_UNPACK_BUFFER,
+                                                                        GGTGL_TEXTURE_UPLOAD_SIZE);
+        if(!_ggtgl_texture_state.pixel_buffers)
+            ggtgl_stream_buffer_destroy(&_ggtgl_texture_state.upload);
+        _ggtgl_bind_buffer_now(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    
+    // Without threads (e.g. emscripten) ggtgl_update_textures decodes them
+    _ggtgl_texture_state.stopping = 0;
+    _ggtgl_texture_state.work = ggtp_create_semaphore(0);
+    for(int i = 0; i < GGTGL_TEXTURE_THREADS && _ggtgl_texture_state.work; i++){
+        ggt_thread thread = ggtp_create_thread(_ggtgl_texture_worker, NULL, "ggtgl_texture_worker");
+        if(!thread)
+            break;
+        _ggtgl_texture_state.threads[_ggtgl_texture_state.thread_count++] = thread;
+    }
+}
+
+GLuint ggtgl_load_texture_async(const char *path){
+    if(strlen(path) >= sizeof(_ggtgl_texture_state.loads[0].path)){
+        printf("ggtgl_load_texture_async error: Path too long\n");
+        return 0;
+    }
+    if(!_ggtgl_texture_state.started){
+        _ggtgl_start_texture_loads();
+        _ggtgl_texture_state.started = 1;
+    }
+    
+    _ggt_platform_lock(&_ggtgl_texture_state.lock);
+    _ggtgl_texture_load *load = NULL;
+    for(int i = 0; i < GGTGL_MAX_TEXTURE_LOADS && !load; i++)
+        if(_ggtgl_texture_state.loads[i].state == _GGTGL_TEXTURE_FREE)
+            load = &_ggtgl_texture_state.loads[i];
+    if(!load){
+        _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+        printf("ggtgl_load_texture_async error: Too many textures loading, increase GGTGL_MAX_TEXTURE_LOADS\n");
+        return 0;
+    }
+    
+    GLuint previous = _ggtgl_bound_texture_2d();
+    glGenTextures(1, &load->texture);
+    _ggtgl_bind_texture_2d(load->texture);
+    ggt_u32 placeholder = GGTGL_TEXTURE_PLACEHOLDER;
+    unsigned char color[4] = {(unsigned char)placeholder, (unsigned char)(placeholder >> 8),
+                              (unsigned char)(placeholder >> 16), (unsigned char)(placeholder >> 24)};
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, color);
+    _ggtgl_bind_texture_2d(previous);
+    
+    strcpy(load->path, path);
+    memset(&load->image, 0, sizeof(_ggtgl_image));
+    load->state = _GGTGL_TEXTURE_QUEUED;
+    GLuint texture = load->texture;
+    _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+    if(_ggtgl_texture_state.thread_count)
+        ggtp_semaphore_post(_ggtgl_texture_state.work);
+    return texture;
+}
+
+// Uploads what fits in this frame's part of the ring. Returns GGT_SUCCESS
+// when the whole texture is in
+int _ggtgl_upload_texture_load(_ggtgl_texture_load *load){
+    _ggtgl_image *image = &load->image;
+    ggtgl_stream_buffer *upload = &_ggtgl_texture_state.upload;
+    _ggtgl_bind_texture_2d(load->texture);
+    if(load->level == image->levels - 1 && load->row == 0){
+        // Replaces the placeholder. Only the levels that are in get sampled
+        for(int level = 0; level < image->levels; level++)
+            _ggtgl_specify_level(image, level, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (image->levels > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, image->levels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image->levels - 1);
+    }
+    
+    while(load->level >= 0){
+        if(_ggtgl_texture_state.frame_spent)
+            return GGT_FAILURE;
+        int height = _ggtgl_level_rows(image, load->level);
+        size_t row_size = _ggtgl_row_size(image, load->level);
+        int rows = (int)((size_t)(upload->frame_size - upload->offset) / row_size);
+        if(rows > height - load->row)
+            rows = height - load->row;
+        
+        const unsigned char *pixels = image->pixels + _ggtgl_level_offset(image, load->level) + load->row * row_size;
+        if(rows > 0){
+            GLintptr offset = ggtgl_stream_buffer_write(upload, pixels, rows * row_size);
+            if(offset < 0)
+                return GGT_FAILURE;
+            _ggtgl_upload_rows(image, load->level, load->row, rows, (void *)offset);
+        }else if(row_size > (size_t)upload->frame_size && !upload->offset){
+            // A row that never fits in the ring goes straight from memory,
+            // alone in its frame
+            _ggtgl_bind_buffer_now(GL_PIXEL_UNPACK_BUFFER, 0);
+            _ggtgl_upload_rows(image, load->level, load->row, 1, pixels);
+            _ggtgl_texture_state.frame_spent = 1;
+            rows = 1;
+        }else{
+            return GGT_FAILURE; // Out of room for this frame
+        }
+        
+        load->row += rows;
+        if(load->row == height){
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, load->level);
+            load->level--;
+            load->row = 0;
+        }
+    }
+    return GGT_SUCCESS;
+}
+
+void ggtgl_update_textures(void){
+    if(!_ggtgl_texture_state.started)
+        return;
+    if(!_ggtgl_texture_state.thread_count){
+        _ggtgl_texture_load *load = _ggtgl_next_texture_load();
+        if(load)
+            _ggtgl_decode_texture_load(load);
+    }
+    
+    GLuint previous = _ggtgl_bound_texture_2d();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    _ggtgl_texture_state.frame_spent = 0;
+    int uploaded = 0;
+    for(int i = 0; i < GGTGL_MAX_TEXTURE_LOADS; i++){
+        _ggtgl_texture_load *load = &_ggtgl_texture_state.loads[i];
+        _ggt_platform_lock(&_ggtgl_texture_state.lock);
+        _ggtgl_texture_load_state state = load->state;
+        _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+        
+        if(state == _GGTGL_TEXTURE_DECODED && !_ggtgl_texture_state.pixel_buffers){
+            // One whole texture per frame
+            if(uploaded)
+                break;
+            uploaded = 1;
+            _ggtgl_bind_texture_2d(load->texture);
+            _ggtgl_specify_texture(&load->image);
+            free(load->image.pixels);
+        }else if(state == _GGTGL_TEXTURE_DECODED){
+            uploaded = 1;
+            if(!_ggtgl_upload_texture_load(load))
+                break;
+            free(load->image.pixels);
+        }else if(state != _GGTGL_TEXTURE_FAILED){
+            continue;
+        }
+        _ggt_platform_lock(&_ggtgl_texture_state.lock);
+        load->state = _GGTGL_TEXTURE_FREE;
+        _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+    }
+    if(uploaded && _ggtgl_texture_state.pixel_buffers){
+        _ggtgl_bind_buffer_now(GL_PIXEL_UNPACK_BUFFER, 0);
+        ggtgl_stream_buffer_end_frame(&_ggtgl_texture_state.upload);
+    }
+    _ggtgl_bind_texture_2d(previous);
+}
+
+int ggtgl_textures_loading(void){
+    int loading = 0;
+    if(!_ggtgl_texture_state.started)
+        return 0;
+    _ggt_platform_lock(&_ggtgl_texture_state.lock);
+    for(int i = 0; i < GGTGL_MAX_TEXTURE_LOADS; i++)
+        loading += (_ggtgl_texture_state.loads[i].state != _GGTGL_TEXTURE_FREE);
+    _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+    return loading;
+}
+
+void ggtgl_stop_texture_loads(void){
+    if(!_ggtgl_texture_state.started)
+        return;
+    _ggt_platform_lock(&_ggtgl_texture_state.lock);
+    _ggtgl_texture_state.stopping = 1;
+    _ggt_platform_unlock(&_ggtgl_texture_state.lock);
+    for(int i = 0; i < _ggtgl_texture_state.thread_count; i++)
+        ggtp_semaphore_post(_ggtgl_texture_state.work);
+    for(int i = 0; i < _ggtgl_texture_state.thread_count; i++)
+        ggtp_wait_thread(_ggtgl_texture_state.threads[i]);
+    _ggtgl_texture_state.thread_count = 0;
+    if(_ggtgl_texture_state.work)
+        ggtp_destroy_semaphore(_ggtgl_texture_state.work);
+    _ggtgl_texture_state.work = 0;
+    
+    for(int i = 0; i < GGTGL_MAX_TEXTURE_LOADS; i++){
+        _ggtgl_texture_load *load = &_ggtgl_texture_state.loads[i];
+        if(load->state == _GGTGL_TEXTURE_DECODED)
+            free(load->image.pixels);
+        load->state = _GGTGL_TEXTURE_FREE;
+    }
+    if(_ggtgl_texture_state.pixel_buffers)
+        ggtgl_stream_buffer_destroy(&_ggtgl_texture_state.upload);
+    _ggtgl_texture_state.pixel_buffers = 0;
+    _ggtgl_texture_state.started = 0;
+}
+
+#include <math.h>
+
+const char _ggtgl_sprite_vertex_shader[] = ""
+    "uniform mat4 u_projection;\n"
+    "attribute vec2 a_position;\n"
+    "attribute vec2 a_uv;\n"
+    "attribute vec4 a_color;\n"
+    "varying vec2 v_uv;\n"
+    "varying vec4 v_color;\n"
+    "void main(){\n"
+    "    gl_Position = u_projection * vec4(a_position, 0.0, 1.0);\n"
+    "    v_uv = a_uv;\n"
+    "    v_color = a_color;\n"
+    "}\n";
+
+const char _ggtgl_sprite_fragment_shader[] = ""
+    "#ifdef GL_ES\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D u_texture;\n"
+    "varying vec2 v_uv;\n"
+    "varying vec4 v_color;\n"
+    "void main(){\n"
+    "    gl_FragColor = texture2D(u_texture, v_uv) * v_color;\n"
+    "}\n";
+
+int ggtgl_sprite_batch_create(ggtgl_sprite_batch *batch, int max_sprites){
+    memset(batch, 0, sizeof(ggtgl_sprite_batch));
+    if(GGTGL_SPRITE_BATCH_SIZE * 4 > 65536){
+        printf("ggtgl_sprite_batch_create error: GGTGL_SPRITE_BATCH_SIZE is too big for 16 bit indices\n");
+        return GGT_FAILURE;
+    }
+    batch->default_program = ggtgl_load_shaders_by_text(_ggtgl_sprite_vertex_shader, _ggtgl_sprite_fragment_shader);
+    if(!batch->default_program)
+        return GGT_FAILURE;
+    if(ggtgl_stream_buffer_create(&batch->vertices, GL_ARRAY_BUFFER, (size_t)max_sprites * 4 * sizeof(ggtgl_sprite_vertex)) == GGT_FAILURE){
+        glDeleteProgram(batch->default_program);
+        return GGT_FAILURE;
+    }
+    
+    // Every batch uses the same two triangles per quad, so they never change
+    GLushort *indices = (GLushort *)malloc(GGTGL_SPRITE_BATCH_SIZE * 6 * sizeof(GLushort));
+    if(!indices){
+        printf("ggtgl_sprite_batch_create error: Couldn't allocate the indices\n");
+        ggtgl_stream_buffer_destroy(&batch->vertices);
+        glDeleteProgram(batch->default_program);
+        memset(batch, 0, sizeof(ggtgl_sprite_batch));
+        return GGT_FAILURE;
+    }
+    for(int i = 0; i < GGTGL_SPRITE_BATCH_SIZE; i++){
+        GLushort first = (GLushort)(i * 4);
+        GLushort quad[6] = {first, (GLushort)(first + 1), (GLushort)(first + 2), first, (GLushort)(first + 2), (GLushort)(first + 3)};
+        memcpy(indices + i * 6, quad, sizeof(quad));
+    }
+    glGenBuffers(1, &batch->indices);
+    // The element array binding belongs to the bound vertex array, keep it out
+    GLuint previous = 0;
+    if(_ggtgl_has_vertex_arrays()){
+        previous = _ggtgl_bound_vertex_array();
+        _ggtgl_bind_vertex_array_now(0);
+    }
+    _ggtgl_bind_buffer_now(GL_ELEMENT_ARRAY_BUFFER, batch->indices);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GGTGL_SPRITE_BATCH_SIZE * 6 * sizeof(GLushort), indices, GL_STATIC_DRAW);
+    if(_ggtgl_has_vertex_arrays())
+        _ggtgl_bind_vertex_array_now(previous);
+    free(indices);
+    return GGT_SUCCESS;
+}
+
+void ggtgl_sprite_batch_destroy(ggtgl_sprite_batch *batch){
+    for(int i = 0; i < GGTGL_SPRITE_PROGRAMS; i++)
+        if(batch->programs[i].program)
+            ggtgl_vertex_layout_destroy(&batch->programs[i].layout);
+    _ggtgl_state_delete_buffer(batch->indices);
+    glDeleteBuffers(1, &batch->indices);
+    ggtgl_stream_buffer_destroy(&batch->vertices);
+    if(ggtgl_get_state()->program == batch->default_program)
+        ggtgl_use_program(0);
+    glDeleteProgram(batch->default_program);
+    memset(batch, 0, sizeof(ggtgl_sprite_batch));
+}
+
+void ggtgl_sprite_batch_begin(ggtgl_sprite_batch *batch, int width, int height){
+    // Pixels, y down, to clip space
+    float projection[16] = {
+        2.f / width, 0.f, 0.f, 0.f,
+        0.f, -2.f / height, 0.f, 0.f,
+        0.f, 0.f, -1.f, 0.f,
+        -1.f, 1.f, 0.f, 1.f,
+    };
+    memcpy(batch->projection, projection, sizeof(projection));
+    batch->frame++;
+    batch->count = 0;
+    batch->program = batch->default_program;
+    batch->texture = 0;
+    batch->draw_calls = 0;
+    batch->sprites = 0;
+}
+
+// Finds the entry of the program, or replaces the oldest one
+int _ggtgl_sprite_batch_program(ggtgl_sprite_batch *batch, GLuint program){
+    for(int i = 0; i < GGTGL_SPRITE_PROGRAMS; i++)
+        if(batch->programs[i].program == program)
+            return i;
+    
+    int index = batch->next_program;
+    batch->next_program = (batch->next_program + 1) % GGTGL_SPRITE_PROGRAMS;
+    if(batch->programs[index].program)
+        ggtgl_vertex_layout_destroy(&batch->programs[index].layout);
+    
+    ggtgl_vertex_attribute attributes[] = {
+        {"a_position", 0, 2, GL_FLOAT,         GL_FALSE, sizeof(ggtgl_sprite_vertex), offsetof(ggtgl_sprite_vertex, x),     0, 0},
+        {"a_uv",       0, 2, GL_FLOAT,         GL_FALSE, sizeof(ggtgl_sprite_vertex), offsetof(ggtgl_sprite_vertex, u),     0, 0},
+        {"a_color",    0, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(ggtgl_sprite_vertex), offsetof(ggtgl_sprite_vertex, color), 0, 0},
+    };
+    batch->programs[index].program = program;
+    batch->programs[index].projection_location = glGetUniformLocation(program, "u_projection");
+    batch->programs[index].projection_frame = 0;
+    ggtgl_vertex_layout_create(&batch->programs[index].layout, program, attributes, 3, &batch->vertices.buffer, batch->indices);
+    ggtgl_use_program(program);
+    glUniform1i(glGetUniformLocation(program, "u_texture"), 0);
+    return index;
+}
+
+void _ggtgl_sprite_batch_flush(ggtgl_sprite_batch *batch){
+    if(!batch->count)
+        return;
+    GLintptr offset = ggtgl_stream_buffer_write(&batch->vertices, batch->vertices_data, batch->count * 4 * sizeof(ggtgl_sprite_vertex));
+    if(offset < 0){
+        printf("ggtgl_sprite_batch error: More sprites than max_sprites this frame\n");
+        batch->count = 0;
+        return;
+    }
+    
+    int index = _ggtgl_sprite_batch_program(batch, batch->program);
+    ggtgl_use_program(batch->program);
+    if(batch->programs[index].projection_frame != batch->frame){
+        glUniformMatrix4fv(batch->programs[index].projection_location, 1, GL_FALSE, batch->projection);
+        batch->programs[index].projection_frame = batch->frame;
+    }
+    ggtgl_vertex_layout_set_stream(&batch->programs[index].layout, 0, batch->vertices.buffer, offset);
+    ggtgl_vertex_layout_bind(&batch->programs[index].layout);
+    ggtgl_bind_texture(0, GL_TEXTURE_2D, batch->texture);
+    glDrawElements(GL_TRIANGLES, batch->count * 6, GL_UNSIGNED_SHORT, 0);
+    
+    batch->draw_calls++;
+    batch->sprites += batch->count;
+    batch->count = 0;
+}
+
+void ggtgl_sprite_batch_set_program(ggtgl_sprite_batch *batch, GLuint program){
+    if(!program)
+        program = batch->default_program;
+    if(program != batch->program)
+        _ggtgl_sprite_batch_flush(batch);
+    batch->program = program;
+}
+
+void ggtgl_sprite_batch_draw(ggtgl_sprite_batch *batch, GLuint texture, const ggtgl_sprite *sprite){
+    if(texture != batch->texture || batch->count == GGTGL_SPRITE_BATCH_SIZE)
+        _ggtgl_sprite_batch_flush(batch);
+    batch->texture = texture;
+    
+    float half_width = sprite->width * 0.5f, half_height = sprite->height * 0.5f;
+    float c = 1.f, s = 0.f;
+    if(sprite->rotation != 0.f){
+        c = cosf(sprite->rotation);
+        s = sinf(sprite->rotation);
+    }
+    const float corners[4][2] = {{-half_width, -half_height}, {half_width, -half_height}, {half_width, half_height}, {-half_width, half_height}};
+    const float uvs[4][2] = {{sprite->u0, sprite->v0}, {sprite->u1, sprite->v0}, {sprite->u1, sprite->v1}, {sprite->u0, sprite->v1}};
+    ggtgl_sprite_vertex *vertex = batch->vertices_data + batch->count * 4;
+    for(int i = 0; i < 4; i++){
+        vertex[i].x = sprite->x + corners[i][0] * c - corners[i][1] * s;
+        vertex[i].y = sprite->y + corners[i][0] * s + corners[i][1] * c;
+        vertex[i].u = uvs[i][0];
+        vertex[i].v = uvs[i][1];
+        vertex[i].color = sprite->color;
+    }
+    batch->count++;
+}
+
+void ggtgl_sprite_batch_end(ggtgl_sprite_batch *batch){
+    _ggtgl_sprite_batch_flush(batch);
+    ggtgl_stream_buffer_end_frame(&batch->vertices);
+}
+
+const char *_ggtgl_instance_attribute_names[5] = {
+    "a_instance_transform0", "a_instance_transform1", "a_instance_transform2", "a_instance_transform3", "a_instance_color",
+};
+
+#define _GGTGL_STRING(x) #x
+#define _GGTGL_STRING_VALUE(x) _GGTGL_STRING(x)
+
+// Works from GLSL 1.10 and GLSL ES 1.00 on
+#define _GGTGL_INSTANCE_GLSL_IN \
+    "#if __VERSION__ >= 130\n" \
+    "#define GGTGL_INSTANCE_IN in\n" \
+    "#else\n" \
+    "#define GGTGL_INSTANCE_IN attribute\n" \
+    "#endif\n"
+
+#define _GGTGL_INSTANCE_GLSL_ROWS \
+    "mat4 ggtgl_instance_rows(vec4 r0, vec4 r1, vec4 r2){\n" \
+    "    return mat4(r0.x, r1.x, r2.x, 0.0, r0.y, r1.y, r2.y, 0.0, r0.z, r1.z, r2.z, 0.0, r0.w, r1.w, r2.w, 1.0);\n" \
+    "}\n"
+
+#define _GGTGL_INSTANCE_GLSL_UNIFORMS(vectors) \
+    _GGTGL_INSTANCE_GLSL_IN \
+    "GGTGL_INSTANCE_IN float a_instance_id;\n" \
+    "uniform vec4 u_instance_transforms[" _GGTGL_STRING_VALUE(GGTGL_INSTANCE_BATCH) " * " vectors "];\n" \
+    "uniform vec4 u_instance_colors[" _GGTGL_STRING_VALUE(GGTGL_INSTANCE_BATCH) "];\n" \
+    "vec4 ggtgl_instance_color(){\n" \
+    "    return u_instance_colors[int(a_instance_id)];\n" \
+    "}\n"
+
+// [instanced][format]
+const char *_ggtgl_instance_glsl[2][2] = {
+    {
+        _GGTGL_INSTANCE_GLSL_UNIFORMS("4")
+        "mat4 ggtgl_instance_transform(){\n"
+        "    int i = int(a_instance_id) * 4;\n"
+        "    return mat4(u_instance_transforms[i], u_instance_transforms[i + 1], u_instance_transforms[i + 2], u_instance_transforms[i + 3]);\n"
+        "}\n",
+        _GGTGL_INSTANCE_GLSL_UNIFORMS("3")
+        _GGTGL_INSTANCE_GLSL_ROWS
+        "mat4 ggtgl_instance_transform(){\n"
+        "    int i = int(a_instance_id) * 3;\n"
+        "    return ggtgl_instance_rows(u_instance_transforms[i], u_instance_transforms[i + 1], u_instance_transforms[i + 2]);\n"
+        "}\n",
+    },
+    {
+        _GGTGL_INSTANCE_GLSL_IN
+        "GGTGL_INSTANCE_IN vec4 a_instance_transform0, a_instance_transform1, a_instance_transform2, a_instance_transform3;\n"
+        "GGTGL_INSTANCE_IN vec4 a_instance_color;\n"
+        "mat4 ggtgl_instance_transform(){\n"
+        "    return mat4(a_instance_transform0, a_instance_transform1, a_instance_transform2, a_instance_transform3);\n"
+        "}\n"
+        "vec4 ggtgl_instance_color(){\n"
+        "    return a_instance_color;\n"
+        "}\n",
+        _GGTGL_INSTANCE_GLSL_IN
+        "GGTGL_INSTANCE_IN vec4 a_instance_transform0, a_instance_transform1, a_instance_transform2;\n"
+        "GGTGL_INSTANCE_IN vec4 a_instance_color;\n"
+        _GGTGL_INSTANCE_GLSL_ROWS
+        "mat4 ggtgl_instance_transform(){\n"
+        "    return ggtgl_instance_rows(a_instance_transform0, a_instance_transform1, a_instance_transform2);\n"
+        "}\n"
+        "vec4 ggtgl_instance_color(){\n"
+        "    return a_instance_color;\n"
+        "}\n",
+    },
+};
+
+int _ggtgl_instance_vectors(ggtgl_instance_format format){
+    return format == GGTGL_INSTANCE_MAT4 ? 4 : 3;
+}
+
+int ggtgl_instancing_create(ggtgl_instancing *instancing, ggtgl_instance_format format, int max_instances){
+    memset(instancing, 0, sizeof(ggtgl_instancing));
+    instancing->format = format;
+    instancing->max_instances = max_instances;
+    instancing->instanced = _ggtgl_has_instancing();
+    instancing->white = (ggt_u32 *)malloc(max_instances * sizeof(ggt_u32));
+    if(format == GGTGL_INSTANCE_MAT3X4)
+        instancing->rows = (float *)malloc(max_instances * 12 * sizeof(float));
+    if(!instancing->white || (format == GGTGL_INSTANCE_MAT3X4 && !instancing->rows)){
+        printf("ggtgl_instancing_create error: Couldn't allocate %d instances\n", max_instances);
+        ggtgl_instancing_destroy(instancing);
+        return GGT_FAILURE;
+    }
+    for(int i = 0; i < max_instances; i++)
+        instancing->white[i] = 0xFFFFFFFF;
+    if(!instancing->instanced)
+        return GGT_SUCCESS;
+    
+    // Each draw aligns its transforms and colors, so leave room for that even
+    // when every draw has one instance
+    size_t instance_size = _ggtgl_instance_vectors(format) * 4 * sizeof(float) + sizeof(ggt_u32) + 2 * GGTGL_STREAM_ALIGNMENT;
+    if(ggtgl_stream_buffer_create(&instancing->data, GL_ARRAY_BUFFER, (size_t)max_instances * instance_size) == GGT_FAILURE){
+        instancing->instanced = 0;
+        ggtgl_instancing_destroy(instancing);
+        return GGT_FAILURE;
+    }
+    return GGT_SUCCESS;
+}
+
+void ggtgl_instancing_destroy(ggtgl_instancing *instancing){
+    if(instancing->instanced)
+        ggtgl_stream_buffer_destroy(&instancing->data);
+    for(int i = 0; i < GGTGL_INSTANCE_MESHES; i++){
+        if(instancing->ids[i].buffer){
+            _ggtgl_state_delete_buffer(instancing->ids[i].buffer);
+            glDeleteBuffers(1, &instancing->ids[i].buffer);
+        }
+    }
+    free(instancing->white);
+    free(instancing->rows);
+    memset(instancing, 0, sizeof(ggtgl_instancing));
+}
+
+const char *ggtgl_instancing_glsl(const ggtgl_instancing *instancing){
+    return _ggtgl_instance_glsl[instancing->instanced != 0][instancing->format];
+}
+
+int ggtgl_instancing_batch(const ggtgl_instancing *instancing){
+    return instancing->instanced ? 1 : GGTGL_INSTANCE_BATCH;
+}
+
+int ggtgl_instancing_attributes(const ggtgl_instancing *instancing, unsigned int stream, ggtgl_vertex_attribute *attributes){
+    if(!instancing->instanced){
+        ggtgl_vertex_attribute id = {"a_instance_id", stream, 1, GL_FLOAT, GL_FALSE, 0, 0, 0, 0};
+        attributes[0] = id;
+        return 1;
+    }
+    int vectors = _ggtgl_instance_vectors(instancing->format);
+    for(int i = 0; i < vectors; i++){
+        ggtgl_vertex_attribute attribute = {_ggtgl_instance_attribute_names[i], stream, 4, GL_FLOAT, GL_FALSE,
+                                            (GLsizei)(vectors * 4 * sizeof(float)), i * 4 * sizeof(float), 1, 0};
+        attributes[i] = attribute;
+    }
+    ggtgl_vertex_attribute color = {_ggtgl_instance_attribute_names[4], stream + 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, 0, 1, 0};
+    attributes[vectors] = color;
+    return vectors + 1;
+}
+
+GLuint ggtgl_instancing_ids(ggtgl_instancing *instancing, int vertices){
+    if(instancing->instanced || vertices <= 0)
+        return 0;
+    int slot = -1;
+    for(int i = 0; i < GGTGL_INSTANCE_MESHES; i++){
+        if(instancing->ids[i].buffer && instancing->ids[i].vertices == vertices)
+            return instancing->ids[i].buffer;
+        if(!instancing->ids[i].buffer && slot < 0)
+            slot = i;
+    }
+    if(slot < 0){
+        printf("ggtgl_instancing_ids error: Too many meshes, increase GGTGL_INSTANCE_MESHES\n");
+        return 0;
+    }
+    
+    // The copy of the mesh each vertex is in
+    int count = vertices * GGTGL_INSTANCE_BATCH;
+    float *ids = (float *)malloc(count * sizeof(float));
+    if(!ids){
+        printf("ggtgl_instancing_ids error: Couldn't allocate the ids of %d vertices\n", count);
+        return 0;
+    }
+    for(int i = 0; i < count; i++)
+        ids[i] = (float)(i / vertices);
+    glGenBuffers(1, &instancing->ids[slot].buffer);
+    _ggtgl_set_buffer_data(instancing->ids[slot].buffer, ids, count * sizeof(float), GL_STATIC_DRAW);
+    free(ids);
+    instancing->ids[slot].vertices = vertices;
+    return instancing->ids[slot].buffer;
+}
+
+const float *_ggtgl_instancing_transforms(ggtgl_instancing *instancing, const float *matrices, int instance_count){
+    if(instancing->format == GGTGL_INSTANCE_MAT4)
+        return matrices;
+    if(instance_count > instancing->max_instances){
+        printf("ggtgl_instancing error: More instances than max_instances this frame\n");
+        return NULL;
+    }
+    // Column major, so a row is every 4th value
+    for(int i = 0; i < instance_count; i++)
+        for(int row = 0; row < 3; row++)
+            for(int column = 0; column < 4; column++)
+                instancing->rows[i * 12 + row * 4 + column] = matrices[i * 16 + column * 4 + row];
+    return instancing->rows;
+}
+
+// type is 0 for glDrawArrays
+void _ggtgl_instancing_draw(ggtgl_instancing *instancing, ggtgl_vertex_layout *layout, unsigned int stream,
+                            const float *transforms, const ggt_u32 *colors, int instance_count,
+                            GLenum mode, GLint first, GLsizei count, GLenum type, GLintptr offset){
+    if(instance_count <= 0)
+        return;
+    if(instance_count > instancing->max_instances){
+        printf("ggtgl_instancing error: More instances than max_instances this frame\n");
+        return;
+    }
+    if(!colors)
+        colors = instancing->white;
+    int vectors = _ggtgl_instance_vectors(instancing->format);
+    
+    if(instancing->instanced){
+        GLintptr transforms_offset = ggtgl_stream_buffer_write(&instancing->data, transforms, instance_count * vectors * 4 * sizeof(float));
+        GLintptr colors_offset = ggtgl_stream_buffer_write(&instancing->data, colors, instance_count * sizeof(ggt_u32));
+        if(transforms_offset < 0 || colors_offset < 0){
+            printf("ggtgl_instancing error: More instances than max_instances this frame\n");
+            return;
+        }
+        ggtgl_vertex_layout_set_stream(layout, stream, instancing->data.buffer, transforms_offset);
+        ggtgl_vertex_layout_set_stream(layout, stream + 1, instancing->data.buffer, colors_offset);
+        ggtgl_vertex_layout_bind(layout);
+        if(type)
+            glDrawElementsInstanced(mode, count, type, (void *)offset, instance_count);
+        else
+            glDrawArraysInstanced(mode, first, count, instance_count);
+        instancing->draw_calls++;
+        instancing->instances += instance_count;
+        return;
+    }
+    
+    // GGTGL_INSTANCE_BATCH copies of the mesh per draw, each reading its
+    // instance from the uniform arrays
+    GLuint program = ggtgl_get_state()->program;
+    if(program != instancing->program){
+        instancing->transforms_location = glGetUniformLocation(program, "u_instance_transforms");
+        instancing->colors_location = glGetUniformLocation(program, "u_instance_colors");
+        instancing->program = program;
+    }
+    ggtgl_vertex_layout_bind(layout);
+    for(int done = 0; done < instance_count; done += GGTGL_INSTANCE_BATCH){
+        int batch = instance_count - done < GGTGL_INSTANCE_BATCH ? instance_count - done : GGTGL_INSTANCE_BATCH;
+        if(instancing->transforms_location >= 0)
+            glUniform4fv(instancing->transforms_location, batch * vectors, transforms + done * vectors * 4);
+        if(instancing->colors_location >= 0){
+            GLfloat values[GGTGL_INSTANCE_BATCH * 4];
+            for(int i = 0; i < batch; i++){
+                const unsigned char *color = (const unsigned char *)&colors[done + i];
+                for(int j = 0; j < 4; j++)
+                    values[i * 4 + j] = color[j] / 255.f;
+            }
+            glUniform4fv(instancing->colors_location, batch, values);
+        }
+        if(type)
+            glDrawElements(mode, count * batch, type, (void *)offset);
+        else
+            glDrawArrays(mode, first, count * batch);
+        instancing->draw_calls++;
+    }
+    instancing->instances += instance_count;
+}
+
+void ggtgl_instancing_draw_arrays(ggtgl_instancing *instancing, ggtgl_vertex_layout *layout, unsigned int stream,
+                                  const float *transforms, const ggt_u32 *colors, int instance_count,
+                                  GLenum mode, GLint first, GLsizei count){
+    _ggtgl_instancing_draw(instancing, layout, stream, transforms, colors, instance_count, mode, first, count, 0, 0);
+}
+
+void ggtgl_instancing_draw_elements(ggtgl_instancing *instancing, ggtgl_vertex_layout *layout, unsigned int stream,
+                                    const float *transforms, const ggt_u32 *colors, int instance_count,
+                                    GLenum mode, GLsizei count, GLenum type, GLintptr offset){
+    _ggtgl_instancing_draw(instancing, layout, stream, transforms, colors, instance_count, mode, 0, count, type, offset);
+}
+
+void ggtgl_instancing_end_frame(ggtgl_instancing *instancing){
+    if(instancing->instanced)
+        ggtgl_stream_buffer_end_frame(&instancing->data);
+    instancing->draw_calls = 0;
+    instancing->instances = 0;
+}
+
+int _ggtgl_has_texture_arrays(void){
+    static int supported = -1;
+    if(supported < 0){
+#ifdef GGTGL_OPENGL_ES
+        supported = ggtgl_version() >= 30;
+#else
+        supported = ggtgl_version() >= 30 || ggtgl_has_extension("GL_EXT_texture_array");
+#endif
+    }
+    return supported;
+}
+
+int _ggtgl_rects_overlap(ggtgl_atlas_rect a, ggtgl_atlas_rect b){
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+int _ggtgl_rect_contains(ggtgl_atlas_rect outer, ggtgl_atlas_rect inner){
+    return inner.x >= outer.x && inner.y >= outer.y &&
+        inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+}
+
+void _ggtgl_atlas_add_free(ggtgl_atlas_layer *layer, int x, int y, int width, int height){
+    // When full the space is lost until it merges back on a remove
+    if(layer->free_count == GGTGL_ATLAS_MAX_RECTS)
+        return;
+    ggtgl_atlas_rect rect = {x, y, width, height};
+    layer->free_rects[layer->free_count++] = rect;
+}
+
+void _ggtgl_atlas_remove_free(ggtgl_atlas_layer *layer, int index){
+    layer->free_rects[index] = layer->free_rects[--layer->free_count];
+}
+
+// Drops the free rectangles that are inside another one
+void _ggtgl_atlas_prune(ggtgl_atlas_layer *layer){
+    for(int i = 0; i < layer->free_count; i++){
+        for(int j = i + 1; j < layer->free_count; j++){
+            if(_ggtgl_rect_contains(layer->free_rects[j], layer->free_rects[i])){
+                _ggtgl_atlas_remove_free(layer, i);
+                i--;
+                break;
+            }
+            if(_ggtgl_rect_contains(layer->free_rects[i], layer->free_rects[j])){
+                _ggtgl_atlas_remove_free(layer, j);
+                j--;
+            }
+        }
+    }
+}
+
+void _ggtgl_atlas_mark_dirty(ggtgl_atlas_layer *layer, ggtgl_atlas_rect rect){
+    if(!layer->dirty.width){
+        layer->dirty = rect;
+        return;
+    }
+    int right = layer->dirty.x + layer->dirty.width, bottom = layer->dirty.y + layer->dirty.height;
+    if(rect.x + rect.width > right)
+        right = rect.x + rect.width;
+    if(rect.y + rect.height > bottom)
+        bottom = rect.y + rect.height;
+    layer->dirty.x = (rect.x < layer->dirty.x) ? rect.x : layer->dirty.x;
+    layer->dirty.y = (rect.y < layer->dirty.y) ? rect.y : layer->dirty.y;
+    layer->dirty.width = right - layer->dirty.x;
+    layer->dirty.height = bottom - layer->dirty.y;
+}
+
+void _ggtgl_atlas_reset_free(ggtgl_atlas *atlas, ggtgl_atlas_layer *layer){
+    layer->free_count = 0;
+    layer->removed = 0;
+    _ggtgl_atlas_add_free(layer, atlas->padding, atlas->padding, atlas->width - atlas->padding, atlas->height - atlas->padding);
+}
+
+int _ggtgl_atlas_add_layer(ggtgl_atlas *atlas){
+    if(atlas->layer_count == atlas->max_layers)
+        return GGT_FAILURE;
+    ggtgl_atlas_layer *layer = &atlas->layers[atlas->layer_count];
+    layer->pixels = (unsigned char *)calloc((size_t)atlas->width * atlas->height, 4);
+    if(!layer->pixels)
+        return GGT_FAILURE;
+    _ggtgl_atlas_reset_free(atlas, layer);
+    ggtgl_atlas_rect all = {0, 0, atlas->width, atlas->height};
+    layer->dirty = all;
+    atlas->layer_count++;
+    return GGT_SUCCESS;
+}
+
+// Of the active unit, asked to GL like _ggtgl_bound_texture_2d
+GLuint _ggtgl_atlas_bound(ggtgl_atlas *atlas){
+    if(atlas->target == GL_TEXTURE_2D)
+        return _ggtgl_bound_texture_2d();
+    GLint texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &texture);
+    return (GLuint)texture;
+}
+
+void _ggtgl_atlas_bind(ggtgl_atlas *atlas, GLuint texture){
+    if(atlas->target == GL_TEXTURE_2D)
+        _ggtgl_bind_texture_2d(texture);
+    else
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+}
+
+int ggtgl_atlas_create(ggtgl_atlas *atlas, int width, int height, int padding, int max_layers){
+    memset(atlas, 0, sizeof(ggtgl_atlas));
+    if(max_layers > 1 && !_ggtgl_has_texture_arrays()){
+        printf("ggtgl_atlas_create error: No texture arrays, using a single layer\n");
+        max_layers = 1;
+    }
+    atlas->target = (max_layers > 1) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    atlas->width = width;
+    atlas->height = height;
+    atlas->padding = padding;
+    atlas->max_layers = (max_layers > 1) ? max_layers : 1;
+    atlas->layers = (ggtgl_atlas_layer *)calloc(atlas->max_layers, sizeof(ggtgl_atlas_layer));
+    if(!atlas->layers || !_ggtgl_atlas_add_layer(atlas)){
+        printf("ggtgl_atlas_create error: Couldn't allocate %dx%d pixels\n", width, height);
+        free(atlas->layers);
+        atlas->layers = NULL;
+        return GGT_FAILURE;
+    }
+    
+    glGenTextures(1, &atlas->texture);
+    GLuint previous = _ggtgl_atlas_bound(atlas);
+    _ggtgl_atlas_bind(atlas, atlas->texture);
+    glTexParameteri(atlas->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(atlas->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(atlas->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(atlas->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if(atlas->target == GL_TEXTURE_2D){
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        atlas->texture_layers = 1;
+    }
+    _ggtgl_atlas_bind(atlas, previous);
+    return GGT_SUCCESS;
+}
+
+void ggtgl_atlas_destroy(ggtgl_atlas *atlas){
+    for(int i = 0; i < atlas->layer_count; i++)
+        free(atlas->layers[i].pixels);
+    free(atlas->layers);
+    if(atlas->target == GL_TEXTURE_2D && _ggtgl_bound_texture_2d() == atlas->texture)
+        _ggtgl_bind_texture_2d(0);
+    glDeleteTextures(1, &atlas->texture);
+    memset(atlas, 0, sizeof(ggtgl_atlas));
+}
+
+// MaxRects, best short side fit. Returns the index of the free rectangle
+int _ggtgl_atlas_find(ggtgl_atlas_layer *layer, int width, int height){
+    int best = -1, best_short = 0, best_long = 0;
+    for(int i = 0; i < layer->free_count; i++){
+        ggtgl_atlas_rect *rect = &layer->free_rects[i];
+        if(rect->width < width || rect->height < height)
+            continue;
+        int left_x = rect->width - width, left_y = rect->height - height;
+        int short_side = (left_x < left_y) ? left_x : left_y;
+        int long_side = (left_x < left_y) ? left_y : left_x;
+        if(best < 0 || short_side < best_short || (short_side == best_short && long_side < best_long)){
+            best = i;
+            best_short = short_side;
+            best_long = long_side;
+        }
+    }
+    return best;
+}
+
+// Cuts used out of every free rectangle it overlaps
+void _ggtgl_atlas_split(ggtgl_atlas_layer *layer, ggtgl_atlas_rect used){
+    // The ones from before are kept in [0, count) and the new ones after them
+    int count = layer->free_count;
+    for(int i = 0; i < count;){
+        ggtgl_atlas_rect rect = layer->free_rects[i];
+        if(!_ggtgl_rects_overlap(rect, used)){
+            i++;
+            continue;
+        }
+        layer->free_rects[i] = layer->free_rects[--count];
+        _ggtgl_atlas_remove_free(layer, count);
+        if(used.x > rect.x)
+            _ggtgl_atlas_add_free(layer, rect.x, rect.y, used.x - rect.x, rect.height);
+        if(used.x + used.width < rect.x + rect.width)
+            _ggtgl_atlas_add_free(layer, used.x + used.width, rect.y, rect.x + rect.width - used.x - used.width, rect.height);
+        if(used.y > rect.y)
+            _ggtgl_atlas_add_free(layer, rect.x, rect.y, rect.width, used.y - rect.y);
+        if(used.y + used.height < rect.y + rect.height)
+            _ggtgl_atlas_add_free(layer, rect.x, used.y + used.height, rect.width, rect.y + rect.height - used.y - used.height);
+    }
+    
+    // The old ones don't contain each other, and can't be inside a piece of
+    // one of them, so only the new ones need checking
+    for(int i = count; i < layer->free_count; i++){
+        for(int j = 0; j < layer->free_count; j++){
+            if(i != j && _ggtgl_rect_contains(layer->free_rects[j], layer->free_rects[i])){
+                _ggtgl_atlas_remove_free(layer, i);
+                i--;
+                break;
+            }
+        }
+    }
+}
+
+// Removes only give back the space of the image, which can't grow into the
+// free rectangles around it. Cutting every used rectangle out of an empty
+// layer again gives the biggest free rectangles there are
+void _ggtgl_atlas_rebuild_free(ggtgl_atlas *atlas, ggtgl_atlas_layer *layer){
+    _ggtgl_atlas_reset_free(atlas, layer);
+    for(int i = 0; i < layer->used_count; i++)
+        _ggtgl_atlas_split(layer, layer->used_rects[i]);
+}
+
+int ggtgl_atlas_insert(ggtgl_atlas *atlas, int width, int height, const void *pixels, ggtgl_atlas_entry *entry){
+    int padded_width = width + atlas->padding, padded_height = height + atlas->padding;
+    // Else every layer would be tried, and one more added, for nothing
+    if(width <= 0 || height <= 0 || padded_width > atlas->width - atlas->padding || padded_height > atlas->height - atlas->padding){
+        printf("ggtgl_atlas_insert error: %dx%d pixels can't go in a %dx%d atlas\n", width, height, atlas->width, atlas->height);
+        return GGT_FAILURE;
+    }
+    int layer_index = 0, index = -1;
+    for(; layer_index < atlas->layer_count && index < 0; layer_index++){
+        ggtgl_atlas_layer *layer = &atlas->layers[layer_index];
+        if(layer->used_count == GGTGL_ATLAS_MAX_RECTS)
+            continue;
+        index = _ggtgl_atlas_find(layer, padded_width, padded_height);
+        if(index < 0 && layer->removed){
+            _ggtgl_atlas_rebuild_free(atlas, layer);
+            index = _ggtgl_atlas_find(layer, padded_width, padded_height);
+        }
+    }
+    if(index >= 0){
+        layer_index--;
+    }else if(_ggtgl_atlas_add_layer(atlas)){
+        index = _ggtgl_atlas_find(&atlas->layers[layer_index], padded_width, padded_height);
+    }
+    if(index < 0){
+        printf("ggtgl_atlas_insert error: No room for %dx%d pixels\n", width, height);
+        return GGT_FAILURE;
+    }
+    
+    ggtgl_atlas_layer *layer = &atlas->layers[layer_index];
+    ggtgl_atlas_rect used = {layer->free_rects[index].x, layer->free_rects[index].y, padded_width, padded_height};
+    _ggtgl_atlas_split(layer, used);
+    layer->used_rects[layer->used_count++] = used;
+    
+    for(int y = 0; y < height; y++)
+        memcpy(layer->pixels + ((size_t)(used.y + y) * atlas->width + used.x) * 4, (const unsigned char *)pixels + (size_t)y * width * 4, (size_t)width * 4);
+    ggtgl_atlas_rect image = {used.x, used.y, width, height};
+    _ggtgl_atlas_mark_dirty(layer, image);
+    
+    entry->x = used.x;
+    entry->y = used.y;
+    entry->width = width;
+    entry->height = height;
+    entry->layer = layer_index;
+    entry->u0 = (float)used.x / atlas->width;
+    entry->v0 = (float)used.y / atlas->height;
+    entry->u1 = (float)(used.x + width) / atlas->width;
+    entry->v1 = (float)(used.y + height) / atlas->height;
+    return GGT_SUCCESS;
+}
+
+void ggtgl_atlas_remove(ggtgl_atlas *atlas, const ggtgl_atlas_entry *entry){
+    if(entry->layer < 0 || entry->layer >= atlas->layer_count)
+        return;
+    ggtgl_atlas_layer *layer = &atlas->layers[entry->layer];
+    int used = 0;
+    while(used < layer->used_count && (layer->used_rects[used].x != entry->x || layer->used_rects[used].y != entry->y))
+        used++;
+    // Removed already, or never inserted
+    if(used == layer->used_count)
+        return;
+    layer->used_rects[used] = layer->used_rects[--layer->used_count];
+    
+    for(int y = 0; y < entry->height; y++)
+        memset(layer->pixels + ((size_t)(entry->y + y) * atlas->width + entry->x) * 4, 0, (size_t)entry->width * 4);
+    ggtgl_atlas_rect image = {entry->x, entry->y, entry->width, entry->height};
+    _ggtgl_atlas_mark_dirty(layer, image);
+    if(!layer->used_count){
+        _ggtgl_atlas_reset_free(atlas, layer);
+        return;
+    }
+    
+    // Give the space back, joined with the free rectangles next to it that
+    // line up, so it isn't cut up more with every remove
+    layer->removed++;
+    _ggtgl_atlas_add_free(layer, entry->x, entry->y, entry->width + atlas->padding, entry->height + atlas->padding);
+    int merged = 1;
+    while(merged){
+        merged = 0;
+        for(int i = 0; i < layer->free_count && !merged; i++){
+            for(int j = 0; j < layer->free_count && !merged; j++){
+                ggtgl_atlas_rect *a = &layer->free_rects[i], *b = &layer->free_rects[j];
+                if(i == j)
+                    continue;
+                if(a->x == b->x && a->width == b->width && a->y + a->height == b->y){
+                    a->height += b->height;
+                    merged = 1;
+                }else if(a->y == b->y && a->height == b->height && a->x + a->width == b->x){
+                    a->width += b->width;
+                    merged = 1;
+                }
+                if(merged)
+                    _ggtgl_atlas_remove_free(layer, j);
+            }
+        }
+    }
+    _ggtgl_atlas_prune(layer);
+}
+
+void ggtgl_atlas_update(ggtgl_atlas *atlas){
+    GLuint previous = _ggtgl_atlas_bound(atlas);
+    _ggtgl_atlas_bind(atlas, atlas->texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    
+    // Without GL_UNPACK_ROW_LENGTH (WebGL 1) the rows are uploaded whole.
+    // That's also the one without pixel unpack buffers, which would take
+    // the pixels as an offset in them
+    int row_length = 1;
+#ifdef GGTGL_OPENGL_ES
+    row_length = ggtgl_version() >= 30;
+#endif
+    if(row_length){
+        _ggtgl_bind_buffer_now(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, atlas->width);
+    }
+    
+    // A new layer needs new storage for all of them, so they're all uploaded again
+    if(atlas->texture_layers != atlas->layer_count){
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, atlas->width, atlas->height, atlas->layer_count, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        atlas->texture_layers = atlas->layer_count;
+        for(int i = 0; i < atlas->layer_count; i++){
+            ggtgl_atlas_rect all = {0, 0, atlas->width, atlas->height};
+            atlas->layers[i].dirty = all;
+        }
+    }
+    for(int i = 0; i < atlas->layer_count; i++){
+        ggtgl_atlas_layer *layer = &atlas->layers[i];
+        if(!layer->dirty.width)
+            continue;
+        if(!row_length){
+            layer->dirty.x = 0;
+            layer->dirty.width = atlas->width;
+        }
+        const unsigned char *pixels = layer->pixels + ((size_t)layer->dirty.y * atlas->width + layer->dirty.x) * 4;
+        if(atlas->target == GL_TEXTURE_2D)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, layer->dirty.x, layer->dirty.y, layer->dirty.width, layer->dirty.height,
+                            GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        else
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, layer->dirty.x, layer->dirty.y, i, layer->dirty.width, layer->dirty.height, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        layer->dirty.width = 0;
+    }
+    if(row_length)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    _ggtgl_atlas_bind(atlas, previous);
+}
 
 #endif
\ No newline at end of file
@@ -9,7 +9,17 @@
 // Usage:
 //  - You should have functions named ggtp_init, ggtp_loop and ggtp_draw that
 //    will be called when the program is starting or every frame.
-//    ggtp_init must call ggtp_create_window.
+//    ggtp_init must call ggtp_create_window. OpenGL calls belong in
+//    ggtp_draw, since with GGTP_RENDER_THREAD ggtp_loop runs on a thread
+//    without the context.
+//  - ggtp_loop can return GGTP_NO_REDRAW when nothing changed, so that the
+//    frame isn't drawn and the program sleeps until there is input or
+//    ggtp_request_redraw/ggtp_request_redraw_after asks for a new frame
+//  - Benchmark runs can be recorded and replayed without touching the code
+//    through environment variables: GGTP_RECORD={FILE} records the input,
+//    GGTP_REPLAY={FILE} replays it at full speed (or as recorded with
+//    GGTP_REPLAY_SPEED=recorded), writes the frame times to
+//    GGTP_REPLAY_REPORT={FILE} if set and then closes the program
 //  - To compile this, #define GGT_PLATFORM_IMPLEMENTATION and #include the
 //    header
 //
@@ -17,6 +27,78 @@
 //  - GGTP_PROGRAM_STATE {TYPE} if you want to have a variable of type
 //     {TYPE} whose pointer is passed to the user functions
 //  - GGTP_MAX_EVENTS_PER_LOOP, which is 256 by default
+//  - GGTP_COALESCE_EVENTS if you want consecutive mouse move (and resize)
+//    events to be merged into a single event per frame
+//  - GGTP_INPUT_THREAD if you want input to be pumped as soon as it arrives
+//    while ggtp_loop and ggtp_draw run on a second thread that owns the
+//    OpenGL context. Events are handed over through a lock-free ring of
+//    GGTP_INPUT_RING_SIZE events (1024 by default, must be a power of two);
+//    while it is full the input thread retries GGTP_INPUT_THREAD_HZ times
+//    per second (1000 by default). Windows and linux only
+//  - GGTP_RENDER_THREAD if you want ggtp_loop to run on its own simulation
+//    thread (GGTP_SIMULATION_HZ times per second, 60 by default) while
+//    ggtp_draw runs on the thread that owns the OpenGL context. Needs
+//    GGTP_PROGRAM_STATE: after every ggtp_loop the state is copied into one
+//    of three snapshots and ggtp_draw always gets the newest finished one, so
+//    neither thread waits for the other. When ggtp_loop returns
+//    GGTP_NO_REDRAW the simulation thread sleeps until there is input or a
+//    redraw is requested. The program state must then not
+//    point into itself, and ggtp_loop must not make OpenGL calls since the
+//    context belongs to the drawing thread: keep what they need (e.g. the
+//    size from a resize event) in the program state and apply it in
+//    ggtp_draw.
+//  - GGTP_RENDER_STATE {TYPE}, together with GGTP_RENDER_THREAD, if only part
+//    of the program state is needed to draw. You then write a ggtp_snapshot
+//    function that fills a {TYPE} from the program state, and ggtp_draw gets
+//    a {TYPE} snapshot instead
+//  - GGTP_DEFAULT_PACING, GGTP_DEFAULT_TARGET_HZ and GGTP_DEFAULT_JUST_IN_TIME
+//    for the frame pacing used until ggtp_set_frame_pacing is called
+//    (GGTP_PACING_VSYNC, 60 and 0 by default)
+//  - GGTP_JUST_IN_TIME_MARGIN, the microseconds of slack that just-in-time
+//    frames leave before the predicted swap deadline, 1500 by default
+//  - GGTP_MEMORY if you want ggtp_init to also get a ggt_platform_memory with
+//    a permanent, a transient and a per-frame arena. The address space is
+//    reserved up front (GGTP_PERMANENT_MEMORY_SIZE, GGTP_TRANSIENT_MEMORY_SIZE
+//    and GGTP_FRAME_MEMORY_SIZE bytes) and committed as the arenas grow; each
+//    arena's peak field keeps the most it ever held, to size these. The
+//    program state then lives at the start of the permanent arena, and the
+//    frame arena is emptied once the frame is drawn (with GGTP_RENDER_THREAD,
+//    after every ggtp_loop)
+//  - GGTP_HUGE_PAGES, together with GGTP_MEMORY, to back the arenas with huge
+//    pages where the system allows it. On windows large pages have to be
+//    committed up front, so only reservations of up to
+//    GGTP_LARGE_PAGES_MAX_SIZE bytes (256MB by default) use them
+//  - GGTP_WATCH_DEBOUNCE, the milliseconds without changes after which
+//    ggtp_watch delivers a batch, 100 by default, and GGTP_MAX_CHANGED_FILES
+//    for the most paths in a batch, 256 by default
+//  - GGTP_MAX_FILE_REQUESTS for the most ggtp_read_file_async reads in flight
+//    (256 by default). They run on GGTP_FILE_THREADS threads (2 by default),
+//    or on linux through io_uring with up to GGTP_FILE_QUEUE_DEPTH (16 by
+//    default) files open at once, switching to threads if io_uring fails.
+//    GGTP_NO_IO_URING always uses threads
+//  - GGTP_LOADER_CONTEXT if you want ggtp_gl_load jobs to run on a thread
+//    with a second OpenGL context that shares objects with the window's,
+//    with up to GGTP_MAX_GL_JOBS (256 by default) queued. Windows and linux
+//    only
+//  - GGTP_FRAME_STATS_WINDOW for the number of frames ggtp_frame_stats
+//    covers (1024 by default) and GGTP_FRAME_HISTORY for how many of them a
+//    hitch callback gets (128 by default)
+//  - GGTP_AUDIO_VOICES for the most sounds ggtp_audio mixes at once (256 by
+//    default) and GGTP_AUDIO_COMMANDS for the size of the queue of audio
+//    commands sent in a buffer (1024 by default, must be a power of two)
+//  - GGTP_NO_GL to include only the declarations without the OpenGL and
+//    window system headers, e.g. in tools that read or write packs
+//  - GGTP_HOT_RELOAD "{LIBRARY}" if you want ggtp_init, ggtp_loop and
+//    ggtp_draw to be loaded from the shared library {LIBRARY} (found with
+//    ggtp_program_file_path) instead of being linked in. When the library is
+//    rebuilt, the new code is swapped in between frames (after it stopped
+//    changing for GGTP_HOT_RELOAD_DELAY milliseconds, 300 by default) and the
+//    program state and memory are kept. Global variables in the library are
+//    not, so keep everything in the program state. The library calls back
+//    into the platform, so link the executable with -rdynamic on linux, and
+//    on windows export the ggtp_ functions it uses (/EXPORT or a .def file)
+//    and link the library against the executable's import library. Windows
+//    and linux only, and not together with GGTP_RENDER_THREAD
 //
 
 #ifndef GGT_PLATFORM_H
@@ -29,6 +111,9 @@ extern "C" {
 #define GGT_SUCCESS 1
 #define GGT_FAILURE 0
     
+    // ggtp_loop can return this instead of GGT_SUCCESS when nothing changed
+#define GGTP_NO_REDRAW 2
+    
 #define GGT_C_SUCCESS 0
 #define GGT_C_FAILURE 1
     
@@ -51,6 +136,8 @@ extern "C" {
         GGTP_EVENT_RESIZE,
         GGTP_EVENT_CLOSE,
         GGTP_EVENT_FOCUS_LOST,
+        GGTP_EVENT_FILES_CHANGED,
+        GGTP_EVENT_FILE_READ,
     } ggt_platform_event_type;
     
     
@@ -81,21 +168,48 @@ extern "C" {
         ggt_vec2i position, difference;
     } ggt_platform_mouse_movement;
     
+    // Paths of the files that changed in the watched directories, valid
+    // until the next batch is delivered
+    typedef struct {
+        ggt_u32 count;
+        const char **paths;
+    } ggt_platform_changed_files;
+    
+    typedef ggt_u32 ggt_file_request;
+    
+    typedef enum {
+        GGTP_FILE_OK,
+        GGTP_FILE_NOT_FOUND,
+        GGTP_FILE_TOO_BIG, // size has the size the destination would need
+        GGTP_FILE_ERROR,
+    } ggt_platform_file_status;
+    
+    typedef struct {
+        ggt_u64 size;
+        ggt_file_request request;
+        ggt_platform_file_status status;
+    } ggt_platform_file_read;
+    
     typedef union {
         char key;
         ggt_vec2i size;
         ggt_vec2i coords;
         ggt_platform_mouse_movement mouse_movement;
+        ggt_platform_changed_files files;
+        ggt_platform_file_read file;
     } ggt_platform_event_info;
     
     typedef char                        _ggt_platform_event_type_of_key;
     typedef ggt_vec2i                   _ggt_platform_event_type_of_size;
     typedef ggt_vec2i                   _ggt_platform_event_type_of_coords;
     typedef ggt_platform_mouse_movement _ggt_platform_event_type_of_mouse_movement;
+    typedef ggt_platform_changed_files  _ggt_platform_event_type_of_files;
+    typedef ggt_platform_file_read      _ggt_platform_event_type_of_file;
     
     typedef struct {
         ggt_platform_event_type type;
         ggt_platform_event_info info;
+        ggt_u64 timestamp; // In microseconds, see ggtp_time_microseconds()
     } ggt_platform_event;
     
     typedef struct {
@@ -103,24 +217,348 @@ extern "C" {
         ggt_platform_event data[GGTP_MAX_EVENTS_PER_LOOP];
     } ggt_platform_events;
     
+    //
+    // Memory arenas
+    //
+    
+    // A linear allocator over a reserved range of address space
+    typedef struct {
+        ggt_u8 *base;
+        ggt_u64 used;
+        ggt_u64 committed;
+        ggt_u64 reserved;
+        ggt_u64 peak; // Highest value of used, read it to size the reservations
+    } ggt_arena;
+    
+    int  ggtp_arena_create(ggt_arena *arena, ggt_u64 reserve_size, int huge_pages);
+    void ggtp_arena_destroy(ggt_arena *arena);
+    // Returns memory aligned to 16 bytes, or NULL if the reservation is full
+    void *ggtp_arena_push(ggt_arena *arena, ggt_u64 size);
+    void *ggtp_arena_push_zero(ggt_arena *arena, ggt_u64 size);
+    void ggtp_arena_reset(ggt_arena *arena);
+    // Everything pushed after ggtp_arena_mark is freed by ggtp_arena_pop_to
+    ggt_u64 ggtp_arena_mark(ggt_arena *arena);
+    void ggtp_arena_pop_to(ggt_arena *arena, ggt_u64 mark);
+    
+#define ggtp_arena_push_struct(arena, type) ((type *)ggtp_arena_push_zero(arena, sizeof(type)))
+#define ggtp_arena_push_array(arena, type, count) ((type *)ggtp_arena_push(arena, (count) * sizeof(type)))
+    
+    typedef struct {
+        ggt_arena permanent; // Lives as long as the program
+        ggt_arena transient; // Reset it yourself, e.g. when loading a level
+        ggt_arena frame;     // Emptied after every ggtp_draw (or ggtp_loop, if the frame isn't drawn)
+    } ggt_platform_memory;
+    
+    // The functions you write. With GGTP_HOT_RELOAD they are looked up in a
+    // shared library, so they are exported from it
+#ifdef _WIN32
+#define GGTP_EXPORT __declspec(dllexport)
+#else
+#define GGTP_EXPORT __attribute__((visibility("default")))
+#endif
+    
 #ifdef GGTP_PROGRAM_STATE
     struct GGTP_PROGRAM_STATE;
-    int  ggtp_init(GGTP_PROGRAM_STATE* program_state);
-    int  ggtp_loop(GGTP_PROGRAM_STATE* program_state, ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events events);
-    void ggtp_draw(GGTP_PROGRAM_STATE* program_state);
+#ifdef GGTP_MEMORY
+    GGTP_EXPORT int  ggtp_init(GGTP_PROGRAM_STATE* program_state, ggt_platform_memory* memory);
+#else
+    GGTP_EXPORT int  ggtp_init(GGTP_PROGRAM_STATE* program_state);
+#endif
+    GGTP_EXPORT int  ggtp_loop(GGTP_PROGRAM_STATE* program_state, ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events events);
+#if defined(GGTP_RENDER_THREAD) && defined(GGTP_RENDER_STATE)
+    struct GGTP_RENDER_STATE;
+    GGTP_EXPORT void ggtp_snapshot(const GGTP_PROGRAM_STATE* program_state, GGTP_RENDER_STATE* render_state);
+    GGTP_EXPORT void ggtp_draw(GGTP_RENDER_STATE* render_state);
+#else
+    GGTP_EXPORT void ggtp_draw(GGTP_PROGRAM_STATE* program_state);
+#endif
 #else
-    int  ggtp_init();
-    int  ggtp_loop(ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events events);
-    void ggtp_draw();
+#ifdef GGTP_MEMORY
+    GGTP_EXPORT int  ggtp_init(ggt_platform_memory* memory);
+#else
+    GGTP_EXPORT int  ggtp_init();
+#endif
+    GGTP_EXPORT int  ggtp_loop(ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events events);
+    GGTP_EXPORT void ggtp_draw();
 #endif
     
     int ggtp_create_window(int width, int height, const char *window_name);
     
+    // Runs job on a loader thread whose OpenGL context shares objects with
+    // the window's (with GGTP_LOADER_CONTEXT, otherwise before the next frame
+    // on the thread that draws). Once the GPU finished what the job queued,
+    // done (if not NULL) is called on the thread that draws, before a frame,
+    // and the textures, buffers and programs it made can be used right away.
+    // Objects that hold others, like vertex arrays and framebuffers, aren't
+    // shared, so only make those on the thread that draws. Can be called from
+    // any thread, including from jobs
+    typedef void ggt_gl_job_function(void *data);
+    int ggtp_gl_load(ggt_gl_job_function *job, ggt_gl_job_function *done, void *data);
+    
+    typedef enum {
+        GGTP_PACING_VSYNC,          // Swap interval 1
+        GGTP_PACING_ADAPTIVE_VSYNC, // Swap interval -1 (late frames tear instead of waiting), or vsync if unsupported
+        GGTP_PACING_UNCAPPED,       // Swap interval 0
+        GGTP_PACING_LIMITED,        // Swap interval 0, sleeping (then spinning) to present at target_hz
+    } ggt_platform_pacing;
+    // If just_in_time is set, input sampling and ggtp_loop are delayed until
+    // shortly before the predicted swap deadline. Can be called at any time
+    void ggtp_set_frame_pacing(ggt_platform_pacing pacing, int target_hz, int just_in_time);
+    
+    // Microseconds spent on a drawn frame: frame goes from the start of the
+    // frame to the end of the swap, which includes ggtp_loop (unless it runs
+    // on its own thread), ggtp_draw and swap (with the pacing waits). The
+    // browser presents once the frame's callback returns, so there a frame
+    // ends when the next one starts and swap includes the wait for it
+    typedef struct {
+        ggt_u64 start; // See ggtp_time_microseconds()
+        ggt_u32 frame;
+        ggt_u32 loop;
+        ggt_u32 draw;
+        ggt_u32 swap;
+    } ggt_frame_timing;
+    
+    // In milliseconds, percentiles have a resolution of 0.1 ms
+    typedef struct {
+        float p50, p95, p99, max;
+    } ggt_timing_stats;
+    
+    typedef struct {
+        ggt_u32 frames;  // In the window, up to GGTP_FRAME_STATS_WINDOW
+        ggt_u32 hitches; // Since the start
+        ggt_timing_stats frame, loop, draw, swap;
+    } ggt_frame_stats;
+    
+    // Over the last GGTP_FRAME_STATS_WINDOW frames (and ggtp_loop calls for loop)
+    ggt_frame_stats ggtp_frame_stats(void);
+    
+    // Gets the frame over budget and the last GGTP_FRAME_HISTORY frames,
+    // oldest first and ending with it. Called on the thread that draws
+    typedef void ggt_hitch_callback(const ggt_frame_timing *hitch, const ggt_frame_timing *recent, ggt_u32 count, void *user_data);
+    // Frames longer than microseconds count as hitches. 0, the default,
+    // means one and a half frame periods of the current pacing
+    void ggtp_set_frame_budget(ggt_u32 microseconds, ggt_hitch_callback *callback, void *user_data);
+    
+    // When ggtp_loop returns GGTP_NO_REDRAW, ggtp_draw is skipped and the
+    // platform sleeps until there is input, the timer set with
+    // ggtp_request_redraw_after fires or ggtp_request_redraw is called.
+    // Both can be called from any thread
+    void ggtp_request_redraw(void);
+    void ggtp_request_redraw_after(ggt_u32 milliseconds);
+    
     void ggtp_program_file_path(const char *name, char *dst);
     void ggtp_user_file_path(const char *name, char *dst);
+    // In nanoseconds since 1970 (as precise as the file system keeps it), 0
+    // if the file can't be found
     ggt_u64 ggtp_file_modification_date(const char *filename);
     
-#if defined(_WIN32)
+    // Watches a directory (found with ggtp_program_file_path) for files that
+    // are written, created, renamed or deleted. Changes are collected until
+    // none happened for GGTP_WATCH_DEBOUNCE milliseconds, then delivered to
+    // ggtp_loop as a single GGTP_EVENT_FILES_CHANGED event. Returns 0 on
+    // failure. Windows and linux only
+    typedef int ggt_watch;
+    ggt_watch ggtp_watch(const char *directory, int recursive);
+    void ggtp_unwatch(ggt_watch watch);
+    
+    typedef enum {
+        GGTP_PRIORITY_LOW,
+        GGTP_PRIORITY_NORMAL,
+        GGTP_PRIORITY_HIGH,
+    } ggt_platform_priority;
+    
+    typedef void ggt_file_callback(ggt_file_request request, ggt_platform_file_status status, void *dst, ggt_u64 size, void *user_data);
+    
+    // Reads the whole file at path into dst (which has room for capacity
+    // bytes) in the background, higher priorities first. When it is done, a
+    // GGTP_EVENT_FILE_READ event is sent to ggtp_loop and, if there is one,
+    // callback is called right before that on the same thread. Call these
+    // from the thread that runs ggtp_loop. Returns 0 on failure
+    ggt_file_request ggtp_read_file_async(const char *path, void *dst, ggt_u64 capacity, ggt_platform_priority priority,
+                                          ggt_file_callback *callback, void *user_data);
+    // Returns GGT_SUCCESS if the read hadn't started, so dst won't be touched
+    // and no event will be sent. Otherwise it completes as usual
+    int ggtp_cancel_file_read(ggt_file_request request);
+    
+    //
+    // Input recording
+    //
+    
+    // Writes the events and keys every ggtp_loop gets, and the time between
+    // frames, to the file at path until ggtp_stop_input_recording is called
+    int  ggtp_record_input(const char *path);
+    void ggtp_stop_input_recording(void);
+    // Plays a recording back: from the next frame on, ggtp_loop gets the
+    // recorded events, keys and frame deltas instead of the window's (only
+    // closing it still gets through). With full_speed frames follow each
+    // other as fast as they can, with vsync and the frame limiter off,
+    // otherwise they are spaced as recorded. When the recording ends, the
+    // frame times are printed as a summary and, if report_path isn't NULL,
+    // written there one frame per line (CSV), the live keys and frame pacing
+    // are restored and a GGTP_EVENT_CLOSE is sent if close_when_done is set
+    int  ggtp_replay_input(const char *path, const char *report_path, int full_speed, int close_when_done);
+    // Time between the start of the previous frame and this one, or the
+    // recorded one while replaying. Use it instead of the clock to advance
+    // the simulation so that replays are deterministic
+    ggt_u64 ggtp_frame_delta_microseconds(void);
+    
+    //
+    // Audio
+    //
+    
+    // Float samples, interleaved if there are two channels. They aren't
+    // copied, so they must stay valid while a voice plays them
+    typedef struct {
+        const float *samples;
+        ggt_u32 frame_count;
+        ggt_u32 channels; // 1 or 2
+        ggt_u32 sample_rate;
+    } ggt_sound;
+    
+    typedef ggt_u32 ggt_voice;
+    
+    // Opens the output (stereo float) and starts mixing on the audio thread.
+    // 0 picks 48000 Hz and 240 frame (5 ms) buffers. The device may choose
+    // another rate, and longer buffers on Windows (its period) and in the
+    // browser (a power of two frames)
+    int  ggtp_audio_start(ggt_u32 sample_rate, ggt_u32 buffer_frames);
+    void ggtp_audio_stop(void);
+    // Commands are queued for the audio thread, which never waits on them.
+    // Call these from the thread that runs ggtp_loop. pan goes from -1
+    // (left) to 1 (right) and pitch scales the playback rate. Returns 0 if
+    // the queue is full. Voices past GGTP_AUDIO_VOICES are dropped
+    ggt_voice ggtp_audio_play(const ggt_sound *sound, float gain, float pan, float pitch, int loop);
+    void ggtp_audio_set_voice(ggt_voice voice, float gain, float pan, float pitch);
+    void ggtp_audio_stop_voice(ggt_voice voice);
+    
+    //
+    // Asset packs
+    //
+    
+    // A pack is a single file built with tools/ggt_packer.c: a header, a hash
+    // table of entries and then the files, each starting on a 4 KB boundary.
+    // All numbers are little endian
+#define GGTP_PACK_MAGIC   0x50544747 // "GGTP"
+#define GGTP_PACK_VERSION 1
+#define GGTP_PACK_ALIGNMENT 4096
+    
+    typedef enum {
+        GGTP_PACK_NONE,
+        GGTP_PACK_LZ4,
+        GGTP_PACK_ZSTD,
+    } ggt_pack_compression;
+    
+    typedef struct {
+        ggt_u32 magic;
+        ggt_u32 version;
+        ggt_u32 entry_count;
+        ggt_u32 slot_count;     // Power of two
+        ggt_u64 entries_offset; // ggt_pack_entry[entry_count]
+        ggt_u64 slots_offset;   // ggt_u32[slot_count], entry index + 1 or 0 if empty
+        ggt_u64 names_offset;
+    } ggt_pack_header;
+    
+    typedef struct {
+        ggt_u64 hash;
+        ggt_u64 offset;
+        ggt_u64 size;        // Once decompressed
+        ggt_u64 stored_size; // In the pack
+        ggt_u32 name_offset; // From names_offset, not null terminated
+        ggt_u32 name_length;
+        ggt_u32 compression; // ggt_pack_compression
+        ggt_u32 reserved;
+    } ggt_pack_entry;
+    
+    typedef struct {
+        const ggt_u8 *data;
+        ggt_u64 size;
+        void *handle;
+        const ggt_pack_header *header;
+        const ggt_pack_entry *entries;
+        const ggt_u32 *slots;
+        const char *names;
+    } ggt_pack;
+    
+    // FNV-1a of an entry name, with backslashes read as '/'. Shared with the packer
+    static inline ggt_u64 ggtp_pack_hash(const char *name, ggt_u32 length){
+        ggt_u64 hash = 14695981039346656037ull;
+        for(ggt_u32 i = 0; i < length; i++)
+            hash = (hash ^ (ggt_u8)((name[i] == '\\') ? '/' : name[i])) * 1099511628211ull;
+        return hash;
+    }
+    
+    // name is found with ggtp_program_file_path. Entries are named by their
+    // path relative to the packed directory, as you would pass them to
+    // ggtp_program_file_path
+    int  ggtp_pack_open(ggt_pack *pack, const char *name);
+    void ggtp_pack_close(ggt_pack *pack);
+    const ggt_pack_entry *ggtp_pack_find(const ggt_pack *pack, const char *name);
+    // Pointer into the mapping, NULL for compressed entries
+    const void *ggtp_pack_data(const ggt_pack *pack, const ggt_pack_entry *entry);
+    // Copies or decompresses the entry into dst, which must have entry->size
+    // bytes. LZ4 and Zstd entries need lz4.h or zstd.h included before the
+    // implementation
+    int  ggtp_pack_read(const ggt_pack *pack, const ggt_pack_entry *entry, void *dst);
+    
+    // Monotonic high-resolution clock, in microseconds
+    ggt_u64 ggtp_time_microseconds(void);
+    
+    typedef void *ggt_thread;
+    typedef int ggt_thread_function(void *data);
+    ggt_thread ggtp_create_thread(ggt_thread_function *function, void *data, const char *name);
+    int ggtp_wait_thread(ggt_thread thread);
+    void ggtp_sleep_microseconds(ggt_u64 microseconds);
+    
+    typedef void *ggt_semaphore;
+    ggt_semaphore ggtp_create_semaphore(ggt_u32 initial_count);
+    void ggtp_destroy_semaphore(ggt_semaphore semaphore);
+    void ggtp_semaphore_post(ggt_semaphore semaphore);
+    // timeout is in milliseconds, negative to wait forever. Returns
+    // GGT_SUCCESS if the semaphore was taken
+    int ggtp_semaphore_wait(ggt_semaphore semaphore, int timeout);
+    
+    // Spinlock on a ggt_u32 that starts at 0, for short sections shared
+    // between threads. Internal, but ggt_gl_utils uses it too
+    void _ggt_platform_lock(ggt_u32 *lock);
+    void _ggt_platform_unlock(ggt_u32 *lock);
+    
+    // For the calling thread. The mask has a bit per logical core (the
+    // first 64). Return GGT_FAILURE where unsupported
+    int ggtp_thread_set_affinity(ggt_u64 core_mask);
+    int ggtp_thread_set_priority(ggt_platform_priority priority);
+    
+    //
+    // System information
+    //
+    
+    typedef enum {
+        GGTP_SIMD_SSE2   = 1 << 0,
+        GGTP_SIMD_SSE4_2 = 1 << 1,
+        GGTP_SIMD_AVX    = 1 << 2,
+        GGTP_SIMD_AVX2   = 1 << 3,
+        GGTP_SIMD_FMA    = 1 << 4,
+        GGTP_SIMD_AVX512 = 1 << 5, // AVX-512 F
+        GGTP_SIMD_NEON   = 1 << 6,
+        GGTP_SIMD_WASM   = 1 << 7, // 128-bit wasm SIMD, known at compile time
+    } ggt_platform_simd;
+    
+    typedef struct {
+        ggt_u32 simd;            // ggt_platform_simd flags supported by both the CPU and the OS
+        ggt_u32 logical_cores;
+        ggt_u32 physical_cores;  // Same as logical_cores if unknown
+        ggt_u32 numa_nodes;      // 1 if unknown
+        ggt_u32 cache_line_size; // 64 if unknown
+        ggt_u32 l1_cache_size;   // Data cache, as seen by one core, in bytes, 0 if unknown
+        ggt_u32 l2_cache_size;
+        ggt_u32 l3_cache_size;
+    } ggt_system_info;
+    
+    // Detected on the first call
+    const ggt_system_info *ggtp_system_info(void);
+    
+#ifdef GGTP_NO_GL
+    // Only the declarations above, for tools
+#elif defined(_WIN32)
 #include <Windows.h>
     
     //
@@ -141,6 +579,25 @@ extern "C" {
 #define GL_DYNAMIC_DRAW                   0x88E8
     
 #define GL_ARRAY_BUFFER                   0x8892
+#define GL_ELEMENT_ARRAY_BUFFER           0x8893
+#define GL_VERTEX_ARRAY_BINDING           0x85B5
+    
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT       0x0004
+#define GL_MAP_FLUSH_EXPLICIT_BIT         0x0010
+#define GL_MAP_UNSYNCHRONIZED_BIT         0x0020
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_DYNAMIC_STORAGE_BIT            0x0100
+    
+#define GL_NUM_EXTENSIONS                 0x821D
+    
+#define GL_PIXEL_UNPACK_BUFFER            0x88EC
+#define GL_TEXTURE_BASE_LEVEL             0x813C
+#define GL_TEXTURE_MAX_LEVEL              0x813D
+#define GL_TEXTURE_2D_ARRAY               0x8C1A
+#define GL_TEXTURE_BINDING_2D_ARRAY       0x8C1D
+#define GL_CLAMP_TO_EDGE                  0x812F
     
 #define GL_TEXTURE0                       0x84C0
 #define GL_TEXTURE1                       0x84C1
@@ -184,6 +641,21 @@ extern "C" {
 #define GL_VALIDATE_STATUS                0x8B83
 #define GL_INFO_LOG_LENGTH                0x8B84
     
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+    
+    typedef struct __GLsync *GLsync;
+    typedef unsigned long long GLuint64;
+    
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
+#define GL_TIMEOUT_IGNORED                0xFFFFFFFFFFFFFFFFull
+#define GL_ALREADY_SIGNALED               0x911A
+#define GL_TIMEOUT_EXPIRED                0x911B
+#define GL_CONDITION_SATISFIED            0x911C
+#define GL_WAIT_FAILED                    0x911D
+    
 #endif
     
 #define GGTP_GL_FUNCTION_LIST \
@@ -220,18 +692,38 @@ extern "C" {
     GL_FUNCTION(void, glVertexAttribIPointer, GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer) \
     GL_FUNCTION(void, glBindVertexArray, GLuint array) \
     GL_FUNCTION(void, glGenVertexArrays, GLsizei n, GLuint* arrays) \
+    GL_FUNCTION(void, glDeleteVertexArrays, GLsizei n, const GLuint* arrays) \
+    GL_FUNCTION(void, glVertexAttribDivisor, GLuint index, GLuint divisor) \
+    GL_FUNCTION(void, glVertexAttrib4fv, GLuint index, const GLfloat* v) \
+    GL_FUNCTION(void, glDrawArraysInstanced, GLenum mode, GLint first, GLsizei count, GLsizei instancecount) \
+    GL_FUNCTION(void, glDrawElementsInstanced, GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount) \
     GL_FUNCTION(void, glBindBuffer, GLenum target, GLuint buffer) \
     GL_FUNCTION(void, glGenBuffers, GLsizei n, GLuint* buffers) \
     GL_FUNCTION(void, glBufferData, GLenum target, GLsizeiptr size, const void* data, GLenum usage) \
+    GL_FUNCTION(void, glBufferSubData, GLenum target, GLintptr offset, GLsizeiptr size, const void* data) \
+    GL_FUNCTION(void, glBufferStorage, GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) \
+    GL_FUNCTION(void*, glMapBufferRange, GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) \
+    GL_FUNCTION(GLboolean, glUnmapBuffer, GLenum target) \
+    GL_FUNCTION(void, glDeleteBuffers, GLsizei n, const GLuint* buffers) \
     GL_FUNCTION(void, glActiveTexture, GLenum texture) \
     GL_FUNCTION(void, glDeleteProgram, GLuint program) \
     GL_FUNCTION(void, glDeleteShader, GLuint shader) \
+    GL_FUNCTION(void, glDetachShader, GLuint program, GLuint shader) \
+    GL_FUNCTION(void, glGetProgramBinary, GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary) \
+    GL_FUNCTION(void, glProgramBinary, GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) \
+    GL_FUNCTION(void, glProgramParameteri, GLuint program, GLenum pname, GLint value) \
     GL_FUNCTION(void, glDeleteFramebuffers, GLsizei n, const GLuint* framebuffers) \
     GL_FUNCTION(void, glDrawBuffers, GLsizei n, const GLenum* bufs) \
     GL_FUNCTION(void, glTexImage3D, GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) \
+    GL_FUNCTION(void, glCompressedTexImage2D, GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const void* data) \
+    GL_FUNCTION(void, glCompressedTexSubImage2D, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data) \
     GL_FUNCTION(void, glTexSubImage3D, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) \
     GL_FUNCTION(void, glDrawElementsBaseVertex, GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex) \
     GL_FUNCTION(const GLubyte* WINAPI, glGetStringi, GLenum name, GLuint index) \
+    GL_FUNCTION(GLsync, glFenceSync, GLenum condition, GLbitfield flags) \
+    GL_FUNCTION(GLenum, glClientWaitSync, GLsync sync, GLbitfield flags, GLuint64 timeout) \
+    GL_FUNCTION(void, glWaitSync, GLsync sync, GLbitfield flags, GLuint64 timeout) \
+    GL_FUNCTION(void, glDeleteSync, GLsync sync) \
     
     // Define gl function types
 #define GL_FUNCTION(TYPE, NAME, ...) typedef TYPE WINAPI _ggtp_gl_type_##NAME(__VA_ARGS__);
@@ -280,277 +772,4254 @@ extern "C" {
     
 #define ggt_globals ggt_platform_globals
     
-#define GGT_PLATFORM_ADD_EVENT(type_id, field, ...) do{ if(ggt_globals.events.size < GGTP_MAX_EVENTS_PER_LOOP){ \
-            ggt_globals.events.data[ggt_globals.events.size  ].type = type_id; \
-            _ggt_platform_event_type_of_##field info = __VA_ARGS__ ; \
-            ggt_globals.events.data[ggt_globals.events.size++].info.field = info; \
-        } }while(0)
+#if defined(__EMSCRIPTEN__) && defined(GGTP_INPUT_THREAD)
+#undef GGTP_INPUT_THREAD // The browser gives us no thread to pump input on
+#endif
     
+#if defined(__EMSCRIPTEN__) && defined(GGTP_HOT_RELOAD)
+#undef GGTP_HOT_RELOAD // No shared libraries in the browser
+#endif
     
+#if defined(GGTP_RENDER_THREAD) && !defined(GGTP_PROGRAM_STATE)
+#error "GGTP_RENDER_THREAD needs a GGTP_PROGRAM_STATE"
+#endif
     
-#if defined(_WIN32)
-    //
-    // Windows implementation
-    //
+#if defined(GGTP_HOT_RELOAD) && defined(GGTP_RENDER_THREAD)
+#error "GGTP_HOT_RELOAD can't swap code while ggtp_loop and ggtp_draw run on different threads"
+#endif
     
-#pragma comment(lib, "user32.lib")
-#pragma comment(lib, "opengl32.lib")
-#pragma comment(lib, "gdi32.lib")
+#ifndef GGTP_HOT_RELOAD_DELAY
+#define GGTP_HOT_RELOAD_DELAY 300
+#endif
     
-#include <initguid.h>
-#include <KnownFolders.h>
-    //#include <ShlObj.h>
-#include <wchar.h>
-#include <windowsx.h>
-#include <WinUser.h>
+#ifndef GGTP_WATCH_DEBOUNCE
+#define GGTP_WATCH_DEBOUNCE 100
+#endif
     
-#define GGT_PLATFORM_ALERT_ERROR(message, code) MessageBox(NULL, message "\n(ggt_platform error " code ")", "ERROR", MB_OK);
+    // Events go through a ring whenever they are consumed on another thread
+#if defined(GGTP_INPUT_THREAD) || (defined(GGTP_RENDER_THREAD) && !defined(__EMSCRIPTEN__))
+#define _GGTP_EVENT_RING
+#endif
     
-#ifdef GGTP_PROGRAM_STATE
-#define GGTP_INIT() ggtp_init(&program_state)
-#define GGTP_LOOP(a, b) ggtp_loop(&program_state, a, b)
-#define GGTP_DRAW() ggtp_draw(&program_state)
+#include <stdlib.h>
+#include <string.h>
+    
+#define _GGTP_PATH_SIZE 1024
+    
+    //
+    // Atomics (only what the lock-free rings need)
+    //
+    
+#if defined(_MSC_VER)
+#define GGTP_ATOMIC_LOAD(p)        ((ggt_u32)InterlockedCompareExchange((volatile LONG *)(p), 0, 0))
+#define GGTP_ATOMIC_STORE(p, v)    InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#define GGTP_ATOMIC_EXCHANGE(p, v) ((ggt_u32)InterlockedExchange((volatile LONG *)(p), (LONG)(v)))
 #else
-#define GGTP_INIT() ggtp_init()
-#define GGTP_LOOP(a, b) ggtp_loop(a, b)
-#define GGTP_DRAW() ggtp_draw()
+#define GGTP_ATOMIC_LOAD(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define GGTP_ATOMIC_STORE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define GGTP_ATOMIC_EXCHANGE(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
 #endif
     
+    // Spinlock for the few short sections shared between threads
+    void _ggt_platform_lock(ggt_u32 *lock){
+        while(GGTP_ATOMIC_EXCHANGE(lock, 1));
+    }
+    
+    void _ggt_platform_unlock(ggt_u32 *lock){
+        GGTP_ATOMIC_STORE(lock, 0);
+    }
+    
     //
-    // WGL preprocessor and function definitions
-    // (From https://www.khronos.org/registry/OpenGL/api/GL/wglext.h)
+    // Event queue
     //
     
-#ifndef __wgl_wglext_h_
+#ifdef _GGTP_EVENT_RING
+#define GGT_PLATFORM_QUEUE_EVENT(event) _ggt_platform_ring_push(&ggt_globals.event_ring, event)
+#else
+#define GGT_PLATFORM_QUEUE_EVENT(event) _ggt_platform_push_event(&ggt_globals.events, ggt_globals.keys, event)
+#endif
     
-    // Context creation
-#define WGL_CONTEXT_DEBUG_BIT_ARB         0x00000001
-#define WGL_CONTEXT_FORWARD_COMPATIBLE_BIT_ARB 0x00000002
-#define WGL_CONTEXT_MAJOR_VERSION_ARB     0x2091
-#define WGL_CONTEXT_MINOR_VERSION_ARB     0x2092
-#define WGL_CONTEXT_LAYER_PLANE_ARB       0x2093
-#define WGL_CONTEXT_FLAGS_ARB             0x2094
-#define ERROR_INVALID_VERSION_ARB         0x2095
-    typedef HGLRC (WINAPI * PFNWGLCREATECONTEXTATTRIBSARBPROC) (HDC hDC, HGLRC hShareContext, const int *attribList);
+    // Wake up the thread calling ggtp_loop in case it is waiting for input
+#if defined(GGTP_RENDER_THREAD) && !defined(__EMSCRIPTEN__)
+#define GGT_PLATFORM_WAKE_ON_EVENT() _ggt_platform_wake_simulation()
+#elif defined(GGTP_INPUT_THREAD) || defined(__EMSCRIPTEN__)
+#define GGT_PLATFORM_WAKE_ON_EVENT() _ggt_platform_wake()
+#else
+#define GGT_PLATFORM_WAKE_ON_EVENT()
+#endif
     
-    // Swap interval
-    typedef BOOL (WINAPI * PFNWGLSWAPINTERVALEXTPROC) (int interval);
-    typedef int (WINAPI * PFNWGLGETSWAPINTERVALEXTPROC) (void);
-    BOOL WINAPI wglSwapIntervalEXT (int interval);
-    int WINAPI wglGetSwapIntervalEXT (void);
+#define GGT_PLATFORM_ADD_EVENT(type_id, field, ...) do{ \
+            ggt_platform_event event; \
+            event.type = type_id; \
+            event.timestamp = ggtp_time_microseconds(); \
+            _ggt_platform_event_type_of_##field info = __VA_ARGS__ ; \
+            event.info.field = info; \
+            GGT_PLATFORM_QUEUE_EVENT(event); \
+            GGT_PLATFORM_WAKE_ON_EVENT(); \
+        }while(0)
     
+    void _ggt_platform_wake(void);
+#if defined(GGTP_RENDER_THREAD) && !defined(__EMSCRIPTEN__)
+    void _ggt_platform_wake_simulation(void);
+#else
+#define _ggt_platform_wake_simulation()
 #endif
     
-    //
-    //
-    //
-    
-    struct {
-        ggt_platform_events events;
-        ggt_u8 keys[GGTP_TOTAL_KEYS];
-        ggt_vec2i last_mouse_position;
+    void _ggt_platform_push_event(ggt_platform_events *events, ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_event event){
+        // The key table is updated even if the event doesn't fit in the queue
+        if(event.type == GGTP_EVENT_KEY_DOWN || event.type == GGTP_EVENT_KEY_UP){
+            ggt_u8 value = (ggt_u8)event.info.key;
+            if(value < GGTP_TOTAL_KEYS)
+                keys[value] = (event.type == GGTP_EVENT_KEY_DOWN);
+        }
         
-        HWND hWnd;
-        HDC hDC;
-        HGLRC hRC;
-        HINSTANCE hInstance;
-    } ggt_globals;
-    
-    ggt_u8 _ggt_platform_get_key_code(ggt_u32 code) {
-        switch (code) {
-            case VK_LEFT:
-            return GGTP_KEY_LEFT;
-            break;
-            case VK_UP:
-            return GGTP_KEY_UP;
-            break;
-            case VK_RIGHT:
-            return GGTP_KEY_RIGHT;
-            break;
-            case VK_DOWN:
-            return GGTP_KEY_DOWN;
-            case VK_ESCAPE:
-            return GGTP_KEY_ESC;
-            case VK_LSHIFT:
-            case VK_RSHIFT:
-            case VK_SHIFT:
-            return GGTP_KEY_SHIFT;
-            case VK_SPACE:
-            return GGTP_KEY_SPACE;
-            default:
-            return (ggt_u8)code;
+#ifdef GGTP_COALESCE_EVENTS
+        // Merge with the previous event if it is of the same kind, keeping
+        // the newest position/size and timestamp
+        if(events->size > 0){
+            ggt_platform_event *last = &events->data[events->size-1];
+            if(last->type == event.type){
+                if(event.type == GGTP_EVENT_MOUSE_MOVE){
+                    last->info.mouse_movement.position = event.info.mouse_movement.position;
+                    last->info.mouse_movement.difference.x += event.info.mouse_movement.difference.x;
+                    last->info.mouse_movement.difference.y += event.info.mouse_movement.difference.y;
+                    last->timestamp = event.timestamp;
+                    return;
+                }else if(event.type == GGTP_EVENT_RESIZE){
+                    last->info.size = event.info.size;
+                    last->timestamp = event.timestamp;
+                    return;
+                }
+            }
         }
+#endif
+        if(events->size < GGTP_MAX_EVENTS_PER_LOOP)
+            events->data[events->size++] = event;
     }
     
-    LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam){
-        switch(msg){
-            case WM_CREATE:
-            break;
-            
-            case WM_SIZE:
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_RESIZE, size, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
-            break;
-            
-            case WM_SYSKEYDOWN:
-            case WM_KEYDOWN: {
-                ggt_u8 value = _ggt_platform_get_key_code((ggt_u32)wParam);
-                if(value < GGTP_TOTAL_KEYS)
-                    ggt_globals.keys[value] = 1;
-                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_KEY_DOWN, key, value);
-            } break;
-            
-            case WM_SYSKEYUP:
-            case WM_KEYUP: {
-                ggt_u8 value = _ggt_platform_get_key_code((ggt_u32)wParam);
-                if(value < GGTP_TOTAL_KEYS)
-                    ggt_globals.keys[value] = 0;
-                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_KEY_UP, key, value);
-            } break;
-            
-            case WM_LBUTTONDOWN:
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_DOWN, coords, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
-            break;
-            
-            case WM_RBUTTONDOWN:
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_RIGHT_DOWN, coords, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
-            break;
-            
-            case WM_LBUTTONUP:
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_UP, coords, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
-            break;
-            
-            case WM_RBUTTONUP:
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_RIGHT_UP, coords, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
-            break;
-            
-            case WM_MOUSEMOVE: {
-                ggt_vec2i position = {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)};
-                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_MOVE, mouse_movement, {position.x, position.y, position.x - ggt_globals.last_mouse_position.x, position.y - ggt_globals.last_mouse_position.y});
-                ggt_globals.last_mouse_position = position;
-            } break;
-            
-            case WM_DESTROY:
-            case WM_QUIT:
-            case WM_CLOSE:
-            ggt_globals.events.data[ggt_globals.events.size++].type = GGTP_EVENT_CLOSE;
-            PostQuitMessage(0);
-            break;
-        }
-        return DefWindowProc(hWnd, msg, wParam, lParam);
+#ifndef GGTP_INPUT_THREAD_HZ
+#define GGTP_INPUT_THREAD_HZ 1000
+#endif
+    
+#ifdef _GGTP_EVENT_RING
+    
+#ifndef GGTP_INPUT_RING_SIZE
+#define GGTP_INPUT_RING_SIZE 1024
+#endif
+    
+#if (GGTP_INPUT_RING_SIZE & (GGTP_INPUT_RING_SIZE - 1)) != 0
+#error "GGTP_INPUT_RING_SIZE must be a power of two"
+#endif
+    
+    // Room for a press and a release of every key
+#define _GGTP_KEY_STASH_SIZE (2 * GGTP_TOTAL_KEYS)
+    
+    // Single-producer (the thread pumping OS events), single-consumer (the
+    // thread calling ggtp_loop) ring. read and write only ever increase and
+    // are kept on separate cache lines. Key events that don't fit are kept
+    // in order by the producer until there is room, so a key release is
+    // never lost.
+    typedef struct {
+        ggt_platform_event data[GGTP_INPUT_RING_SIZE];
+        ggt_u32 write;
+        ggt_u8 padding[64 - sizeof(ggt_u32)];
+        ggt_u32 read;
+        ggt_u8 padding_read[64 - sizeof(ggt_u32)];
+        ggt_platform_event stashed_keys[_GGTP_KEY_STASH_SIZE];
+        int stashed_count;
+    } _ggt_platform_event_ring;
+    
+    int _ggt_platform_ring_put(_ggt_platform_event_ring *ring, ggt_platform_event event){
+        ggt_u32 write = ring->write;
+        if(write - GGTP_ATOMIC_LOAD(&ring->read) >= GGTP_INPUT_RING_SIZE)
+            return GGT_FAILURE;
+        ring->data[write & (GGTP_INPUT_RING_SIZE - 1)] = event;
+        GGTP_ATOMIC_STORE(&ring->write, write + 1);
+        return GGT_SUCCESS;
     }
     
-#define GGT_PLATFORM_WINDOW_CLASS_NAME "WINDOWCLASS"
+    // Producer side. Moves the stashed key events into the ring, returns
+    // GGT_FAILURE if some are still waiting for room
+    int _ggt_platform_ring_flush(_ggt_platform_event_ring *ring){
+        int sent = 0;
+        while(sent < ring->stashed_count && _ggt_platform_ring_put(ring, ring->stashed_keys[sent]) == GGT_SUCCESS)
+            sent++;
+        ring->stashed_count -= sent;
+        memmove(ring->stashed_keys, ring->stashed_keys + sent, ring->stashed_count * sizeof(ggt_platform_event));
+        return ring->stashed_count ? GGT_FAILURE : GGT_SUCCESS;
+    }
     
-#define GL_FUNCTION(TYPE, NAME, ...) _ggtp_gl_type_##NAME *NAME;
-    GGTP_GL_FUNCTION_LIST
-#undef GL_FUNCTION
+    void _ggt_platform_ring_unstash(_ggt_platform_event_ring *ring, int index){
+        ring->stashed_count--;
+        memmove(ring->stashed_keys + index, ring->stashed_keys + index + 1, (ring->stashed_count - index) * sizeof(ggt_platform_event));
+    }
     
-        int ggtp_create_window(int width, int height, const char *window_name){
-        int screen_x = GetSystemMetrics(SM_CXSCREEN);
+    // Per key the stashed events go down, up, down..., as repeats change
+    // nothing. When it is full a press and a release of the same key are
+    // dropped together, which leaves every key as it would have ended up
+    void _ggt_platform_ring_stash(_ggt_platform_event_ring *ring, ggt_platform_event event){
+        int last = ring->stashed_count - 1;
+        while(last >= 0 && ring->stashed_keys[last].info.key != event.info.key)
+            last--;
+        if(last >= 0 && ring->stashed_keys[last].type == event.type)
+            return;
+        if(ring->stashed_count == _GGTP_KEY_STASH_SIZE){
+            if(last >= 0){
+                _ggt_platform_ring_unstash(ring, last);
+                return;
+            }
+            // Another key has at least two, as there are more than keys
+            int newest[GGTP_TOTAL_KEYS];
+            for(int i=0; i<GGTP_TOTAL_KEYS; i++)
+                newest[i] = -1;
+            for(int i=ring->stashed_count - 1; i >= 0; i--){
+                ggt_u8 key = (ggt_u8)ring->stashed_keys[i].info.key;
+                if(newest[key] >= 0){
+                    _ggt_platform_ring_unstash(ring, newest[key]);
+                    _ggt_platform_ring_unstash(ring, i);
+                    break;
+                }
+                newest[key] = i;
+            }
+        }
+        ring->stashed_keys[ring->stashed_count++] = event;
+    }
+    
+    int _ggt_platform_ring_push(_ggt_platform_event_ring *ring, ggt_platform_event event){
+        // Stashed key events go first so they stay in order with the new one
+        if(ring->stashed_count == 0 || _ggt_platform_ring_flush(ring) == GGT_SUCCESS){
+            if(_ggt_platform_ring_put(ring, event) == GGT_SUCCESS)
+                return GGT_SUCCESS;
+        }
+        
+        // Full: other events are dropped, key events wait for room
+        if((event.type == GGTP_EVENT_KEY_DOWN || event.type == GGTP_EVENT_KEY_UP) && (ggt_u8)event.info.key < GGTP_TOTAL_KEYS)
+            _ggt_platform_ring_stash(ring, event);
+        return GGT_FAILURE;
+    }
+    
+    int _ggt_platform_ring_empty(_ggt_platform_event_ring *ring){
+        return ring->read == GGTP_ATOMIC_LOAD(&ring->write);
+    }
+    
+    int _ggt_platform_ring_pop(_ggt_platform_event_ring *ring, ggt_platform_event *event){
+        ggt_u32 read = ring->read;
+        if(read == GGTP_ATOMIC_LOAD(&ring->write))
+            return GGT_FAILURE;
+        *event = ring->data[read & (GGTP_INPUT_RING_SIZE - 1)];
+        GGTP_ATOMIC_STORE(&ring->read, read + 1);
+        return GGT_SUCCESS;
+    }
+    
+    // Moves as many events as fit in this frame's queue; the rest stay in the
+    // ring for the next frame
+    void _ggt_platform_drain_event_ring(_ggt_platform_event_ring *ring, ggt_platform_events *events, ggt_u8 keys[GGTP_TOTAL_KEYS]){
+        ggt_platform_event event;
+        events->size = 0;
+        while(events->size < GGTP_MAX_EVENTS_PER_LOOP && _ggt_platform_ring_pop(ring, &event))
+            _ggt_platform_push_event(events, keys, event);
+    }
+    
+    int _ggt_platform_gl_thread(void *data);
+    
+#endif
+    
+    //
+    // Memory arenas
+    //
+    
+#ifndef GGTP_ARENA_COMMIT_SIZE
+#define GGTP_ARENA_COMMIT_SIZE (1 << 20)
+#endif
+    
+#ifdef __EMSCRIPTEN__
+    // No lazy commit in wasm, the whole reservation is allocated
+#ifndef GGTP_PERMANENT_MEMORY_SIZE
+#define GGTP_PERMANENT_MEMORY_SIZE (64ull << 20)
+#endif
+#ifndef GGTP_TRANSIENT_MEMORY_SIZE
+#define GGTP_TRANSIENT_MEMORY_SIZE (64ull << 20)
+#endif
+#ifndef GGTP_FRAME_MEMORY_SIZE
+#define GGTP_FRAME_MEMORY_SIZE (16ull << 20)
+#endif
+#else
+#ifndef GGTP_PERMANENT_MEMORY_SIZE
+#define GGTP_PERMANENT_MEMORY_SIZE (1ull << 30)
+#endif
+#ifndef GGTP_TRANSIENT_MEMORY_SIZE
+#define GGTP_TRANSIENT_MEMORY_SIZE (1ull << 30)
+#endif
+#ifndef GGTP_FRAME_MEMORY_SIZE
+#define GGTP_FRAME_MEMORY_SIZE (64ull << 20)
+#endif
+#endif
+    
+#ifndef GGTP_LARGE_PAGES_MAX_SIZE
+#define GGTP_LARGE_PAGES_MAX_SIZE (256ull << 20)
+#endif
+    
+#ifdef GGTP_HUGE_PAGES
+#define _GGTP_HUGE_PAGES 1
+#else
+#define _GGTP_HUGE_PAGES 0
+#endif
+    
+    // Platform specific. Reserve fills base, reserved and committed
+    int  _ggt_platform_reserve_memory(ggt_arena *arena, ggt_u64 size, int huge_pages);
+    int  _ggt_platform_commit_memory(void *address, ggt_u64 size);
+    void _ggt_platform_release_memory(ggt_arena *arena);
+    
+    int ggtp_arena_create(ggt_arena *arena, ggt_u64 reserve_size, int huge_pages){
+        arena->base = NULL;
+        arena->used = arena->committed = arena->reserved = arena->peak = 0;
+        if(_ggt_platform_reserve_memory(arena, reserve_size, huge_pages) == GGT_FAILURE){
+            printf("ggtp_arena_create error: Couldn't reserve %llu bytes\n", reserve_size);
+            return GGT_FAILURE;
+        }
+        return GGT_SUCCESS;
+    }
+    
+    void ggtp_arena_destroy(ggt_arena *arena){
+        if(arena->base)
+            _ggt_platform_release_memory(arena);
+        arena->base = NULL;
+        arena->used = arena->committed = arena->reserved = 0;
+    }
+    
+    void *ggtp_arena_push(ggt_arena *arena, ggt_u64 size){
+        ggt_u64 start = (arena->used + 15) & ~(ggt_u64)15;
+        ggt_u64 end = start + size;
+        if(end > arena->reserved){
+            printf("ggtp_arena_push error: Arena is full (%llu of %llu bytes)\n", start, arena->reserved);
+            return NULL;
+        }
+        
+        if(end > arena->committed){
+            ggt_u64 commit_end = (end + GGTP_ARENA_COMMIT_SIZE - 1) / GGTP_ARENA_COMMIT_SIZE * GGTP_ARENA_COMMIT_SIZE;
+            if(commit_end > arena->reserved)
+                commit_end = arena->reserved;
+            if(_ggt_platform_commit_memory(arena->base + arena->committed, commit_end - arena->committed) == GGT_FAILURE){
+                printf("ggtp_arena_push error: Couldn't commit memory\n");
+                return NULL;
+            }
+            arena->committed = commit_end;
+        }
+        
+        arena->used = end;
+        if(end > arena->peak)
+            arena->peak = end;
+        return arena->base + start;
+    }
+    
+    void *ggtp_arena_push_zero(ggt_arena *arena, ggt_u64 size){
+        void *result = ggtp_arena_push(arena, size);
+        if(result)
+            memset(result, 0, (size_t)size);
+        return result;
+    }
+    
+    void ggtp_arena_reset(ggt_arena *arena){
+        arena->used = 0;
+    }
+    
+    ggt_u64 ggtp_arena_mark(ggt_arena *arena){
+        return arena->used;
+    }
+    
+    void ggtp_arena_pop_to(ggt_arena *arena, ggt_u64 mark){
+        if(mark < arena->used)
+            arena->used = mark;
+    }
+    
+#ifdef GGTP_MEMORY
+    ggt_platform_memory ggt_platform_memory_state;
+    
+    int _ggt_platform_init_memory(void){
+        if(ggtp_arena_create(&ggt_platform_memory_state.permanent, GGTP_PERMANENT_MEMORY_SIZE, _GGTP_HUGE_PAGES) == GGT_FAILURE ||
+           ggtp_arena_create(&ggt_platform_memory_state.transient, GGTP_TRANSIENT_MEMORY_SIZE, _GGTP_HUGE_PAGES) == GGT_FAILURE ||
+           ggtp_arena_create(&ggt_platform_memory_state.frame, GGTP_FRAME_MEMORY_SIZE, _GGTP_HUGE_PAGES) == GGT_FAILURE)
+            return GGT_FAILURE;
+        return GGT_SUCCESS;
+    }
+    
+#define GGT_PLATFORM_RESET_FRAME_MEMORY() ggtp_arena_reset(&ggt_platform_memory_state.frame)
+#else
+#define GGT_PLATFORM_RESET_FRAME_MEMORY()
+#endif
+    
+    //
+    // Frame pacing
+    //
+    
+#ifndef GGTP_DEFAULT_PACING
+#define GGTP_DEFAULT_PACING GGTP_PACING_VSYNC
+#endif
+    
+#ifndef GGTP_DEFAULT_TARGET_HZ
+#define GGTP_DEFAULT_TARGET_HZ 60
+#endif
+    
+#ifndef GGTP_DEFAULT_JUST_IN_TIME
+#define GGTP_DEFAULT_JUST_IN_TIME 0
+#endif
+    
+#ifndef GGTP_JUST_IN_TIME_MARGIN
+#define GGTP_JUST_IN_TIME_MARGIN 1500
+#endif
+    
+    // Waits closer to a deadline than this are spun instead of slept
+#define GGTP_PACING_SPIN_MICROSECONDS 2000
+    
+    // The settings requested through ggtp_set_frame_pacing, packed in one
+    // word so that they are published at once: the pacing in the low 4 bits,
+    // just_in_time in the next one and target_hz above
+#define _GGTP_PACK_PACING(pacing, target_hz, just_in_time) \
+        ((ggt_u32)(pacing) | ((just_in_time) ? 0x10u : 0u) | ((ggt_u32)(target_hz) << 5))
+    
+    struct {
+        // Only used by the thread that draws, copied from requested in
+        // _ggt_platform_begin_frame
+        ggt_platform_pacing pacing;
+        int target_hz;
+        int just_in_time;
+        
+        ggt_u32 requested;
+        ggt_u32 changed;
+        ggt_u32 replaying; // A full speed replay overrides the requested pacing
+        
+        ggt_u64 refresh_period; // Of the display, in microseconds
+        ggt_u64 frame_start;
+        ggt_u64 work_end;
+        ggt_u64 work_estimate;  // Of the time from frame start to swap
+        ggt_u64 last_present;   // When the last frame was (or was scheduled to be) presented
+        int frame_pending;      // In the browser, until the next frame starts
+    } ggt_platform_pacing_state = {
+        GGTP_DEFAULT_PACING, GGTP_DEFAULT_TARGET_HZ, GGTP_DEFAULT_JUST_IN_TIME,
+        _GGTP_PACK_PACING(GGTP_DEFAULT_PACING, GGTP_DEFAULT_TARGET_HZ, GGTP_DEFAULT_JUST_IN_TIME), 0, 0,
+        1000000 / 60, 0, 0, 0, 0
+    };
+    
+    void _ggt_platform_apply_frame_pacing(void);
+    
+    void ggtp_set_frame_pacing(ggt_platform_pacing pacing, int target_hz, int just_in_time){
+        if(target_hz <= 0 || target_hz > (1 << 20))
+            target_hz = GGTP_DEFAULT_TARGET_HZ;
+        GGTP_ATOMIC_STORE(&ggt_platform_pacing_state.requested, _GGTP_PACK_PACING(pacing, target_hz, just_in_time));
+        // The swap interval belongs to the context, so the thread drawing applies it
+        GGTP_ATOMIC_STORE(&ggt_platform_pacing_state.changed, 1);
+    }
+    
+    void _ggt_platform_set_replay_pacing(int full_speed){
+        GGTP_ATOMIC_STORE(&ggt_platform_pacing_state.replaying, full_speed ? 1 : 0);
+        GGTP_ATOMIC_STORE(&ggt_platform_pacing_state.changed, 1);
+    }
+    
+    int _ggt_platform_swap_interval(void){
+        switch(ggt_platform_pacing_state.pacing){
+            case GGTP_PACING_VSYNC:
+            return 1;
+            case GGTP_PACING_ADAPTIVE_VSYNC:
+            return -1;
+            default:
+            return 0;
+        }
+    }
+    
+    ggt_u64 _ggt_platform_frame_period(void){
+        if(ggt_platform_pacing_state.pacing == GGTP_PACING_LIMITED)
+            return 1000000 / ggt_platform_pacing_state.target_hz;
+        return ggt_platform_pacing_state.refresh_period;
+    }
+    
+    void _ggt_platform_wait_until(ggt_u64 deadline){
+        ggt_u64 now = ggtp_time_microseconds();
+        if(now + GGTP_PACING_SPIN_MICROSECONDS < deadline)
+            ggtp_sleep_microseconds(deadline - now - GGTP_PACING_SPIN_MICROSECONDS);
+        while(ggtp_time_microseconds() < deadline);
+    }
+    
+    void _ggt_platform_end_frame(ggt_u64 frame_start, ggt_u64 work_end, ggt_u64 now);
+    void _ggt_platform_finish_gl_jobs(void);
+    
+    // Called by the thread that draws, before it samples input for a new frame
+#ifdef GGTP_HOT_RELOAD
+    void _ggt_platform_reload_code(void);
+#endif
+    
+    void _ggt_platform_begin_frame(void){
+#ifdef GGTP_HOT_RELOAD
+        // Between frames, so no user code is running
+        _ggt_platform_reload_code();
+#endif
+        
+#ifdef __EMSCRIPTEN__
+        if(ggt_platform_pacing_state.frame_pending){
+            ggt_platform_pacing_state.frame_pending = 0;
+            _ggt_platform_end_frame(ggt_platform_pacing_state.frame_start, ggt_platform_pacing_state.work_end,
+                                    ggtp_time_microseconds());
+        }
+#endif
+        
+        if(GGTP_ATOMIC_EXCHANGE(&ggt_platform_pacing_state.changed, 0)){
+            ggt_u32 requested = GGTP_ATOMIC_LOAD(&ggt_platform_pacing_state.requested);
+            ggt_platform_pacing_state.pacing = (ggt_platform_pacing)(requested & 0xf);
+            ggt_platform_pacing_state.just_in_time = (requested & 0x10) != 0;
+            ggt_platform_pacing_state.target_hz = (int)(requested >> 5);
+            if(GGTP_ATOMIC_LOAD(&ggt_platform_pacing_state.replaying)){
+                ggt_platform_pacing_state.pacing = GGTP_PACING_UNCAPPED;
+                ggt_platform_pacing_state.just_in_time = 0;
+            }
+            _ggt_platform_apply_frame_pacing();
+        }
+        
+#ifndef __EMSCRIPTEN__
+        // Start just late enough for the frame to be ready right before the
+        // next present, so that its input is as fresh as possible
+        if(ggt_platform_pacing_state.just_in_time && ggt_platform_pacing_state.pacing != GGTP_PACING_UNCAPPED &&
+           ggt_platform_pacing_state.last_present){
+            ggt_u64 next_present = ggt_platform_pacing_state.last_present + _ggt_platform_frame_period();
+            ggt_u64 lead = ggt_platform_pacing_state.work_estimate + GGTP_JUST_IN_TIME_MARGIN;
+            if(next_present > lead)
+                _ggt_platform_wait_until(next_present - lead);
+        }
+#endif
+        ggt_platform_pacing_state.frame_start = ggtp_time_microseconds();
+        
+        // Objects loaded in the background become usable from this frame on
+        _ggt_platform_finish_gl_jobs();
+    }
+    
+    // Called by the thread that calls ggtp_loop once the frame is over, drawn
+    // or not. With a simulation thread the frame arena belongs to it instead
+    void _ggt_platform_end_frame_memory(void){
+#if !defined(GGTP_RENDER_THREAD) || defined(__EMSCRIPTEN__)
+        GGT_PLATFORM_RESET_FRAME_MEMORY();
+#endif
+    }
+    
+    void _ggt_platform_before_swap(void){
+        ggt_platform_pacing_state.work_end = ggtp_time_microseconds();
+#ifndef __EMSCRIPTEN__
+        if(ggt_platform_pacing_state.pacing == GGTP_PACING_LIMITED && ggt_platform_pacing_state.last_present)
+            _ggt_platform_wait_until(ggt_platform_pacing_state.last_present + _ggt_platform_frame_period());
+#endif
+    }
+    
+    void _ggt_platform_after_swap(void){
+        _ggt_platform_end_frame_memory();
+        
+        ggt_u64 now = ggtp_time_microseconds();
+#ifdef __EMSCRIPTEN__
+        // Presented after returning to the browser, see _ggt_platform_begin_frame
+        ggt_platform_pacing_state.frame_pending = 1;
+#else
+        _ggt_platform_end_frame(ggt_platform_pacing_state.frame_start, ggt_platform_pacing_state.work_end, now);
+#endif
+        
+        // Rise immediately, decay slowly: underestimating makes just-in-time frames late
+        ggt_u64 work = ggt_platform_pacing_state.work_end - ggt_platform_pacing_state.frame_start;
+        if(work > ggt_platform_pacing_state.work_estimate)
+            ggt_platform_pacing_state.work_estimate = work;
+        else
+            ggt_platform_pacing_state.work_estimate = (ggt_platform_pacing_state.work_estimate * 15 + work) / 16;
+        
+        if(ggt_platform_pacing_state.pacing == GGTP_PACING_LIMITED && ggt_platform_pacing_state.last_present){
+            // Keep the limiter on its schedule unless we fell more than a frame behind
+            ggt_u64 period = _ggt_platform_frame_period();
+            ggt_u64 scheduled = ggt_platform_pacing_state.last_present + period;
+            ggt_platform_pacing_state.last_present = (now > scheduled + period) ? now : scheduled;
+        }else{
+            // With vsync, the swap returns right after the vertical blank
+            ggt_platform_pacing_state.last_present = now;
+        }
+    }
+    
+    //
+    // Frame telemetry
+    //
+    
+#ifndef GGTP_FRAME_STATS_WINDOW
+#define GGTP_FRAME_STATS_WINDOW 1024
+#endif
+    
+#ifndef GGTP_FRAME_HISTORY
+#define GGTP_FRAME_HISTORY 128
+#endif
+    
+    // Histogram buckets are 100 microseconds wide, the last one takes everything slower
+#define _GGTP_TIMING_BUCKET_SIZE 100
+#define _GGTP_TIMING_BUCKETS 1000
+    
+    // Timings of the last GGTP_FRAME_STATS_WINDOW samples, the histogram
+    // counts the same samples so percentiles don't need sorting
+    typedef struct {
+        ggt_u32 samples[GGTP_FRAME_STATS_WINDOW];
+        ggt_u32 buckets[_GGTP_TIMING_BUCKETS];
+        ggt_u32 count;
+        ggt_u32 next;
+    } _ggt_platform_timing_histogram;
+    
+    struct {
+        _ggt_platform_timing_histogram frame, loop, draw, swap;
+        ggt_frame_timing history[GGTP_FRAME_HISTORY];
+        ggt_frame_timing hitch_history[GGTP_FRAME_HISTORY];
+        ggt_u32 history_next;
+        ggt_u32 history_count;
+        ggt_u32 hitches;
+        // Taken around the histograms, which ggtp_loop's thread and the
+        // thread that draws write while ggtp_frame_stats reads them
+        ggt_u32 lock;
+    
+        ggt_u64 loop_start;
+        ggt_u32 last_loop;
+        ggt_u64 draw_start;
+    
+        ggt_u32 budget;
+        ggt_hitch_callback *callback;
+        void *user_data;
+    } ggt_platform_telemetry_state;
+    
+    ggt_u32 _ggt_platform_timing_bucket(ggt_u32 microseconds){
+        ggt_u32 bucket = microseconds / _GGTP_TIMING_BUCKET_SIZE;
+        return (bucket < _GGTP_TIMING_BUCKETS) ? bucket : _GGTP_TIMING_BUCKETS - 1;
+    }
+    
+    void _ggt_platform_add_timing(_ggt_platform_timing_histogram *histogram, ggt_u64 microseconds){
+        ggt_u32 sample = (microseconds < 0xffffffff) ? (ggt_u32)microseconds : 0xffffffff;
+        if(histogram->count == GGTP_FRAME_STATS_WINDOW)
+            histogram->buckets[_ggt_platform_timing_bucket(histogram->samples[histogram->next])]--;
+        else
+            histogram->count++;
+        histogram->samples[histogram->next] = sample;
+        histogram->buckets[_ggt_platform_timing_bucket(sample)]++;
+        histogram->next = (histogram->next + 1) % GGTP_FRAME_STATS_WINDOW;
+    }
+    
+    ggt_timing_stats _ggt_platform_timing_stats(const _ggt_platform_timing_histogram *histogram){
+        ggt_timing_stats stats;
+        memset(&stats, 0, sizeof(stats));
+        if(!histogram->count)
+            return stats;
+    
+        ggt_u32 max = 0;
+        for(ggt_u32 i = 0; i < histogram->count; i++)
+            if(histogram->samples[i] > max)
+                max = histogram->samples[i];
+        stats.max = max / 1000.f;
+    
+        // Upper edge of the bucket holding each percentile, but never above the max
+        float *percentiles[3] = {&stats.p50, &stats.p95, &stats.p99};
+        ggt_u32 ranks[3] = {(histogram->count * 50 + 99) / 100, (histogram->count * 95 + 99) / 100, (histogram->count * 99 + 99) / 100};
+        ggt_u32 seen = 0, bucket = 0;
+        for(int p = 0; p < 3; p++){
+            while(bucket < _GGTP_TIMING_BUCKETS - 1 && seen + histogram->buckets[bucket] < ranks[p])
+                seen += histogram->buckets[bucket++];
+            ggt_u32 edge = (bucket + 1) * _GGTP_TIMING_BUCKET_SIZE;
+            *percentiles[p] = ((edge < max) ? edge : max) / 1000.f;
+        }
+        return stats;
+    }
+    
+    ggt_frame_stats ggtp_frame_stats(void){
+        ggt_frame_stats stats;
+        _ggt_platform_lock(&ggt_platform_telemetry_state.lock);
+        stats.frames = ggt_platform_telemetry_state.frame.count;
+        stats.hitches = ggt_platform_telemetry_state.hitches;
+        stats.frame = _ggt_platform_timing_stats(&ggt_platform_telemetry_state.frame);
+        stats.loop = _ggt_platform_timing_stats(&ggt_platform_telemetry_state.loop);
+        stats.draw = _ggt_platform_timing_stats(&ggt_platform_telemetry_state.draw);
+        stats.swap = _ggt_platform_timing_stats(&ggt_platform_telemetry_state.swap);
+        _ggt_platform_unlock(&ggt_platform_telemetry_state.lock);
+        return stats;
+    }
+    
+    void ggtp_set_frame_budget(ggt_u32 microseconds, ggt_hitch_callback *callback, void *user_data){
+        _ggt_platform_lock(&ggt_platform_telemetry_state.lock);
+        ggt_platform_telemetry_state.budget = microseconds;
+        ggt_platform_telemetry_state.callback = callback;
+        ggt_platform_telemetry_state.user_data = user_data;
+        _ggt_platform_unlock(&ggt_platform_telemetry_state.lock);
+    }
+    
+    int _ggt_platform_end_loop(int result){
+        ggt_u64 loop = ggtp_time_microseconds() - ggt_platform_telemetry_state.loop_start;
+        ggt_platform_telemetry_state.last_loop = (ggt_u32)loop;
+        _ggt_platform_lock(&ggt_platform_telemetry_state.lock);
+        _ggt_platform_add_timing(&ggt_platform_telemetry_state.loop, loop);
+        _ggt_platform_unlock(&ggt_platform_telemetry_state.lock);
+        return result;
+    }
+    
+    void _ggt_platform_begin_draw(void){
+        ggt_platform_telemetry_state.draw_start = ggtp_time_microseconds();
+    }
+    
+    // Called after every swap, on the thread that draws
+    void _ggt_platform_end_frame(ggt_u64 frame_start, ggt_u64 work_end, ggt_u64 now){
+        ggt_frame_timing timing;
+        timing.start = frame_start;
+        timing.frame = (ggt_u32)(now - frame_start);
+        // With GGTP_RENDER_THREAD ggtp_loop doesn't run as part of the frame
+#ifdef GGTP_RENDER_THREAD
+        timing.loop = 0;
+#else
+        timing.loop = ggt_platform_telemetry_state.last_loop;
+#endif
+        ggt_u64 draw_start = ggt_platform_telemetry_state.draw_start;
+        timing.draw = (work_end > draw_start && draw_start >= frame_start) ? (ggt_u32)(work_end - draw_start) : 0;
+        timing.swap = (ggt_u32)(now - work_end);
+    
+        _ggt_platform_lock(&ggt_platform_telemetry_state.lock);
+        _ggt_platform_add_timing(&ggt_platform_telemetry_state.frame, timing.frame);
+        _ggt_platform_add_timing(&ggt_platform_telemetry_state.draw, timing.draw);
+        _ggt_platform_add_timing(&ggt_platform_telemetry_state.swap, timing.swap);
+    
+        ggt_platform_telemetry_state.history[ggt_platform_telemetry_state.history_next] = timing;
+        ggt_platform_telemetry_state.history_next = (ggt_platform_telemetry_state.history_next + 1) % GGTP_FRAME_HISTORY;
+        if(ggt_platform_telemetry_state.history_count < GGTP_FRAME_HISTORY)
+            ggt_platform_telemetry_state.history_count++;
+    
+        ggt_u32 budget = ggt_platform_telemetry_state.budget;
+        if(!budget)
+            budget = (ggt_u32)(_ggt_platform_frame_period() * 3 / 2);
+        if(timing.frame > budget)
+            ggt_platform_telemetry_state.hitches++;
+        // Taken together, so a new callback never gets the old user_data
+        ggt_hitch_callback *callback = ggt_platform_telemetry_state.callback;
+        void *user_data = ggt_platform_telemetry_state.user_data;
+        _ggt_platform_unlock(&ggt_platform_telemetry_state.lock);
+        if(timing.frame <= budget)
+            return;
+    
+        if(callback){
+            // Oldest first, ending with the hitch itself
+            ggt_u32 count = ggt_platform_telemetry_state.history_count;
+            ggt_u32 first = (ggt_platform_telemetry_state.history_next + GGTP_FRAME_HISTORY - count) % GGTP_FRAME_HISTORY;
+            for(ggt_u32 i = 0; i < count; i++)
+                ggt_platform_telemetry_state.hitch_history[i] = ggt_platform_telemetry_state.history[(first + i) % GGTP_FRAME_HISTORY];
+            callback(&timing, ggt_platform_telemetry_state.hitch_history, count, user_data);
+        }
+    }
+    
+    //
+    // On-demand redraw
+    //
+    
+    struct {
+        ggt_u32 requested;
+        ggt_u32 timer; // In _ggt_platform_milliseconds(), 0 if not set
+    } ggt_platform_redraw_state = {0, 0};
+    
+    // Wraps around every ~49 days, so only compare differences
+    ggt_u32 _ggt_platform_milliseconds(void){
+        return (ggt_u32)(ggtp_time_microseconds() / 1000);
+    }
+    
+    void ggtp_request_redraw(void){
+        if(!GGTP_ATOMIC_EXCHANGE(&ggt_platform_redraw_state.requested, 1)){
+            _ggt_platform_wake();
+            _ggt_platform_wake_simulation();
+        }
+    }
+    
+    void ggtp_request_redraw_after(ggt_u32 milliseconds){
+        ggt_u32 timer = _ggt_platform_milliseconds() + milliseconds;
+        if(!timer)
+            timer = 1;
+        
+        // Keep the earliest timer
+        ggt_u32 current = GGTP_ATOMIC_LOAD(&ggt_platform_redraw_state.timer);
+        if(!current || (int)(timer - current) < 0){
+            GGTP_ATOMIC_STORE(&ggt_platform_redraw_state.timer, timer);
+            // So that a wait in progress picks up the new timeout
+            _ggt_platform_wake();
+            _ggt_platform_wake_simulation();
+        }
+    }
+    
+    int _ggt_platform_watching(void);
+    int _ggt_platform_replaying(void);
+    
+    // Milliseconds until a redraw is due, 0 if it already is and -1 if no
+    // redraw is pending
+    int _ggt_platform_redraw_timeout(void){
+        // Replayed frames don't wait for input
+        if(GGTP_ATOMIC_LOAD(&ggt_platform_redraw_state.requested) || _ggt_platform_replaying())
+            return 0;
+        int timeout = -1;
+        ggt_u32 timer = GGTP_ATOMIC_LOAD(&ggt_platform_redraw_state.timer);
+        if(timer){
+            timeout = (int)(timer - _ggt_platform_milliseconds());
+            if(timeout < 0)
+                timeout = 0;
+        }
+#ifdef GGTP_HOT_RELOAD
+        // Keep looking for rebuilds while idle
+        if(timeout < 0 || timeout > GGTP_HOT_RELOAD_DELAY)
+            timeout = GGTP_HOT_RELOAD_DELAY;
+#endif
+        // Same for watched files
+        if(_ggt_platform_watching() && (timeout < 0 || timeout > GGTP_WATCH_DEBOUNCE))
+            timeout = GGTP_WATCH_DEBOUNCE;
+        return timeout;
+    }
+    
+    // Whether to draw a frame whose ggtp_loop returned loop_result. Consumes
+    // pending redraw requests, and ends the frame if it isn't drawn
+    int _ggt_platform_should_draw(int loop_result){
+        int requested = GGTP_ATOMIC_EXCHANGE(&ggt_platform_redraw_state.requested, 0);
+        ggt_u32 timer = GGTP_ATOMIC_LOAD(&ggt_platform_redraw_state.timer);
+        if(timer && (int)(timer - _ggt_platform_milliseconds()) <= 0){
+            GGTP_ATOMIC_STORE(&ggt_platform_redraw_state.timer, 0);
+            requested = 1;
+        }
+        if(loop_result != GGTP_NO_REDRAW || requested)
+            return 1;
+        _ggt_platform_end_frame_memory();
+        return 0;
+    }
+    
+    void _ggt_platform_wait_for_redraw(void);
+    
+    //
+    // File watching
+    //
+    
+#ifndef GGTP_MAX_CHANGED_FILES
+#define GGTP_MAX_CHANGED_FILES 256
+#endif
+    
+#define _GGTP_CHANGED_FILES_BUFFER_SIZE (GGTP_MAX_CHANGED_FILES * 128)
+    
+    typedef struct {
+        ggt_u32 count;
+        ggt_u32 used; // Bytes of buffer
+        ggt_u32 hashes[GGTP_MAX_CHANGED_FILES];
+        const char *paths[GGTP_MAX_CHANGED_FILES];
+        char buffer[_GGTP_CHANGED_FILES_BUFFER_SIZE];
+    } _ggt_platform_changed_files;
+    
+    struct {
+        int watches;
+        ggt_u32 last_change; // In _ggt_platform_milliseconds()
+        int dropped;
+        int pending; // Index of the batch being collected, the other one was delivered
+        _ggt_platform_changed_files batches[2];
+    } ggt_platform_watch_state;
+    
+    int _ggt_platform_watching(void){
+        return ggt_platform_watch_state.watches > 0;
+    }
+    
+    // Platform specific, calls _ggt_platform_file_changed for every change
+    // since the last poll
+    void _ggt_platform_poll_watches(void);
+    
+    void _ggt_platform_file_changed(const char *directory, const char *name, int name_length){
+        _ggt_platform_changed_files *batch = &ggt_platform_watch_state.batches[ggt_platform_watch_state.pending];
+        ggt_platform_watch_state.last_change = _ggt_platform_milliseconds();
+        
+        char path[_GGTP_PATH_SIZE];
+        int length = snprintf(path, sizeof(path), "%s/%.*s", directory, name_length, name);
+        if(length < 0 || length >= (int)sizeof(path))
+            return;
+        
+        // FNV-1a, so that repeated writes to a file are merged cheaply
+        ggt_u32 hash = 2166136261u;
+        for(int i = 0; i < length; i++)
+            hash = (hash ^ (ggt_u8)path[i]) * 16777619u;
+        for(ggt_u32 i = 0; i < batch->count; i++){
+            if(batch->hashes[i] == hash && strcmp(batch->paths[i], path) == 0)
+                return;
+        }
+        
+        if(batch->count == GGTP_MAX_CHANGED_FILES || batch->used + length + 1 > _GGTP_CHANGED_FILES_BUFFER_SIZE){
+            ggt_platform_watch_state.dropped++;
+            return;
+        }
+        
+        char *copy = batch->buffer + batch->used;
+        memcpy(copy, path, length + 1);
+        batch->used += length + 1;
+        batch->hashes[batch->count] = hash;
+        batch->paths[batch->count] = copy;
+        batch->count++;
+    }
+    
+    void _ggt_platform_deliver_changed_files(ggt_platform_events *events){
+        _ggt_platform_poll_watches();
+        
+        _ggt_platform_changed_files *batch = &ggt_platform_watch_state.batches[ggt_platform_watch_state.pending];
+        if(batch->count == 0 || events->size == GGTP_MAX_EVENTS_PER_LOOP ||
+           (int)(_ggt_platform_milliseconds() - ggt_platform_watch_state.last_change) < GGTP_WATCH_DEBOUNCE)
+            return;
+        
+        if(ggt_platform_watch_state.dropped){
+            printf("ggtp_watch: Too many changed files, %i were dropped\n", ggt_platform_watch_state.dropped);
+            ggt_platform_watch_state.dropped = 0;
+        }
+        
+        ggt_platform_event event;
+        event.type = GGTP_EVENT_FILES_CHANGED;
+        event.timestamp = ggtp_time_microseconds();
+        event.info.files.count = batch->count;
+        event.info.files.paths = batch->paths;
+        events->data[events->size++] = event;
+        
+        ggt_platform_watch_state.pending = !ggt_platform_watch_state.pending;
+        ggt_platform_watch_state.batches[ggt_platform_watch_state.pending].count = 0;
+        ggt_platform_watch_state.batches[ggt_platform_watch_state.pending].used = 0;
+    }
+    
+    //
+    // Asynchronous file reads
+    //
+    
+#ifndef GGTP_MAX_FILE_REQUESTS
+#define GGTP_MAX_FILE_REQUESTS 256
+#endif
+    
+#ifndef GGTP_FILE_THREADS
+#define GGTP_FILE_THREADS 2
+#endif
+    
+#ifndef GGTP_FILE_QUEUE_DEPTH
+#define GGTP_FILE_QUEUE_DEPTH 16
+#endif
+    
+    enum {
+        _GGTP_FILE_FREE,
+        _GGTP_FILE_PENDING,
+        _GGTP_FILE_READING,
+        _GGTP_FILE_DONE,
+    };
+    
+    typedef struct {
+        ggt_u32 state;
+        ggt_file_request id;
+        ggt_platform_priority priority;
+        ggt_u32 order; // FIFO within a priority
+        char path[_GGTP_PATH_SIZE];
+        void *dst;
+        ggt_u64 capacity;
+        ggt_file_callback *callback;
+        void *user_data;
+        
+        // Result
+        ggt_u64 size;
+        ggt_platform_file_status status;
+        
+        // Backend progress
+        int fd;
+        int stage;
+        ggt_u64 done;
+    } _ggt_platform_file_request;
+    
+    struct {
+        int started;
+        ggt_u32 lock; // Guards the pending -> reading transition
+        ggt_u32 outstanding; // Only touched by the ggtp_loop thread
+        ggt_u32 stopping;
+        ggt_file_request last_id;
+        ggt_u32 last_order;
+        ggt_semaphore work; // Thread backend, one post per request
+        ggt_thread threads[GGTP_FILE_THREADS];
+        int thread_count;
+        _ggt_platform_file_request requests[GGTP_MAX_FILE_REQUESTS];
+    } ggt_platform_file_state;
+    
+    // Platform specific. Stop is called once the frame loops are over
+    int  _ggt_platform_start_file_io(void);
+    void _ggt_platform_kick_file_io(void);
+    void _ggt_platform_stop_file_io(void);
+    
+    // Takes the most urgent pending request, or NULL
+    _ggt_platform_file_request *_ggt_platform_next_file_request(void){
+        _ggt_platform_file_request *best = NULL;
+        _ggt_platform_lock(&ggt_platform_file_state.lock);
+        for(int i = 0; i < GGTP_MAX_FILE_REQUESTS; i++){
+            _ggt_platform_file_request *request = &ggt_platform_file_state.requests[i];
+            if(request->state != _GGTP_FILE_PENDING)
+                continue;
+            if(!best || request->priority > best->priority ||
+               (request->priority == best->priority && (int)(request->order - best->order) < 0))
+                best = request;
+        }
+        if(best)
+            best->state = _GGTP_FILE_READING;
+        _ggt_platform_unlock(&ggt_platform_file_state.lock);
+        return best;
+    }
+    
+    void _ggt_platform_finish_file_request(_ggt_platform_file_request *request, ggt_platform_file_status status, ggt_u64 size){
+        request->status = status;
+        request->size = size;
+        GGTP_ATOMIC_STORE(&request->state, _GGTP_FILE_DONE);
+        // Delivered by the thread calling ggtp_loop, which may be waiting
+        _ggt_platform_wake();
+        _ggt_platform_wake_simulation();
+    }
+    
+    // Leaves the file at its start. 64-bit, unlike ftell, which is 32-bit
+    // on windows
+    int _ggt_platform_file_size(FILE *file, ggt_u64 *size){
+#ifdef _WIN32
+        if(_fseeki64(file, 0, SEEK_END) != 0)
+            return GGT_FAILURE;
+        __int64 end = _ftelli64(file);
+        _fseeki64(file, 0, SEEK_SET);
+#else
+        if(fseeko(file, 0, SEEK_END) != 0)
+            return GGT_FAILURE;
+        off_t end = ftello(file);
+        fseeko(file, 0, SEEK_SET);
+#endif
+        if(end < 0)
+            return GGT_FAILURE;
+        *size = (ggt_u64)end;
+        return GGT_SUCCESS;
+    }
+    
+    void _ggt_platform_read_file_blocking(_ggt_platform_file_request *request){
+        FILE *file = fopen(request->path, "rb");
+        if(!file){
+            _ggt_platform_finish_file_request(request, GGTP_FILE_NOT_FOUND, 0);
+            return;
+        }
+        
+        ggt_u64 size;
+        if(_ggt_platform_file_size(file, &size) == GGT_FAILURE || size > (size_t)-1){
+            _ggt_platform_finish_file_request(request, GGTP_FILE_ERROR, 0);
+        }else if(size > request->capacity){
+            _ggt_platform_finish_file_request(request, GGTP_FILE_TOO_BIG, size);
+        }else{
+            size_t read = fread(request->dst, 1, (size_t)size, file);
+            _ggt_platform_finish_file_request(request, (read == (size_t)size) ? GGTP_FILE_OK : GGTP_FILE_ERROR, read);
+        }
+        fclose(file);
+    }
+    
+    int _ggt_platform_file_worker(void *data){
+        while(1){
+            ggtp_semaphore_wait(ggt_platform_file_state.work, -1);
+            if(GGTP_ATOMIC_LOAD(&ggt_platform_file_state.stopping))
+                break;
+            _ggt_platform_file_request *request = _ggt_platform_next_file_request();
+            if(request)
+                _ggt_platform_read_file_blocking(request);
+        }
+        return 0;
+    }
+    
+    int _ggt_platform_start_file_threads(void){
+        ggt_platform_file_state.work = ggtp_create_semaphore(0);
+        if(!ggt_platform_file_state.work)
+            return GGT_FAILURE;
+        for(int i = 0; i < GGTP_FILE_THREADS; i++){
+            ggt_thread thread = ggtp_create_thread(_ggt_platform_file_worker, NULL, "ggtp_file_worker");
+            if(!thread)
+                return GGT_FAILURE;
+            ggt_platform_file_state.threads[ggt_platform_file_state.thread_count++] = thread;
+        }
+        return GGT_SUCCESS;
+    }
+    
+    // Waits for the reads in progress, the pending ones are dropped
+    void _ggt_platform_stop_file_threads(void){
+        GGTP_ATOMIC_STORE(&ggt_platform_file_state.stopping, 1);
+        for(int i = 0; i < ggt_platform_file_state.thread_count; i++)
+            ggtp_semaphore_post(ggt_platform_file_state.work);
+        for(int i = 0; i < ggt_platform_file_state.thread_count; i++)
+            ggtp_wait_thread(ggt_platform_file_state.threads[i]);
+        ggt_platform_file_state.thread_count = 0;
+    }
+    
+    ggt_file_request ggtp_read_file_async(const char *path, void *dst, ggt_u64 capacity, ggt_platform_priority priority,
+                                          ggt_file_callback *callback, void *user_data){
+        if(strlen(path) >= _GGTP_PATH_SIZE){
+            printf("ggtp_read_file_async error: Path too long\n");
+            return 0;
+        }
+        if(!ggt_platform_file_state.started){
+            if(_ggt_platform_start_file_io() == GGT_FAILURE){
+                printf("ggtp_read_file_async error: Couldn't start the file reading threads\n");
+                return 0;
+            }
+            ggt_platform_file_state.started = 1;
+        }
+        
+        _ggt_platform_file_request *request = NULL;
+        _ggt_platform_lock(&ggt_platform_file_state.lock);
+        for(int i = 0; i < GGTP_MAX_FILE_REQUESTS; i++){
+            if(ggt_platform_file_state.requests[i].state == _GGTP_FILE_FREE){
+                request = &ggt_platform_file_state.requests[i];
+                break;
+            }
+        }
+        if(request){
+            if(!++ggt_platform_file_state.last_id)
+                ++ggt_platform_file_state.last_id;
+            request->id = ggt_platform_file_state.last_id;
+            request->priority = priority;
+            request->order = ++ggt_platform_file_state.last_order;
+            strcpy(request->path, path);
+            request->dst = dst;
+            request->capacity = capacity;
+            request->callback = callback;
+            request->user_data = user_data;
+            request->done = 0;
+            request->state = _GGTP_FILE_PENDING;
+        }
+        _ggt_platform_unlock(&ggt_platform_file_state.lock);
+        
+        if(!request){
+            printf("ggtp_read_file_async error: Too many reads in flight\n");
+            return 0;
+        }
+        
+        ggt_platform_file_state.outstanding++;
+        _ggt_platform_kick_file_io();
+        return request->id;
+    }
+    
+    int ggtp_cancel_file_read(ggt_file_request id){
+        int result = GGT_FAILURE;
+        _ggt_platform_lock(&ggt_platform_file_state.lock);
+        for(int i = 0; i < GGTP_MAX_FILE_REQUESTS; i++){
+            _ggt_platform_file_request *request = &ggt_platform_file_state.requests[i];
+            if(request->id == id && request->state == _GGTP_FILE_PENDING){
+                request->state = _GGTP_FILE_FREE;
+                result = GGT_SUCCESS;
+                break;
+            }
+        }
+        _ggt_platform_unlock(&ggt_platform_file_state.lock);
+        
+        if(result == GGT_SUCCESS)
+            ggt_platform_file_state.outstanding--;
+        return result;
+    }
+    
+    void _ggt_platform_deliver_file_reads(ggt_platform_events *events){
+#ifdef __EMSCRIPTEN__
+        // No threads, so do the reads here, one frame late
+        _ggt_platform_file_request *pending;
+        while((pending = _ggt_platform_next_file_request()))
+            _ggt_platform_read_file_blocking(pending);
+#endif
+        
+        for(int i = 0; i < GGTP_MAX_FILE_REQUESTS && events->size < GGTP_MAX_EVENTS_PER_LOOP; i++){
+            _ggt_platform_file_request *request = &ggt_platform_file_state.requests[i];
+            if(GGTP_ATOMIC_LOAD(&request->state) != _GGTP_FILE_DONE)
+                continue;
+            
+            if(request->callback)
+                request->callback(request->id, request->status, request->dst, request->size, request->user_data);
+            
+            ggt_platform_event event;
+            event.type = GGTP_EVENT_FILE_READ;
+            event.timestamp = ggtp_time_microseconds();
+            event.info.file.size = request->size;
+            event.info.file.request = request->id;
+            event.info.file.status = request->status;
+            events->data[events->size++] = event;
+            
+            GGTP_ATOMIC_STORE(&request->state, _GGTP_FILE_FREE);
+            ggt_platform_file_state.outstanding--;
+        }
+    }
+    
+    //
+    // Background OpenGL loading
+    //
+    
+#if defined(__EMSCRIPTEN__) && defined(GGTP_LOADER_CONTEXT)
+#undef GGTP_LOADER_CONTEXT // WebGL contexts can't be shared
+#endif
+    
+#ifndef GGTP_MAX_GL_JOBS
+#define GGTP_MAX_GL_JOBS 256
+#endif
+    
+    typedef struct {
+        ggt_gl_job_function *job;
+        ggt_gl_job_function *done;
+        void *data;
+        GLsync fence; // Signaled once the GPU ran what the job queued
+    } _ggt_platform_gl_job;
+    
+    // Both queues are guarded by lock. Jobs go from pending to finished on
+    // the loader thread, and are taken out of finished by the thread that draws
+    struct {
+        _ggt_platform_gl_job pending[GGTP_MAX_GL_JOBS];
+        _ggt_platform_gl_job finished[GGTP_MAX_GL_JOBS];
+        ggt_u32 pending_read, pending_write;
+        ggt_u32 finished_read, finished_write;
+        ggt_u32 lock;
+        ggt_semaphore work;
+        ggt_thread thread;
+        ggt_u32 threaded; // The loader thread and its context are up
+        ggt_u32 stopping;
+        int fences;       // glFenceSync is supported, otherwise the loader thread calls glFinish
+    } ggt_platform_loader_state;
+    
+    int ggtp_gl_load(ggt_gl_job_function *job, ggt_gl_job_function *done, void *data){
+        _ggt_platform_lock(&ggt_platform_loader_state.lock);
+        if(ggt_platform_loader_state.pending_write - ggt_platform_loader_state.pending_read +
+           ggt_platform_loader_state.finished_write - ggt_platform_loader_state.finished_read >= GGTP_MAX_GL_JOBS){
+            _ggt_platform_unlock(&ggt_platform_loader_state.lock);
+            printf("ggtp_gl_load error: More than GGTP_MAX_GL_JOBS jobs queued\n");
+            return GGT_FAILURE;
+        }
+        _ggt_platform_gl_job *entry = &ggt_platform_loader_state.pending[ggt_platform_loader_state.pending_write++ % GGTP_MAX_GL_JOBS];
+        entry->job = job;
+        entry->done = done;
+        entry->data = data;
+        entry->fence = 0;
+        _ggt_platform_unlock(&ggt_platform_loader_state.lock);
+    
+        if(GGTP_ATOMIC_LOAD(&ggt_platform_loader_state.threaded))
+            ggtp_semaphore_post(ggt_platform_loader_state.work);
+        return GGT_SUCCESS;
+    }
+    
+    int _ggt_platform_pop_gl_job(_ggt_platform_gl_job *job){
+        int found = 0;
+        _ggt_platform_lock(&ggt_platform_loader_state.lock);
+        if(ggt_platform_loader_state.pending_read != ggt_platform_loader_state.pending_write){
+            *job = ggt_platform_loader_state.pending[ggt_platform_loader_state.pending_read++ % GGTP_MAX_GL_JOBS];
+            found = 1;
+        }
+        _ggt_platform_unlock(&ggt_platform_loader_state.lock);
+        return found;
+    }
+    
+#ifdef GGTP_LOADER_CONTEXT
+    // Platform specific, makes the shared context current on the calling
+    // thread, or not current anymore so that it can be deleted
+    void _ggt_platform_bind_loader_context(void);
+    void _ggt_platform_release_loader_context(void);
+    
+    int _ggt_platform_loader_thread(void *data){
+        _ggt_platform_bind_loader_context();
+        while(1){
+            ggtp_semaphore_wait(ggt_platform_loader_state.work, -1);
+            if(GGTP_ATOMIC_LOAD(&ggt_platform_loader_state.stopping))
+                break;
+            _ggt_platform_gl_job job;
+            if(!_ggt_platform_pop_gl_job(&job))
+                continue;
+    
+            job.job(job.data);
+            if(ggt_platform_loader_state.fences){
+                // The flush makes sure the fence reaches the GPU, so other contexts can wait on it
+                job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                glFlush();
+                // Handed over only once signaled, the thread that draws may be
+                // idle and would otherwise check it once and go back to sleep
+                glClientWaitSync(job.fence, 0, GL_TIMEOUT_IGNORED);
+            }else{
+                glFinish();
+            }
+    
+            _ggt_platform_lock(&ggt_platform_loader_state.lock);
+            ggt_platform_loader_state.finished[ggt_platform_loader_state.finished_write++ % GGTP_MAX_GL_JOBS] = job;
+            _ggt_platform_unlock(&ggt_platform_loader_state.lock);
+            _ggt_platform_wake();
+        }
+        
+        _ggt_platform_release_loader_context();
+        return 0;
+    }
+    
+    // Called by the platform once the shared context exists. Without it, jobs
+    // run between frames on the thread that draws
+    void _ggt_platform_start_loader(void){
+        ggt_platform_loader_state.work = ggtp_create_semaphore(0);
+        if(ggt_platform_loader_state.work)
+            ggt_platform_loader_state.thread = ggtp_create_thread(_ggt_platform_loader_thread, NULL, "ggtp_loader");
+        if(!ggt_platform_loader_state.thread){
+            printf("ggtp_create_window error: Couldn't start the loader thread, GL jobs will run between frames\n");
+            if(ggt_platform_loader_state.work)
+                ggtp_destroy_semaphore(ggt_platform_loader_state.work);
+            ggt_platform_loader_state.work = 0;
+            return;
+        }
+        GGTP_ATOMIC_STORE(&ggt_platform_loader_state.threaded, 1);
+    
+        // Wake it for whatever was queued before it existed
+        for(ggt_u32 i = ggt_platform_loader_state.pending_read; i != ggt_platform_loader_state.pending_write; i++)
+            ggtp_semaphore_post(ggt_platform_loader_state.work);
+    }
+    
+    // Called by the platform before it deletes the contexts, once nothing
+    // calls ggtp_gl_load anymore. Jobs that didn't start are dropped
+    void _ggt_platform_stop_loader(void){
+        if(!GGTP_ATOMIC_LOAD(&ggt_platform_loader_state.threaded))
+            return;
+        GGTP_ATOMIC_STORE(&ggt_platform_loader_state.stopping, 1);
+        ggtp_semaphore_post(ggt_platform_loader_state.work);
+        ggtp_wait_thread(ggt_platform_loader_state.thread);
+        GGTP_ATOMIC_STORE(&ggt_platform_loader_state.threaded, 0);
+        ggtp_destroy_semaphore(ggt_platform_loader_state.work);
+        ggt_platform_loader_state.work = 0;
+        ggt_platform_loader_state.thread = 0;
+    }
+#endif
+    
+    // Called by the thread that draws before every frame. Only hands over
+    // jobs whose fence already signaled, so it never waits on the GPU
+    void _ggt_platform_finish_gl_jobs(void){
+        if(!GGTP_ATOMIC_LOAD(&ggt_platform_loader_state.threaded)){
+            _ggt_platform_gl_job job;
+            while(_ggt_platform_pop_gl_job(&job)){
+                job.job(job.data);
+                if(job.done)
+                    job.done(job.data);
+            }
+            return;
+        }
+    
+        while(1){
+            _ggt_platform_lock(&ggt_platform_loader_state.lock);
+            int empty = ggt_platform_loader_state.finished_read == ggt_platform_loader_state.finished_write;
+            _ggt_platform_gl_job job;
+            if(!empty)
+                job = ggt_platform_loader_state.finished[ggt_platform_loader_state.finished_read % GGTP_MAX_GL_JOBS];
+            _ggt_platform_unlock(&ggt_platform_loader_state.lock);
+            if(empty)
+                return;
+    
+            if(job.fence){
+                // Jobs are handed over in order, so stop at the first one still running
+                if(glClientWaitSync(job.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                    return;
+                glDeleteSync(job.fence);
+            }
+    
+            _ggt_platform_lock(&ggt_platform_loader_state.lock);
+            ggt_platform_loader_state.finished_read++;
+            _ggt_platform_unlock(&ggt_platform_loader_state.lock);
+            if(job.done)
+                job.done(job.data);
+        }
+    }
+    
+    //
+    // Asset packs
+    //
+    
+#ifdef LZ4_H_2983827168210
+#define _GGTP_PACK_LZ4
+#endif
+#ifdef ZSTD_H_235446
+#define _GGTP_PACK_ZSTD
+#endif
+    
+    // Platform specific, maps the whole file read only
+    const ggt_u8 *_ggt_platform_map_file(const char *path, ggt_u64 *size, void **handle);
+    void _ggt_platform_unmap_file(const ggt_u8 *data, ggt_u64 size, void *handle);
+    
+    // For platforms that can't map files
+    const ggt_u8 *_ggt_platform_read_whole_file(const char *path, ggt_u64 *size){
+        FILE *file = fopen(path, "rb");
+        if(!file)
+            return NULL;
+        ggt_u64 length = 0;
+        ggt_u8 *data = NULL;
+        if(_ggt_platform_file_size(file, &length) == GGT_SUCCESS && length <= (size_t)-1)
+            data = (ggt_u8 *)malloc(length ? (size_t)length : 1);
+        if(data && fread(data, 1, (size_t)length, file) != (size_t)length){
+            free(data);
+            data = NULL;
+        }
+        fclose(file);
+        *size = length;
+        return data;
+    }
+    
+    // Whether [offset, offset + size) is inside a total bytes, without overflowing
+    int _ggt_platform_in_range(ggt_u64 offset, ggt_u64 size, ggt_u64 total){
+        return offset <= total && size <= total - offset;
+    }
+    
+    // Everything later reads is checked once here, so a truncated or
+    // corrupted pack can't make ggtp_pack_find or ggtp_pack_read leave the mapping
+    int _ggt_platform_pack_valid(const ggt_u8 *data, ggt_u64 size){
+        const ggt_pack_header *header = (const ggt_pack_header *)data;
+        if(size < sizeof(ggt_pack_header) || header->magic != GGTP_PACK_MAGIC || header->version != GGTP_PACK_VERSION ||
+           (header->slot_count & (header->slot_count - 1)) || header->slot_count < header->entry_count ||
+           !_ggt_platform_in_range(header->entries_offset, (ggt_u64)header->entry_count * sizeof(ggt_pack_entry), size) ||
+           !_ggt_platform_in_range(header->slots_offset, (ggt_u64)header->slot_count * sizeof(ggt_u32), size) ||
+           header->names_offset > size)
+            return GGT_FAILURE;
+        
+        const ggt_pack_entry *entries = (const ggt_pack_entry *)(data + header->entries_offset);
+        ggt_u64 names_size = size - header->names_offset;
+        for(ggt_u32 i = 0; i < header->entry_count; i++){
+            const ggt_pack_entry *entry = &entries[i];
+            if(!_ggt_platform_in_range(entry->name_offset, entry->name_length, names_size) ||
+               !_ggt_platform_in_range(entry->offset, entry->stored_size, size) ||
+               (entry->compression == GGTP_PACK_NONE && entry->size != entry->stored_size))
+                return GGT_FAILURE;
+        }
+        return GGT_SUCCESS;
+    }
+    
+    int ggtp_pack_open(ggt_pack *pack, const char *name){
+        char path[_GGTP_PATH_SIZE];
+        ggtp_program_file_path(name, path);
+        
+        memset(pack, 0, sizeof(ggt_pack));
+        pack->data = _ggt_platform_map_file(path, &pack->size, &pack->handle);
+        if(!pack->data){
+            printf("ggtp_pack_open error: Couldn't open %s\n", path);
+            return GGT_FAILURE;
+        }
+        
+        const ggt_pack_header *header = (const ggt_pack_header *)pack->data;
+        if(_ggt_platform_pack_valid(pack->data, pack->size) == GGT_FAILURE){
+            printf("ggtp_pack_open error: %s isn't a valid pack\n", path);
+            ggtp_pack_close(pack);
+            return GGT_FAILURE;
+        }
+        
+        pack->header = header;
+        pack->entries = (const ggt_pack_entry *)(pack->data + header->entries_offset);
+        pack->slots = (const ggt_u32 *)(pack->data + header->slots_offset);
+        pack->names = (const char *)(pack->data + header->names_offset);
+        return GGT_SUCCESS;
+    }
+    
+    void ggtp_pack_close(ggt_pack *pack){
+        if(pack->data)
+            _ggt_platform_unmap_file(pack->data, pack->size, pack->handle);
+        memset(pack, 0, sizeof(ggt_pack));
+    }
+    
+    const ggt_pack_entry *ggtp_pack_find(const ggt_pack *pack, const char *name){
+        if(!pack->header || !pack->header->slot_count)
+            return NULL;
+        
+        ggt_u32 length = (ggt_u32)strlen(name);
+        ggt_u64 hash = ggtp_pack_hash(name, length);
+        ggt_u32 mask = pack->header->slot_count - 1;
+        for(ggt_u32 probe = 0; probe <= mask; probe++){
+            ggt_u32 slot = pack->slots[(ggt_u32)(hash + probe) & mask];
+            if(!slot || slot > pack->header->entry_count)
+                return NULL;
+            
+            const ggt_pack_entry *entry = &pack->entries[slot - 1];
+            if(entry->hash != hash || entry->name_length != length)
+                continue;
+            const char *entry_name = pack->names + entry->name_offset;
+            ggt_u32 i = 0;
+            while(i < length && (entry_name[i] == name[i] || (name[i] == '\\' && entry_name[i] == '/')))
+                i++;
+            if(i == length)
+                return entry;
+        }
+        return NULL;
+    }
+    
+    const void *ggtp_pack_data(const ggt_pack *pack, const ggt_pack_entry *entry){
+        if(entry->compression != GGTP_PACK_NONE || !_ggt_platform_in_range(entry->offset, entry->size, pack->size))
+            return NULL;
+        return pack->data + entry->offset;
+    }
+    
+    int ggtp_pack_read(const ggt_pack *pack, const ggt_pack_entry *entry, void *dst){
+        if(!_ggt_platform_in_range(entry->offset, entry->stored_size, pack->size))
+            return GGT_FAILURE;
+        const ggt_u8 *source = pack->data + entry->offset;
+        
+        switch(entry->compression){
+            case GGTP_PACK_NONE: {
+                memcpy(dst, source, (size_t)entry->size);
+                return GGT_SUCCESS;
+            }
+#ifdef _GGTP_PACK_LZ4
+            case GGTP_PACK_LZ4: {
+                int size = LZ4_decompress_safe((const char *)source, (char *)dst, (int)entry->stored_size, (int)entry->size);
+                return (size >= 0 && (ggt_u64)size == entry->size) ? GGT_SUCCESS : GGT_FAILURE;
+            }
+#endif
+#ifdef _GGTP_PACK_ZSTD
+            case GGTP_PACK_ZSTD: {
+                size_t size = ZSTD_decompress(dst, (size_t)entry->size, source, (size_t)entry->stored_size);
+                return (!ZSTD_isError(size) && size == entry->size) ? GGT_SUCCESS : GGT_FAILURE;
+            }
+#endif
+            default: {
+                printf("ggtp_pack_read error: Compression %u isn't supported, include lz4.h or zstd.h before the implementation\n", entry->compression);
+                return GGT_FAILURE;
+            }
+        }
+    }
+    
+    //
+    // System information
+    //
+    
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define _GGTP_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+    
+    void _ggt_platform_cpuid(ggt_u32 leaf, ggt_u32 subleaf, ggt_u32 registers[4]){
+#ifdef _MSC_VER
+        int result[4];
+        __cpuidex(result, (int)leaf, (int)subleaf);
+        for(int i = 0; i < 4; i++)
+            registers[i] = (ggt_u32)result[i];
+#else
+        __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    }
+    
+    // Which register states the OS saves on context switches
+    ggt_u64 _ggt_platform_xgetbv(void){
+#ifdef _MSC_VER
+        return (ggt_u64)_xgetbv(0);
+#else
+        ggt_u32 low, high;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return ((ggt_u64)high << 32) | low;
+#endif
+    }
+#endif
+    
+    struct {
+        ggt_system_info info;
+        ggt_u32 detected;
+    } ggt_platform_system_state;
+    
+    // Platform specific, fills in the cores, caches and NUMA nodes it can find
+    void _ggt_platform_detect_topology(ggt_system_info *info);
+    
+    const ggt_system_info *ggtp_system_info(void){
+        if(GGTP_ATOMIC_LOAD(&ggt_platform_system_state.detected))
+            return &ggt_platform_system_state.info;
+    
+        ggt_system_info info;
+        memset(&info, 0, sizeof(info));
+    
+#ifdef _GGTP_X86
+        ggt_u32 registers[4];
+        _ggt_platform_cpuid(0, 0, registers);
+        ggt_u32 max_leaf = registers[0];
+    
+        _ggt_platform_cpuid(1, 0, registers);
+        if(registers[3] & (1u << 26))
+            info.simd |= GGTP_SIMD_SSE2;
+        if(registers[2] & (1u << 20))
+            info.simd |= GGTP_SIMD_SSE4_2;
+        info.cache_line_size = ((registers[1] >> 8) & 0xff) * 8; // CLFLUSH line size
+    
+        // AVX needs the OS to save the YMM registers, AVX-512 the opmask and ZMM ones too
+        ggt_u64 saved_state = (registers[2] & (1u << 27)) ? _ggt_platform_xgetbv() : 0;
+        int os_avx = (saved_state & 0x06) == 0x06;
+        int os_avx512 = (saved_state & 0xe6) == 0xe6;
+        if(os_avx && (registers[2] & (1u << 28)))
+            info.simd |= GGTP_SIMD_AVX;
+        if(os_avx && (registers[2] & (1u << 12)))
+            info.simd |= GGTP_SIMD_FMA;
+    
+        if(max_leaf >= 7){
+            _ggt_platform_cpuid(7, 0, registers);
+            if(os_avx && (registers[1] & (1u << 5)))
+                info.simd |= GGTP_SIMD_AVX2;
+            if(os_avx512 && (registers[1] & (1u << 16)))
+                info.simd |= GGTP_SIMD_AVX512;
+        }
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+        info.simd |= GGTP_SIMD_NEON;
+#endif
+#ifdef __wasm_simd128__
+        info.simd |= GGTP_SIMD_WASM;
+#endif
+    
+        _ggt_platform_detect_topology(&info);
+        if(!info.logical_cores)
+            info.logical_cores = 1;
+        if(!info.physical_cores || info.physical_cores > info.logical_cores)
+            info.physical_cores = info.logical_cores;
+        if(!info.numa_nodes)
+            info.numa_nodes = 1;
+        if(!info.cache_line_size)
+            info.cache_line_size = 64;
+    
+        // Every caller computes the same thing, so a race here is harmless
+        ggt_platform_system_state.info = info;
+        GGTP_ATOMIC_STORE(&ggt_platform_system_state.detected, 1);
+        return &ggt_platform_system_state.info;
+    }
+    
+    //
+    // Audio
+    //
+    
+#ifndef GGTP_AUDIO_VOICES
+#define GGTP_AUDIO_VOICES 256
+#endif
+    
+#ifndef GGTP_AUDIO_COMMANDS
+#define GGTP_AUDIO_COMMANDS 1024
+#endif
+    
+#if (GGTP_AUDIO_COMMANDS & (GGTP_AUDIO_COMMANDS - 1)) != 0
+#error "GGTP_AUDIO_COMMANDS must be a power of two"
+#endif
+    
+    // Voices are resampled into a scratch buffer this many frames at a time
+#define _GGTP_AUDIO_CHUNK 256
+    
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _GGTP_AUDIO_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define _GGTP_AUDIO_NEON
+#include <arm_neon.h>
+#endif
+    
+#include <math.h>
+    
+    typedef enum {
+        _GGTP_AUDIO_PLAY,
+        _GGTP_AUDIO_SET,
+        _GGTP_AUDIO_STOP,
+    } _ggt_platform_audio_command_type;
+    
+    typedef struct {
+        _ggt_platform_audio_command_type type;
+        ggt_voice voice;
+        ggt_sound sound;
+        float gain, pan, pitch;
+        int loop;
+    } _ggt_platform_audio_command;
+    
+    // Same as the event ring: ggtp_loop's thread writes, the audio thread reads
+    typedef struct {
+        _ggt_platform_audio_command data[GGTP_AUDIO_COMMANDS];
+        ggt_u32 write;
+        ggt_u8 padding[64 - sizeof(ggt_u32)];
+        ggt_u32 read;
+    } _ggt_platform_audio_ring;
+    
+    typedef struct {
+        ggt_voice id; // 0 if the slot is free
+        ggt_sound sound;
+        ggt_u64 position; // In frames of the sound, 32.32 fixed point
+        ggt_u64 step;
+        float left, right; // Gains in use, which move to the targets over one buffer
+        float target_left, target_right;
+        int loop;
+        int stopping; // Freed once it faded out
+    } _ggt_platform_voice;
+    
+    struct {
+        _ggt_platform_audio_ring commands;
+        _ggt_platform_voice voices[GGTP_AUDIO_VOICES];
+        float scratch[_GGTP_AUDIO_CHUNK * 2];
+        ggt_u32 sample_rate;
+        ggt_voice last_voice;
+        ggt_u32 running;
+    } ggt_platform_audio_state;
+    
+    // Platform specific. The output calls _ggt_platform_mix_audio from its thread
+    int  _ggt_platform_open_audio(ggt_u32 *sample_rate, ggt_u32 buffer_frames);
+    void _ggt_platform_close_audio(void);
+    
+    int _ggt_platform_audio_push(const _ggt_platform_audio_command *command){
+        _ggt_platform_audio_ring *ring = &ggt_platform_audio_state.commands;
+        ggt_u32 write = ring->write;
+        if(write - GGTP_ATOMIC_LOAD(&ring->read) >= GGTP_AUDIO_COMMANDS)
+            return GGT_FAILURE;
+        ring->data[write & (GGTP_AUDIO_COMMANDS - 1)] = *command;
+        GGTP_ATOMIC_STORE(&ring->write, write + 1);
+        return GGT_SUCCESS;
+    }
+    
+    int _ggt_platform_audio_pop(_ggt_platform_audio_command *command){
+        _ggt_platform_audio_ring *ring = &ggt_platform_audio_state.commands;
+        ggt_u32 read = ring->read;
+        if(read == GGTP_ATOMIC_LOAD(&ring->write))
+            return GGT_FAILURE;
+        *command = ring->data[read & (GGTP_AUDIO_COMMANDS - 1)];
+        GGTP_ATOMIC_STORE(&ring->read, read + 1);
+        return GGT_SUCCESS;
+    }
+    
+    int ggtp_audio_start(ggt_u32 sample_rate, ggt_u32 buffer_frames){
+        if(GGTP_ATOMIC_LOAD(&ggt_platform_audio_state.running))
+            return GGT_SUCCESS;
+        memset(ggt_platform_audio_state.voices, 0, sizeof(ggt_platform_audio_state.voices));
+        GGTP_ATOMIC_STORE(&ggt_platform_audio_state.commands.read, 0);
+        GGTP_ATOMIC_STORE(&ggt_platform_audio_state.commands.write, 0);
+    
+        ggt_platform_audio_state.sample_rate = sample_rate ? sample_rate : 48000;
+        if(!_ggt_platform_open_audio(&ggt_platform_audio_state.sample_rate, buffer_frames ? buffer_frames : 240))
+            return GGT_FAILURE;
+        GGTP_ATOMIC_STORE(&ggt_platform_audio_state.running, 1);
+        return GGT_SUCCESS;
+    }
+    
+    void ggtp_audio_stop(void){
+        if(!GGTP_ATOMIC_LOAD(&ggt_platform_audio_state.running))
+            return;
+        _ggt_platform_close_audio();
+        GGTP_ATOMIC_STORE(&ggt_platform_audio_state.running, 0);
+    }
+    
+    ggt_voice ggtp_audio_play(const ggt_sound *sound, float gain, float pan, float pitch, int loop){
+        if(!GGTP_ATOMIC_LOAD(&ggt_platform_audio_state.running) || !sound->frame_count || (sound->channels != 1 && sound->channels != 2))
+            return 0;
+    
+        _ggt_platform_audio_command command;
+        command.type = _GGTP_AUDIO_PLAY;
+        command.voice = ++ggt_platform_audio_state.last_voice;
+        if(!command.voice)
+            command.voice = ++ggt_platform_audio_state.last_voice;
+        command.sound = *sound;
+        command.gain = gain;
+        command.pan = pan;
+        command.pitch = pitch;
+        command.loop = loop;
+        return _ggt_platform_audio_push(&command) ? command.voice : 0;
+    }
+    
+    void ggtp_audio_set_voice(ggt_voice voice, float gain, float pan, float pitch){
+        _ggt_platform_audio_command command;
+        memset(&command, 0, sizeof(command));
+        command.type = _GGTP_AUDIO_SET;
+        command.voice = voice;
+        command.gain = gain;
+        command.pan = pan;
+        command.pitch = pitch;
+        _ggt_platform_audio_push(&command);
+    }
+    
+    void ggtp_audio_stop_voice(ggt_voice voice){
+        _ggt_platform_audio_command command;
+        memset(&command, 0, sizeof(command));
+        command.type = _GGTP_AUDIO_STOP;
+        command.voice = voice;
+        _ggt_platform_audio_push(&command);
+    }
+    
+    // Equal power panning
+    void _ggt_platform_voice_parameters(_ggt_platform_voice *voice, float gain, float pan, float pitch){
+        if(pan < -1.f)
+            pan = -1.f;
+        if(pan > 1.f)
+            pan = 1.f;
+        float angle = (pan + 1.f) * 0.785398163f;
+        voice->target_left = gain * cosf(angle);
+        voice->target_right = gain * sinf(angle);
+        double rate = (double)voice->sound.sample_rate / ggt_platform_audio_state.sample_rate * (pitch > 0.f ? pitch : 0.f);
+        voice->step = (ggt_u64)(rate * 4294967296.0);
+    }
+    
+    _ggt_platform_voice *_ggt_platform_find_voice(ggt_voice id){
+        for(ggt_u32 i = 0; i < GGTP_AUDIO_VOICES; i++)
+            if(ggt_platform_audio_state.voices[i].id == id)
+                return &ggt_platform_audio_state.voices[i];
+        return NULL;
+    }
+    
+    void _ggt_platform_run_audio_commands(void){
+        _ggt_platform_audio_command command;
+        while(_ggt_platform_audio_pop(&command)){
+            if(command.type == _GGTP_AUDIO_PLAY){
+                _ggt_platform_voice *voice = _ggt_platform_find_voice(0);
+                if(!voice)
+                    continue;
+                memset(voice, 0, sizeof(_ggt_platform_voice));
+                voice->id = command.voice;
+                voice->sound = command.sound;
+                voice->loop = command.loop;
+                _ggt_platform_voice_parameters(voice, command.gain, command.pan, command.pitch);
+                // Starts at full volume, so that the attack isn't softened
+                voice->left = voice->target_left;
+                voice->right = voice->target_right;
+                continue;
+            }
+    
+            _ggt_platform_voice *voice = command.voice ? _ggt_platform_find_voice(command.voice) : NULL;
+            if(!voice || voice->stopping)
+                continue;
+            if(command.type == _GGTP_AUDIO_SET){
+                _ggt_platform_voice_parameters(voice, command.gain, command.pan, command.pitch);
+            }else{
+                voice->target_left = voice->target_right = 0.f;
+                voice->stopping = 1;
+            }
+        }
+    }
+    
+    // Writes up to count frames of the voice at its rate into scratch (mono
+    // or interleaved stereo, like the sound) and returns where they are,
+    // which is the sound itself if no resampling is needed. Frames past the
+    // end of a sound that doesn't loop are silent and end the voice
+    const float *_ggt_platform_resample_voice(_ggt_platform_voice *voice, ggt_u32 count, float *scratch){
+        const float *samples = voice->sound.samples;
+        ggt_u32 channels = voice->sound.channels;
+        ggt_u64 length = (ggt_u64)voice->sound.frame_count << 32;
+    
+        if(voice->step == ((ggt_u64)1 << 32) && !(voice->position & 0xffffffff) &&
+           voice->position + ((ggt_u64)count << 32) <= length){
+            const float *result = samples + (voice->position >> 32) * channels;
+            voice->position += (ggt_u64)count << 32;
+            if(voice->position == length && voice->loop)
+                voice->position = 0;
+            return result;
+        }
+    
+        for(ggt_u32 i = 0; i < count; i++){
+            if(voice->position >= length){
+                if(!voice->loop || !voice->step){
+                    memset(scratch + i * channels, 0, (count - i) * channels * sizeof(float));
+                    voice->id = 0;
+                    break;
+                }
+                voice->position %= length;
+            }
+    
+            ggt_u32 index = (ggt_u32)(voice->position >> 32);
+            float fraction = (float)(voice->position & 0xffffffff) * (1.f / 4294967296.f);
+            ggt_u32 next = index + 1;
+            int has_next = 1;
+            if(next == voice->sound.frame_count){
+                next = 0;
+                has_next = voice->loop;
+            }
+            for(ggt_u32 c = 0; c < channels; c++){
+                float a = samples[index * channels + c];
+                float b = has_next ? samples[next * channels + c] : 0.f;
+                scratch[i * channels + c] = a + (b - a) * fraction;
+            }
+            voice->position += voice->step;
+        }
+        return scratch;
+    }
+    
+    // output (interleaved stereo) += source * gains, with the gains moving by
+    // step every frame
+    void _ggt_platform_mix_mono(float *output, const float *source, ggt_u32 count, float *left, float *right, float left_step, float right_step){
+        ggt_u32 i = 0;
+#if defined(_GGTP_AUDIO_SSE) || defined(_GGTP_AUDIO_NEON)
+        float gains[4] = {*left, *right, *left + left_step, *right + right_step};
+        float steps[4] = {2.f * left_step, 2.f * right_step, 2.f * left_step, 2.f * right_step};
+#ifdef _GGTP_AUDIO_SSE
+        __m128 gain = _mm_loadu_ps(gains), gain_step = _mm_loadu_ps(steps);
+        for(; i + 4 <= count; i += 4){
+            __m128 x = _mm_loadu_ps(source + i);
+            __m128 low = _mm_unpacklo_ps(x, x), high = _mm_unpackhi_ps(x, x);
+            _mm_storeu_ps(output + 2 * i, _mm_add_ps(_mm_loadu_ps(output + 2 * i), _mm_mul_ps(low, gain)));
+            gain = _mm_add_ps(gain, gain_step);
+            _mm_storeu_ps(output + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(output + 2 * i + 4), _mm_mul_ps(high, gain)));
+            gain = _mm_add_ps(gain, gain_step);
+        }
+#else
+        float32x4_t gain = vld1q_f32(gains), gain_step = vld1q_f32(steps);
+        for(; i + 4 <= count; i += 4){
+            float32x4x2_t x = vzipq_f32(vld1q_f32(source + i), vld1q_f32(source + i));
+            vst1q_f32(output + 2 * i, vmlaq_f32(vld1q_f32(output + 2 * i), x.val[0], gain));
+            gain = vaddq_f32(gain, gain_step);
+            vst1q_f32(output + 2 * i + 4, vmlaq_f32(vld1q_f32(output + 2 * i + 4), x.val[1], gain));
+            gain = vaddq_f32(gain, gain_step);
+        }
+#endif
+        *left += left_step * i;
+        *right += right_step * i;
+#endif
+        for(; i < count; i++){
+            output[2 * i] += source[i] * *left;
+            output[2 * i + 1] += source[i] * *right;
+            *left += left_step;
+            *right += right_step;
+        }
+    }
+    
+    void _ggt_platform_mix_stereo(float *output, const float *source, ggt_u32 count, float *left, float *right, float left_step, float right_step){
+        ggt_u32 i = 0;
+#if defined(_GGTP_AUDIO_SSE) || defined(_GGTP_AUDIO_NEON)
+        float gains[4] = {*left, *right, *left + left_step, *right + right_step};
+        float steps[4] = {2.f * left_step, 2.f * right_step, 2.f * left_step, 2.f * right_step};
+#ifdef _GGTP_AUDIO_SSE
+        __m128 gain = _mm_loadu_ps(gains), gain_step = _mm_loadu_ps(steps);
+        for(; i + 2 <= count; i += 2){
+            _mm_storeu_ps(output + 2 * i, _mm_add_ps(_mm_loadu_ps(output + 2 * i), _mm_mul_ps(_mm_loadu_ps(source + 2 * i), gain)));
+            gain = _mm_add_ps(gain, gain_step);
+        }
+#else
+        float32x4_t gain = vld1q_f32(gains), gain_step = vld1q_f32(steps);
+        for(; i + 2 <= count; i += 2){
+            vst1q_f32(output + 2 * i, vmlaq_f32(vld1q_f32(output + 2 * i), vld1q_f32(source + 2 * i), gain));
+            gain = vaddq_f32(gain, gain_step);
+        }
+#endif
+        *left += left_step * i;
+        *right += right_step * i;
+#endif
+        for(; i < count; i++){
+            output[2 * i] += source[2 * i] * *left;
+            output[2 * i + 1] += source[2 * i + 1] * *right;
+            *left += left_step;
+            *right += right_step;
+        }
+    }
+    
+    // Called on the audio thread for every buffer of interleaved stereo
+    void _ggt_platform_mix_audio(float *output, ggt_u32 frames){
+        memset(output, 0, frames * 2 * sizeof(float));
+        _ggt_platform_run_audio_commands();
+    
+        for(ggt_u32 v = 0; v < GGTP_AUDIO_VOICES; v++){
+            _ggt_platform_voice *voice = &ggt_platform_audio_state.voices[v];
+            if(!voice->id)
+                continue;
+    
+            float left_step = (voice->target_left - voice->left) / frames;
+            float right_step = (voice->target_right - voice->right) / frames;
+            for(ggt_u32 done = 0; done < frames && voice->id;){
+                ggt_u32 count = frames - done;
+                if(count > _GGTP_AUDIO_CHUNK)
+                    count = _GGTP_AUDIO_CHUNK;
+                const float *source = _ggt_platform_resample_voice(voice, count, ggt_platform_audio_state.scratch);
+                if(voice->sound.channels == 1)
+                    _ggt_platform_mix_mono(output + 2 * done, source, count, &voice->left, &voice->right, left_step, right_step);
+                else
+                    _ggt_platform_mix_stereo(output + 2 * done, source, count, &voice->left, &voice->right, left_step, right_step);
+                done += count;
+            }
+            voice->left = voice->target_left;
+            voice->right = voice->target_right;
+            if(voice->stopping)
+                voice->id = 0;
+        }
+    }
+    
+    //
+    // Input recording
+    //
+    
+#define _GGTP_RECORDING_MAGIC   0x52544747 // "GGTR"
+#define _GGTP_RECORDING_VERSION 1
+    
+    // A recording is this header followed by one record per frame: a
+    // _ggt_platform_recording_frame, changed_keys pairs of key and value
+    // bytes and event_count ggt_platform_event with their timestamps relative
+    // to the start. Events are stored as they are in memory, so recordings
+    // are meant to be played back by a build for the same platform
+    typedef struct {
+        ggt_u32 magic;
+        ggt_u32 version;
+        ggt_u32 total_keys;
+        ggt_u32 event_size;
+    } _ggt_platform_recording_header;
+    
+    typedef struct {
+        ggt_u64 delta; // Microseconds since the previous frame
+        ggt_u32 changed_keys;
+        ggt_u32 event_count;
+    } _ggt_platform_recording_frame;
+    
+    struct {
+        ggt_u64 last_frame;
+        ggt_u64 delta;
+        int checked_environment;
+    
+        FILE *record;
+        ggt_u64 record_start;
+        ggt_u8 recorded_keys[GGTP_TOTAL_KEYS];
+    
+        const ggt_u8 *replay;
+        ggt_u64 replay_size;
+        ggt_u64 replay_offset;
+        void *replay_handle;
+        char replay_path[_GGTP_PATH_SIZE];
+        char report_path[_GGTP_PATH_SIZE];
+        int full_speed;
+        int close_when_done;
+        ggt_u8 replay_keys[GGTP_TOTAL_KEYS];
+        ggt_u8 live_keys[GGTP_TOTAL_KEYS]; // Restored when the replay ends
+        int saved_live_keys;
+        ggt_u64 replay_start;
+        ggt_u64 replay_clock; // Sum of the replayed deltas
+        ggt_u64 frame_begin;
+        ggt_u64 *frame_times;
+        ggt_u32 frame;
+        ggt_u32 frame_count;
+    } ggt_platform_input_state;
+    
+    int _ggt_platform_replaying(void){
+        return ggt_platform_input_state.replay != NULL;
+    }
+    
+    ggt_u64 ggtp_frame_delta_microseconds(void){
+        return ggt_platform_input_state.delta;
+    }
+    
+    int ggtp_record_input(const char *path){
+        ggtp_stop_input_recording();
+    
+        FILE *file = fopen(path, "wb");
+        if(!file){
+            printf("ggtp_record_input error: Couldn't create %s\n", path);
+            return GGT_FAILURE;
+        }
+    
+        _ggt_platform_recording_header header;
+        header.magic = _GGTP_RECORDING_MAGIC;
+        header.version = _GGTP_RECORDING_VERSION;
+        header.total_keys = GGTP_TOTAL_KEYS;
+        header.event_size = sizeof(ggt_platform_event);
+        fwrite(&header, sizeof(header), 1, file);
+    
+        ggt_platform_input_state.record = file;
+        ggt_platform_input_state.record_start = ggtp_time_microseconds();
+        // So that the first frame stores the keys already held down
+        memset(ggt_platform_input_state.recorded_keys, 0, GGTP_TOTAL_KEYS);
+        return GGT_SUCCESS;
+    }
+    
+    void ggtp_stop_input_recording(void){
+        if(ggt_platform_input_state.record){
+            fclose(ggt_platform_input_state.record);
+            ggt_platform_input_state.record = NULL;
+        }
+    }
+    
+    void _ggt_platform_record_frame(ggt_u8 keys[GGTP_TOTAL_KEYS], const ggt_platform_events *events){
+        FILE *file = ggt_platform_input_state.record;
+        ggt_u8 *recorded_keys = ggt_platform_input_state.recorded_keys;
+    
+        _ggt_platform_recording_frame frame;
+        frame.delta = ggt_platform_input_state.delta;
+        frame.changed_keys = 0;
+        for(ggt_u32 i = 0; i < GGTP_TOTAL_KEYS; i++)
+            frame.changed_keys += (keys[i] != recorded_keys[i]);
+        frame.event_count = events->size;
+        fwrite(&frame, sizeof(frame), 1, file);
+    
+        for(ggt_u32 i = 0; i < GGTP_TOTAL_KEYS; i++){
+            if(keys[i] != recorded_keys[i]){
+                ggt_u8 change[2] = {(ggt_u8)i, keys[i]};
+                fwrite(change, 2, 1, file);
+                recorded_keys[i] = keys[i];
+            }
+        }
+    
+        for(ggt_u32 i = 0; i < events->size; i++){
+            ggt_platform_event event = events->data[i];
+            event.timestamp = (event.timestamp > ggt_platform_input_state.record_start) ?
+                event.timestamp - ggt_platform_input_state.record_start : 0;
+            fwrite(&event, sizeof(event), 1, file);
+        }
+    }
+    
+    void _ggt_platform_stop_replay(void){
+        _ggt_platform_unmap_file(ggt_platform_input_state.replay, ggt_platform_input_state.replay_size,
+                                 ggt_platform_input_state.replay_handle);
+        ggt_platform_input_state.replay = NULL;
+        free(ggt_platform_input_state.frame_times);
+        ggt_platform_input_state.frame_times = NULL;
+        _ggt_platform_set_replay_pacing(0);
+    }
+    
+    int ggtp_replay_input(const char *path, const char *report_path, int full_speed, int close_when_done){
+        if(ggt_platform_input_state.replay)
+            _ggt_platform_stop_replay();
+    
+        ggt_u64 size;
+        void *handle = NULL;
+        const ggt_u8 *data = _ggt_platform_map_file(path, &size, &handle);
+        if(!data){
+            printf("ggtp_replay_input error: Couldn't open %s\n", path);
+            return GGT_FAILURE;
+        }
+    
+        // Walk the frames once to validate them and count them
+        const _ggt_platform_recording_header *header = (const _ggt_platform_recording_header *)data;
+        int valid = size >= sizeof(_ggt_platform_recording_header) && header->magic == _GGTP_RECORDING_MAGIC &&
+            header->version == _GGTP_RECORDING_VERSION && header->total_keys == GGTP_TOTAL_KEYS &&
+            header->event_size == sizeof(ggt_platform_event);
+        ggt_u64 offset = sizeof(_ggt_platform_recording_header);
+        ggt_u32 frame_count = 0;
+        while(valid && offset < size){
+            _ggt_platform_recording_frame frame;
+            if(offset + sizeof(frame) > size){
+                valid = 0;
+                break;
+            }
+            memcpy(&frame, data + offset, sizeof(frame));
+            offset += sizeof(frame) + (ggt_u64)frame.changed_keys * 2 + (ggt_u64)frame.event_count * sizeof(ggt_platform_event);
+            valid = offset <= size && frame.changed_keys <= GGTP_TOTAL_KEYS && frame.event_count <= GGTP_MAX_EVENTS_PER_LOOP;
+            frame_count++;
+        }
+        if(!valid || !frame_count){
+            printf("ggtp_replay_input error: %s isn't a recording made by this build\n", path);
+            _ggt_platform_unmap_file(data, size, handle);
+            return GGT_FAILURE;
+        }
+    
+        ggt_platform_input_state.replay = data;
+        ggt_platform_input_state.replay_size = size;
+        ggt_platform_input_state.replay_handle = handle;
+        ggt_platform_input_state.replay_offset = sizeof(_ggt_platform_recording_header);
+        snprintf(ggt_platform_input_state.replay_path, _GGTP_PATH_SIZE, "%s", path);
+        snprintf(ggt_platform_input_state.report_path, _GGTP_PATH_SIZE, "%s", report_path ? report_path : "");
+        ggt_platform_input_state.full_speed = full_speed;
+        ggt_platform_input_state.close_when_done = close_when_done;
+        memset(ggt_platform_input_state.replay_keys, 0, GGTP_TOTAL_KEYS);
+        ggt_platform_input_state.replay_start = ggtp_time_microseconds();
+        ggt_platform_input_state.replay_clock = 0;
+        ggt_platform_input_state.frame_times = (ggt_u64 *)malloc(frame_count * sizeof(ggt_u64));
+        ggt_platform_input_state.frame = 0;
+        ggt_platform_input_state.frame_count = frame_count;
+        _ggt_platform_set_replay_pacing(full_speed);
+        return GGT_SUCCESS;
+    }
+    
+    int _ggt_platform_compare_u64(const void *a, const void *b){
+        ggt_u64 x = *(const ggt_u64 *)a, y = *(const ggt_u64 *)b;
+        return (x > y) - (x < y);
+    }
+    
+    void _ggt_platform_report_replay(void){
+        ggt_u64 *times = ggt_platform_input_state.frame_times;
+        ggt_u32 count = ggt_platform_input_state.frame_count;
+    
+        if(ggt_platform_input_state.report_path[0]){
+            FILE *file = fopen(ggt_platform_input_state.report_path, "w");
+            if(file){
+                fprintf(file, "frame,microseconds\n");
+                for(ggt_u32 i = 0; i < count; i++)
+                    fprintf(file, "%u,%llu\n", i, times[i]);
+                fclose(file);
+            }else{
+                printf("ggtp_replay_input error: Couldn't create %s\n", ggt_platform_input_state.report_path);
+            }
+        }
+    
+        ggt_u64 total = 0;
+        for(ggt_u32 i = 0; i < count; i++)
+            total += times[i];
+        qsort(times, count, sizeof(ggt_u64), _ggt_platform_compare_u64);
+        printf("Replayed %s: %u frames in %.3f s, frame times (ms) average %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f\n",
+               ggt_platform_input_state.replay_path, count, total / 1000000.0, total / 1000.0 / count,
+               times[count * 50 / 100] / 1000.0, times[count * 95 / 100] / 1000.0, times[count * 99 / 100] / 1000.0,
+               times[count - 1] / 1000.0);
+    }
+    
+    void _ggt_platform_replay_frame(ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events *events){
+        ggt_u64 now = ggtp_time_microseconds();
+        ggt_u32 frame_index = ggt_platform_input_state.frame;
+        if(frame_index > 0)
+            ggt_platform_input_state.frame_times[frame_index - 1] = now - ggt_platform_input_state.frame_begin;
+    
+        // Keep track of the live keys, which the replayed ones hide, to give
+        // them back when the replay ends. A key differs from the replayed one
+        // or has an event only if it was pressed or released since last frame
+        ggt_u8 *live_keys = ggt_platform_input_state.live_keys;
+        if(!ggt_platform_input_state.saved_live_keys){
+            memcpy(live_keys, keys, GGTP_TOTAL_KEYS);
+            ggt_platform_input_state.saved_live_keys = 1;
+        }else{
+            // Not on the first frame of a replay that replaced another, as
+            // the replayed keys start over from nothing
+            if(frame_index > 0)
+                for(ggt_u32 i = 0; i < GGTP_TOTAL_KEYS; i++)
+                    if(keys[i] != ggt_platform_input_state.replay_keys[i])
+                        live_keys[i] = keys[i];
+            for(ggt_u32 i = 0; i < events->size; i++){
+                ggt_platform_event *event = &events->data[i];
+                if((event->type == GGTP_EVENT_KEY_DOWN || event->type == GGTP_EVENT_KEY_UP) &&
+                   (ggt_u8)event->info.key < GGTP_TOTAL_KEYS)
+                    live_keys[(ggt_u8)event->info.key] = keys[(ggt_u8)event->info.key];
+            }
+        }
+        
+        // Only closing the window gets through
+        ggt_u32 kept = 0;
+        for(ggt_u32 i = 0; i < events->size; i++)
+            if(events->data[i].type == GGTP_EVENT_CLOSE)
+                events->data[kept++] = events->data[i];
+        events->size = kept;
+    
+        if(frame_index == ggt_platform_input_state.frame_count){
+            _ggt_platform_report_replay();
+            memcpy(keys, live_keys, GGTP_TOTAL_KEYS);
+            ggt_platform_input_state.saved_live_keys = 0;
+            int close_when_done = ggt_platform_input_state.close_when_done;
+            _ggt_platform_stop_replay();
+            if(close_when_done && events->size < GGTP_MAX_EVENTS_PER_LOOP){
+                ggt_platform_event *event = &events->data[events->size++];
+                memset(event, 0, sizeof(ggt_platform_event));
+                event->type = GGTP_EVENT_CLOSE;
+                event->timestamp = now;
+            }
+            return;
+        }
+    
+        const ggt_u8 *data = ggt_platform_input_state.replay + ggt_platform_input_state.replay_offset;
+        _ggt_platform_recording_frame frame;
+        memcpy(&frame, data, sizeof(frame));
+        data += sizeof(frame);
+    
+        for(ggt_u32 i = 0; i < frame.changed_keys; i++, data += 2)
+            if(data[0] < GGTP_TOTAL_KEYS)
+                ggt_platform_input_state.replay_keys[data[0]] = data[1];
+        memcpy(keys, ggt_platform_input_state.replay_keys, GGTP_TOTAL_KEYS);
+    
+        for(ggt_u32 i = 0; i < frame.event_count; i++, data += sizeof(ggt_platform_event)){
+            if(events->size == GGTP_MAX_EVENTS_PER_LOOP)
+                continue;
+            ggt_platform_event *event = &events->data[events->size++];
+            memcpy(event, data, sizeof(ggt_platform_event));
+            event->timestamp += ggt_platform_input_state.replay_start;
+        }
+        ggt_platform_input_state.replay_offset = data - ggt_platform_input_state.replay;
+    
+        ggt_platform_input_state.delta = frame.delta;
+        ggt_platform_input_state.replay_clock += frame.delta;
+        if(!ggt_platform_input_state.full_speed)
+            _ggt_platform_wait_until(ggt_platform_input_state.replay_start + ggt_platform_input_state.replay_clock);
+    
+        ggt_platform_input_state.frame_begin = ggtp_time_microseconds();
+        ggt_platform_input_state.frame++;
+    }
+    
+    void _ggt_platform_input_frame(ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events *events){
+        if(!ggt_platform_input_state.checked_environment){
+            ggt_platform_input_state.checked_environment = 1;
+            const char *path = getenv("GGTP_RECORD");
+            if(path && path[0])
+                ggtp_record_input(path);
+            path = getenv("GGTP_REPLAY");
+            if(path && path[0]){
+                const char *speed = getenv("GGTP_REPLAY_SPEED");
+                ggtp_replay_input(path, getenv("GGTP_REPLAY_REPORT"), !(speed && !strcmp(speed, "recorded")), 1);
+            }
+        }
+    
+        ggt_u64 now = ggtp_time_microseconds();
+        ggt_platform_input_state.delta = ggt_platform_input_state.last_frame ? now - ggt_platform_input_state.last_frame : 0;
+        ggt_platform_input_state.last_frame = now;
+    
+        if(ggt_platform_input_state.replay)
+            _ggt_platform_replay_frame(keys, events);
+        if(ggt_platform_input_state.record)
+            _ggt_platform_record_frame(keys, events);
+    }
+    
+    // Called right before ggtp_loop with the keys and events it is going to
+    // get. Replays replace the input, so file events are added after them
+    void _ggt_platform_frame_events(ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events *events){
+        _ggt_platform_input_frame(keys, events);
+        if(ggt_platform_watch_state.watches)
+            _ggt_platform_deliver_changed_files(events);
+        if(ggt_platform_file_state.outstanding)
+            _ggt_platform_deliver_file_reads(events);
+        ggt_platform_telemetry_state.loop_start = ggtp_time_microseconds();
+    }
+    
+    //
+    // Hot reloading
+    //
+    
+#ifdef GGTP_HOT_RELOAD
+#define _GGTP_HOT_RELOAD_ATTEMPTS 10
+    
+#ifdef GGTP_PROGRAM_STATE
+#ifdef GGTP_MEMORY
+    typedef int _ggt_platform_init_function(GGTP_PROGRAM_STATE* program_state, ggt_platform_memory* memory);
+#else
+    typedef int _ggt_platform_init_function(GGTP_PROGRAM_STATE* program_state);
+#endif
+    typedef int _ggt_platform_loop_function(GGTP_PROGRAM_STATE* program_state, ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events events);
+    typedef void _ggt_platform_draw_function(GGTP_PROGRAM_STATE* program_state);
+#else
+#ifdef GGTP_MEMORY
+    typedef int _ggt_platform_init_function(ggt_platform_memory* memory);
+#else
+    typedef int _ggt_platform_init_function(void);
+#endif
+    typedef int _ggt_platform_loop_function(ggt_u8 keys[GGTP_TOTAL_KEYS], ggt_platform_events events);
+    typedef void _ggt_platform_draw_function(void);
+#endif
+    
+    struct {
+        void *library;
+        int copy_index;
+        ggt_u64 modification_date;
+        ggt_u32 change_time; // In _ggt_platform_milliseconds(), 0 if no rebuild is pending
+        int attempts;
+        
+        _ggt_platform_init_function *init;
+        _ggt_platform_loop_function *loop;
+        _ggt_platform_draw_function *draw;
+    } ggt_platform_code;
+    
+    // From here on the user functions are whatever the library has now
+#define ggtp_init (*ggt_platform_code.init)
+#define ggtp_loop (*ggt_platform_code.loop)
+#define ggtp_draw (*ggt_platform_code.draw)
+    
+    // Platform specific
+    void *_ggt_platform_load_library(const char *path);
+    void *_ggt_platform_library_function(void *library, const char *name);
+    void _ggt_platform_unload_library(void *library);
+    
+    int _ggt_platform_copy_file(const char *source, const char *destination){
+        FILE *in = fopen(source, "rb");
+        if(!in)
+            return GGT_FAILURE;
+        FILE *out = fopen(destination, "wb");
+        if(!out){
+            fclose(in);
+            return GGT_FAILURE;
+        }
+        
+        char buffer[64 * 1024];
+        size_t size;
+        int result = GGT_SUCCESS;
+        while((size = fread(buffer, 1, sizeof(buffer), in)) > 0){
+            if(fwrite(buffer, 1, size, out) != size){
+                result = GGT_FAILURE;
+                break;
+            }
+        }
+        fclose(in);
+        fclose(out);
+        return result;
+    }
+    
+    int _ggt_platform_load_code(void){
+        char path[_GGTP_PATH_SIZE];
+        char copy_path[_GGTP_PATH_SIZE + 16];
+        ggtp_program_file_path(GGTP_HOT_RELOAD, path);
+        ggt_platform_code.modification_date = ggtp_file_modification_date(path);
+        
+        // Load a copy, so that the compiler can overwrite the library and the
+        // current code stays loaded until the new one is known to work
+        int copy_index = ggt_platform_code.library ? !ggt_platform_code.copy_index : 0;
+        sprintf(copy_path, "%s.live%i", path, copy_index);
+        if(_ggt_platform_copy_file(path, copy_path) == GGT_FAILURE)
+            return GGT_FAILURE;
+        
+        void *library = _ggt_platform_load_library(copy_path);
+        if(!library)
+            return GGT_FAILURE;
+        
+        _ggt_platform_init_function *init = (_ggt_platform_init_function *)_ggt_platform_library_function(library, "ggtp_init");
+        _ggt_platform_loop_function *loop = (_ggt_platform_loop_function *)_ggt_platform_library_function(library, "ggtp_loop");
+        _ggt_platform_draw_function *draw = (_ggt_platform_draw_function *)_ggt_platform_library_function(library, "ggtp_draw");
+        if(!init || !loop || !draw){
+            _ggt_platform_unload_library(library);
+            return GGT_FAILURE;
+        }
+        
+        if(ggt_platform_code.library)
+            _ggt_platform_unload_library(ggt_platform_code.library);
+        ggt_platform_code.library = library;
+        ggt_platform_code.copy_index = copy_index;
+        ggt_platform_code.init = init;
+        ggt_platform_code.loop = loop;
+        ggt_platform_code.draw = draw;
+        return GGT_SUCCESS;
+    }
+    
+    void _ggt_platform_reload_code(void){
+        char path[_GGTP_PATH_SIZE];
+        ggtp_program_file_path(GGTP_HOT_RELOAD, path);
+        ggt_u64 date = ggtp_file_modification_date(path);
+        if(date && date != ggt_platform_code.modification_date){
+            // Probably still being written, wait until it settles
+            ggt_platform_code.modification_date = date;
+            ggt_platform_code.change_time = _ggt_platform_milliseconds() | 1;
+            ggt_platform_code.attempts = 0;
+            return;
+        }
+        
+        if(!ggt_platform_code.change_time ||
+           (int)(_ggt_platform_milliseconds() - ggt_platform_code.change_time) < GGTP_HOT_RELOAD_DELAY)
+            return;
+        
+        if(_ggt_platform_load_code() == GGT_SUCCESS){
+            ggt_platform_code.change_time = 0;
+            printf("Reloaded %s\n", GGTP_HOT_RELOAD);
+            ggtp_request_redraw();
+        }else if(++ggt_platform_code.attempts < _GGTP_HOT_RELOAD_ATTEMPTS){
+            ggt_platform_code.change_time = _ggt_platform_milliseconds() | 1; // Try again a bit later
+        }else{
+            ggt_platform_code.change_time = 0;
+            printf("Couldn't reload %s, keeping the old code\n", GGTP_HOT_RELOAD);
+        }
+    }
+#endif
+    
+#ifdef GGTP_RENDER_THREAD
+    
+    //
+    // Triple-buffered state snapshots
+    //
+    
+#ifndef GGTP_SIMULATION_HZ
+#define GGTP_SIMULATION_HZ 60
+#endif
+    
+#ifdef GGTP_RENDER_STATE
+#define _GGTP_SNAPSHOT_STATE GGTP_RENDER_STATE
+#else
+#define _GGTP_SNAPSHOT_STATE GGTP_PROGRAM_STATE
+#endif
+    
+    // The simulation owns slots[back] and the renderer slots[front]. The
+    // third slot is swapped in and out of middle atomically, with
+    // GGTP_SNAPSHOT_NEW set while the renderer hasn't picked it up yet.
+#define GGTP_SNAPSHOT_NEW 4
+    typedef struct {
+        _GGTP_SNAPSHOT_STATE slots[3];
+        ggt_u32 back, middle, front;
+    } _ggt_platform_snapshots;
+    
+    void _ggt_platform_take_snapshot(GGTP_PROGRAM_STATE *program_state, _GGTP_SNAPSHOT_STATE *snapshot){
+#ifdef GGTP_RENDER_STATE
+        ggtp_snapshot(program_state, snapshot);
+#else
+        memcpy(snapshot, program_state, sizeof(GGTP_PROGRAM_STATE));
+#endif
+    }
+    
+    void _ggt_platform_init_snapshots(_ggt_platform_snapshots *snapshots, GGTP_PROGRAM_STATE *program_state){
+        snapshots->front = 0;
+        snapshots->middle = 1;
+        snapshots->back = 2;
+        _ggt_platform_take_snapshot(program_state, &snapshots->slots[snapshots->front]);
+    }
+    
+    void _ggt_platform_publish_snapshot(_ggt_platform_snapshots *snapshots, GGTP_PROGRAM_STATE *program_state){
+        _ggt_platform_take_snapshot(program_state, &snapshots->slots[snapshots->back]);
+        snapshots->back = GGTP_ATOMIC_EXCHANGE(&snapshots->middle, snapshots->back | GGTP_SNAPSHOT_NEW) & ~GGTP_SNAPSHOT_NEW;
+    }
+    
+    int _ggt_platform_snapshot_ready(_ggt_platform_snapshots *snapshots){
+        return (GGTP_ATOMIC_LOAD(&snapshots->middle) & GGTP_SNAPSHOT_NEW) != 0;
+    }
+    
+    _GGTP_SNAPSHOT_STATE *_ggt_platform_acquire_snapshot(_ggt_platform_snapshots *snapshots){
+        if(GGTP_ATOMIC_LOAD(&snapshots->middle) & GGTP_SNAPSHOT_NEW)
+            snapshots->front = GGTP_ATOMIC_EXCHANGE(&snapshots->middle, snapshots->front) & ~GGTP_SNAPSHOT_NEW;
+        return &snapshots->slots[snapshots->front];
+    }
+    
+#ifndef __EMSCRIPTEN__
+    // Posted on input and redraw requests, the simulation thread waits on it
+    // while ggtp_loop has nothing to do
+    ggt_semaphore _ggt_platform_simulation_semaphore;
+    
+    void _ggt_platform_wake_simulation(void){
+        if(_ggt_platform_simulation_semaphore)
+            ggtp_semaphore_post(_ggt_platform_simulation_semaphore);
+    }
+    
+    int _ggt_platform_simulation_thread(void *data);
+#endif
+    
+#endif
+    
+    
+#if defined(_WIN32)
+    //
+    // Windows implementation
+    //
+    
+#pragma comment(lib, "user32.lib")
+#pragma comment(lib, "opengl32.lib")
+#pragma comment(lib, "gdi32.lib")
+#pragma comment(lib, "winmm.lib")
+#pragma comment(lib, "ole32.lib")
+    
+#include <initguid.h>
+#include <KnownFolders.h>
+    //#include <ShlObj.h>
+#include <wchar.h>
+#include <windowsx.h>
+#include <WinUser.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+    
+#define GGT_PLATFORM_ALERT_ERROR(message, code) MessageBox(NULL, message "\n(ggt_platform error " code ")", "ERROR", MB_OK);
+    
+#ifdef GGTP_PROGRAM_STATE
+#ifdef GGTP_MEMORY
+#define GGTP_INIT() ggtp_init(ggt_globals.program_state, &ggt_platform_memory_state)
+#else
+#define GGTP_INIT() ggtp_init(ggt_globals.program_state)
+#endif
+#define GGTP_LOOP(a, b) _ggt_platform_end_loop(ggtp_loop(ggt_globals.program_state, a, (_ggt_platform_frame_events(a, &(b)), (b))))
+#ifdef GGTP_RENDER_THREAD
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw(_ggt_platform_acquire_snapshot(&ggt_globals.snapshots)))
+#else
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw(ggt_globals.program_state))
+#endif
+#else
+#ifdef GGTP_MEMORY
+#define GGTP_INIT() ggtp_init(&ggt_platform_memory_state)
+#else
+#define GGTP_INIT() ggtp_init()
+#endif
+#define GGTP_LOOP(a, b) _ggt_platform_end_loop(ggtp_loop(a, (_ggt_platform_frame_events(a, &(b)), (b))))
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw())
+#endif
+    
+    //
+    // WGL preprocessor and function definitions
+    // (From https://www.khronos.org/registry/OpenGL/api/GL/wglext.h)
+    //
+    
+#ifndef __wgl_wglext_h_
+    
+    // Context creation
+#define WGL_CONTEXT_DEBUG_BIT_ARB         0x00000001
+#define WGL_CONTEXT_FORWARD_COMPATIBLE_BIT_ARB 0x00000002
+#define WGL_CONTEXT_MAJOR_VERSION_ARB     0x2091
+#define WGL_CONTEXT_MINOR_VERSION_ARB     0x2092
+#define WGL_CONTEXT_LAYER_PLANE_ARB       0x2093
+#define WGL_CONTEXT_FLAGS_ARB             0x2094
+#define ERROR_INVALID_VERSION_ARB         0x2095
+    typedef HGLRC (WINAPI * PFNWGLCREATECONTEXTATTRIBSARBPROC) (HDC hDC, HGLRC hShareContext, const int *attribList);
+    
+    // Swap interval
+    typedef BOOL (WINAPI * PFNWGLSWAPINTERVALEXTPROC) (int interval);
+    typedef int (WINAPI * PFNWGLGETSWAPINTERVALEXTPROC) (void);
+    BOOL WINAPI wglSwapIntervalEXT (int interval);
+    int WINAPI wglGetSwapIntervalEXT (void);
+    
+#endif
+    
+    //
+    //
+    //
+    
+    struct {
+        ggt_platform_events events;
+        ggt_u8 keys[GGTP_TOTAL_KEYS];
+        ggt_vec2i last_mouse_position;
+#ifdef GGTP_PROGRAM_STATE
+        GGTP_PROGRAM_STATE *program_state;
+#endif
+#ifdef _GGTP_EVENT_RING
+        _ggt_platform_event_ring event_ring;
+        ggt_u32 running;
+#endif
+#ifdef GGTP_RENDER_THREAD
+        _ggt_platform_snapshots snapshots;
+#endif
+        
+        HWND hWnd;
+        HDC hDC;
+        HGLRC hRC;
+#ifdef GGTP_LOADER_CONTEXT
+        HGLRC loader_rc;
+#endif
+        HINSTANCE hInstance;
+        PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT;
+#ifdef GGTP_INPUT_THREAD
+        ggt_semaphore wake;
+#endif
+    } ggt_globals;
+    
+    ggt_u8 _ggt_platform_get_key_code(ggt_u32 code) {
+        switch (code) {
+            case VK_LEFT:
+            return GGTP_KEY_LEFT;
+            break;
+            case VK_UP:
+            return GGTP_KEY_UP;
+            break;
+            case VK_RIGHT:
+            return GGTP_KEY_RIGHT;
+            break;
+            case VK_DOWN:
+            return GGTP_KEY_DOWN;
+            case VK_ESCAPE:
+            return GGTP_KEY_ESC;
+            case VK_LSHIFT:
+            case VK_RSHIFT:
+            case VK_SHIFT:
+            return GGTP_KEY_SHIFT;
+            case VK_SPACE:
+            return GGTP_KEY_SPACE;
+            default:
+            return (ggt_u8)code;
+        }
+    }
+    
+    LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam){
+        switch(msg){
+            case WM_CREATE:
+            break;
+            
+            case WM_SIZE:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_RESIZE, size, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
+            break;
+            
+            case WM_SYSKEYDOWN:
+            case WM_KEYDOWN: {
+                ggt_u8 value = _ggt_platform_get_key_code((ggt_u32)wParam);
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_KEY_DOWN, key, value);
+            } break;
+            
+            case WM_SYSKEYUP:
+            case WM_KEYUP: {
+                ggt_u8 value = _ggt_platform_get_key_code((ggt_u32)wParam);
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_KEY_UP, key, value);
+            } break;
+            
+            case WM_LBUTTONDOWN:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_DOWN, coords, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
+            break;
+            
+            case WM_RBUTTONDOWN:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_RIGHT_DOWN, coords, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
+            break;
+            
+            case WM_LBUTTONUP:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_UP, coords, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
+            break;
+            
+            case WM_RBUTTONUP:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_RIGHT_UP, coords, {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)});
+            break;
+            
+            case WM_MOUSEMOVE: {
+                ggt_vec2i position = {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)};
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_MOVE, mouse_movement, {position.x, position.y, position.x - ggt_globals.last_mouse_position.x, position.y - ggt_globals.last_mouse_position.y});
+                ggt_globals.last_mouse_position = position;
+            } break;
+            
+            case WM_DESTROY:
+            case WM_QUIT:
+            case WM_CLOSE:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_CLOSE, key, 0);
+            PostQuitMessage(0);
+            break;
+        }
+        return DefWindowProc(hWnd, msg, wParam, lParam);
+    }
+    
+#define GGT_PLATFORM_WINDOW_CLASS_NAME "WINDOWCLASS"
+    
+    void _ggt_platform_apply_frame_pacing(void){
+        if(!ggt_globals.wglSwapIntervalEXT)
+            return;
+        int interval = _ggt_platform_swap_interval();
+        if(!ggt_globals.wglSwapIntervalEXT(interval) && interval == -1)
+            ggt_globals.wglSwapIntervalEXT(1); // No WGL_EXT_swap_control_tear, fall back to vsync
+    }
+    
+    void _ggt_platform_wake(void){
+#ifdef GGTP_INPUT_THREAD
+        ggtp_semaphore_post(ggt_globals.wake);
+#else
+        if(ggt_globals.hWnd)
+            PostMessage(ggt_globals.hWnd, WM_NULL, 0, 0);
+#endif
+    }
+    
+#ifdef _GGTP_EVENT_RING
+    // Ends the frame loops, waking up the threads that may be waiting
+    void _ggt_platform_stop(void){
+        GGTP_ATOMIC_STORE(&ggt_globals.running, 0);
+        _ggt_platform_wake();
+        _ggt_platform_wake_simulation();
+        if(ggt_globals.hWnd)
+            PostMessage(ggt_globals.hWnd, WM_NULL, 0, 0);
+    }
+#endif
+    
+    void _ggt_platform_wait_for_redraw(void){
+#ifdef GGTP_INPUT_THREAD
+        // Input reaches this thread through the ring, which posts ggt_globals.wake
+        while(ggtp_semaphore_wait(ggt_globals.wake, 0) == GGT_SUCCESS);
+#ifndef GGTP_RENDER_THREAD
+        if(!_ggt_platform_ring_empty(&ggt_globals.event_ring))
+            return;
+#endif
+        int timeout = _ggt_platform_redraw_timeout();
+        if(timeout != 0)
+            ggtp_semaphore_wait(ggt_globals.wake, timeout);
+#else
+        int timeout = _ggt_platform_redraw_timeout();
+        if(timeout != 0)
+            MsgWaitForMultipleObjects(0, NULL, FALSE, (timeout < 0) ? INFINITE : (DWORD)timeout, QS_ALLINPUT);
+#endif
+    }
+    
+#ifdef GGTP_INPUT_THREAD
+    int _ggt_platform_gl_thread(void *data){
+        wglMakeCurrent(ggt_globals.hDC, ggt_globals.hRC);
+        
+        while(GGTP_ATOMIC_LOAD(&ggt_globals.running)){
+            _ggt_platform_begin_frame();
+            
+#ifdef GGTP_RENDER_THREAD
+            // ggtp_loop runs on the simulation thread, only draw what it publishes
+            if(!_ggt_platform_snapshot_ready(&ggt_globals.snapshots) && !_ggt_platform_should_draw(GGTP_NO_REDRAW)){
+                _ggt_platform_wait_for_redraw();
+                continue;
+            }
+#else
+            ggt_platform_events events;
+            _ggt_platform_drain_event_ring(&ggt_globals.event_ring, &events, ggt_globals.keys);
+            
+            int result = GGTP_LOOP(ggt_globals.keys, events);
+            if(result == GGT_FAILURE)
+                break;
+            
+            if(!_ggt_platform_should_draw(result)){
+                _ggt_platform_wait_for_redraw();
+                continue;
+            }
+#endif
+            
+            GGTP_DRAW();
+            
+            _ggt_platform_before_swap();
+            SwapBuffers(ggt_globals.hDC);
+            _ggt_platform_after_swap();
+        }
+        
+        wglMakeCurrent(NULL, NULL);
+        _ggt_platform_stop();
+        return 0;
+    }
+#endif
+    
+#define GL_FUNCTION(TYPE, NAME, ...) _ggtp_gl_type_##NAME *NAME;
+    GGTP_GL_FUNCTION_LIST
+#undef GL_FUNCTION
+    
+        int ggtp_create_window(int width, int height, const char *window_name){
+        int screen_x = GetSystemMetrics(SM_CXSCREEN);
         int screen_y = GetSystemMetrics(SM_CYSCREEN);
         
-        RECT actualSize;
-        actualSize.left = (screen_x - width) / 2;
-        actualSize.right = actualSize.left + width;
-        actualSize.top = (screen_y - height) / 2;
-        actualSize.bottom = actualSize.top + height;
-        if(!AdjustWindowRect(&actualSize, WS_OVERLAPPEDWINDOW | WS_VISIBLE, FALSE)){
-            
+        RECT actualSize;
+        actualSize.left = (screen_x - width) / 2;
+        actualSize.right = actualSize.left + width;
+        actualSize.top = (screen_y - height) / 2;
+        actualSize.bottom = actualSize.top + height;
+        if(!AdjustWindowRect(&actualSize, WS_OVERLAPPEDWINDOW | WS_VISIBLE, FALSE)){
+            
+        }
+        ggt_globals.hWnd = CreateWindow(GGT_PLATFORM_WINDOW_CLASS_NAME, window_name, WS_OVERLAPPEDWINDOW | WS_VISIBLE, actualSize.left, actualSize.top, actualSize.right - actualSize.left, actualSize.bottom - actualSize.top, NULL, NULL, ggt_globals.hInstance, NULL);
+        
+        if(!ggt_globals.hWnd){
+            GGT_PLATFORM_ALERT_ERROR("Cannot create window.", "1");
+            return GGT_FAILURE;
+        }
+        
+        ggt_globals.hDC = GetDC(ggt_globals.hWnd);
+        PIXELFORMATDESCRIPTOR pfd;
+        pfd.nSize = sizeof(PIXELFORMATDESCRIPTOR);
+        pfd.nVersion = 1;
+        pfd.iLayerType = PFD_MAIN_PLANE;
+        pfd.dwFlags = PFD_SUPPORT_OPENGL | PFD_DRAW_TO_WINDOW | PFD_DOUBLEBUFFER;
+        pfd.cDepthBits = 24;
+        pfd.cColorBits = 24;
+        pfd.iPixelType = PFD_TYPE_RGBA;
+        
+        int PixelFormat = ChoosePixelFormat(ggt_globals.hDC, &pfd);
+        if (!SetPixelFormat(ggt_globals.hDC, PixelFormat, &pfd)) {
+            GGT_PLATFORM_ALERT_ERROR("Cannot set pixel format.", "2");
+            return GGT_FAILURE;
+        }
+        
+        int attriblist[] = {
+            WGL_CONTEXT_MAJOR_VERSION_ARB, 2,
+            WGL_CONTEXT_MINOR_VERSION_ARB, 1,
+            0
+        };
+        
+        HGLRC hRCtmp = wglCreateContext(ggt_globals.hDC);
+        wglMakeCurrent(ggt_globals.hDC, hRCtmp);
+        
+        
+        PFNWGLCREATECONTEXTATTRIBSARBPROC wglCreateContextAttribsARB =
+            (PFNWGLCREATECONTEXTATTRIBSARBPROC)wglGetProcAddress("wglCreateContextAttribsARB");
+        ggt_globals.hRC = wglCreateContextAttribsARB(ggt_globals.hDC, 0, attriblist);
+        
+        ggt_globals.wglSwapIntervalEXT =
+            (PFNWGLSWAPINTERVALEXTPROC)wglGetProcAddress("wglSwapIntervalEXT");
+        if (!ggt_globals.wglSwapIntervalEXT) {
+            printf("Error: Could not find 'wglSwapIntervalEXT'\n");
+        }
+        
+        if (!ggt_globals.hRC) {
+            GGT_PLATFORM_ALERT_ERROR("Could not create OpenGL context.", "3");
+            return GGT_FAILURE;
+        }
+        
+#ifdef GGTP_LOADER_CONTEXT
+        // Shares objects with the main context, for the loader thread
+        ggt_globals.loader_rc = wglCreateContextAttribsARB(ggt_globals.hDC, ggt_globals.hRC, attriblist);
+#endif
+        
+        wglMakeCurrent(NULL, NULL);
+        wglDeleteContext(hRCtmp);
+        wglMakeCurrent(ggt_globals.hDC, ggt_globals.hRC);
+        
+        int refresh_rate = GetDeviceCaps(ggt_globals.hDC, VREFRESH);
+        if(refresh_rate > 1) // 0 and 1 mean "hardware default"
+            ggt_platform_pacing_state.refresh_period = 1000000 / refresh_rate;
+        _ggt_platform_apply_frame_pacing();
+        
+#define GL_FUNCTION(TYPE, NAME, ...) NAME = (_ggtp_gl_type_##NAME *)wglGetProcAddress(#NAME);
+        GGTP_GL_FUNCTION_LIST
+#undef GL_FUNCTION
+        
+#ifdef GGTP_LOADER_CONTEXT
+        if(ggt_globals.loader_rc){
+            ggt_platform_loader_state.fences = (glFenceSync != NULL);
+            _ggt_platform_start_loader();
+        }else{
+            printf("ggtp_create_window error: Couldn't create the loader context, GL jobs will run between frames\n");
+        }
+#endif
+        
+            return GGT_SUCCESS;
+    }
+    
+    
+    int _ggt_platform_win_main(HINSTANCE hInstance){
+        ggt_globals.events.size = 0;
+        
+        // We register the window class
+        WNDCLASS wc;
+        wc.cbClsExtra = 0;
+        wc.cbWndExtra = 0;
+        wc.hbrBackground = (HBRUSH)GetStockObject(LTGRAY_BRUSH);
+        wc.hCursor = LoadCursor(hInstance, IDC_ARROW);
+        wc.hIcon = LoadIcon(hInstance, IDI_APPLICATION);
+        wc.lpfnWndProc = WndProc;
+        wc.lpszClassName = GGT_PLATFORM_WINDOW_CLASS_NAME;
+        wc.lpszMenuName = NULL;
+        wc.style = CS_VREDRAW | CS_HREDRAW;
+        wc.hInstance = hInstance;
+        if(!RegisterClass(&wc)){
+            GGT_PLATFORM_ALERT_ERROR("Cannot register window.", "0");
+            return GGT_C_FAILURE;
+        }
+        
+        ggt_globals.hInstance = hInstance;
+        
+#ifdef GGTP_HOT_RELOAD
+        if(_ggt_platform_load_code() == GGT_FAILURE){
+            GGT_PLATFORM_ALERT_ERROR("Cannot load the GGTP_HOT_RELOAD library.", "7");
+            return GGT_C_FAILURE;
+        }
+#endif
+        
+#ifdef GGTP_MEMORY
+        if(_ggt_platform_init_memory() == GGT_FAILURE){
+            GGT_PLATFORM_ALERT_ERROR("Cannot reserve memory.", "6");
+            return GGT_C_FAILURE;
+        }
+#ifdef GGTP_PROGRAM_STATE
+        ggt_globals.program_state = ggtp_arena_push_struct(&ggt_platform_memory_state.permanent, GGTP_PROGRAM_STATE);
+#endif
+#elif defined(GGTP_PROGRAM_STATE)
+        GGTP_PROGRAM_STATE program_state;
+        ggt_globals.program_state = &program_state;
+#endif
+        
+        if(GGTP_INIT() == GGT_FAILURE)
+            return GGT_C_FAILURE;
+        
+        if(!ggt_globals.hWnd){
+            GGT_PLATFORM_ALERT_ERROR("Window was not created in ggtp_init().", "4");
+            return GGT_C_FAILURE;
+        }
+        
+        for(int i=0; i<GGTP_TOTAL_KEYS; i++) {
+            ggt_globals.keys[i] = 0;
+        }
+        ggt_globals.events.size = 0;
+        
+#ifdef _GGTP_EVENT_RING
+        GGTP_ATOMIC_STORE(&ggt_globals.running, 1);
+        
+#ifdef GGTP_RENDER_THREAD
+        _ggt_platform_init_snapshots(&ggt_globals.snapshots, ggt_globals.program_state);
+        _ggt_platform_simulation_semaphore = ggtp_create_semaphore(0);
+        ggt_thread simulation_thread = ggtp_create_thread(_ggt_platform_simulation_thread, NULL, "ggtp_simulation");
+        if(!simulation_thread){
+            GGT_PLATFORM_ALERT_ERROR("Cannot create simulation thread.", "5");
+            return GGT_C_FAILURE;
+        }
+#endif
+        
+        MSG msg;
+#ifdef GGTP_INPUT_THREAD
+        // The context moves to its own thread, this one only pumps messages
+        ggt_globals.wake = ggtp_create_semaphore(0);
+        wglMakeCurrent(NULL, NULL);
+        ggt_thread gl_thread = ggtp_create_thread(_ggt_platform_gl_thread, NULL, "ggtp_gl");
+        if(!gl_thread){
+            GGT_PLATFORM_ALERT_ERROR("Cannot create OpenGL thread.", "5");
+            return GGT_C_FAILURE;
+        }
+        
+        while(GGTP_ATOMIC_LOAD(&ggt_globals.running)){
+            while(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)){
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
+            if(ggt_globals.event_ring.stashed_count > 0 && _ggt_platform_ring_flush(&ggt_globals.event_ring) == GGT_SUCCESS)
+                _ggt_platform_wake();
+            // Sleep until there is new input, only polling while key events
+            // wait for room in the ring
+            DWORD timeout = ggt_globals.event_ring.stashed_count ? 1000 / GGTP_INPUT_THREAD_HZ : INFINITE;
+            MsgWaitForMultipleObjectsEx(0, NULL, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        }
+        
+        ggtp_wait_thread(gl_thread);
+#else
+        // Pump messages and draw the newest snapshot here
+        while(GGTP_ATOMIC_LOAD(&ggt_globals.running)){
+            _ggt_platform_begin_frame();
+            
+            while(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)){
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
+            if(ggt_globals.event_ring.stashed_count > 0)
+                _ggt_platform_ring_flush(&ggt_globals.event_ring);
+            
+            if(!_ggt_platform_snapshot_ready(&ggt_globals.snapshots) && !_ggt_platform_should_draw(GGTP_NO_REDRAW)){
+                _ggt_platform_wait_for_redraw();
+                continue;
+            }
+            
+            GGTP_DRAW();
+            
+            _ggt_platform_before_swap();
+            SwapBuffers(ggt_globals.hDC);
+            _ggt_platform_after_swap();
+        }
+        
+        wglMakeCurrent(NULL, NULL);
+#endif
+        
+#ifdef GGTP_RENDER_THREAD
+        ggtp_wait_thread(simulation_thread);
+#endif
+#ifdef GGTP_LOADER_CONTEXT
+        _ggt_platform_stop_loader();
+        if(ggt_globals.loader_rc)
+            wglDeleteContext(ggt_globals.loader_rc);
+#endif
+        wglDeleteContext(ggt_globals.hRC);
+        ReleaseDC(ggt_globals.hWnd, ggt_globals.hDC);
+        return GGT_C_SUCCESS;
+#else
+        MSG msg;
+        while (1){
+            _ggt_platform_begin_frame();
+            
+            while (PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE)){
+                if (!GetMessage(&msg, NULL, 0, 0)){
+                    break;
+                }
+                DispatchMessage(&msg);
+                TranslateMessage(&msg);
+            }
+            
+            ggt_platform_events events;
+            events.size = ggt_globals.events.size;
+            for(ggt_u32 i=0; i<events.size; i++)
+                events.data[i] = ggt_globals.events.data[i];
+            ggt_globals.events.size = 0;
+            
+            int result = GGTP_LOOP(ggt_globals.keys, events);
+            if(result == GGT_FAILURE){
+                // Exit the program
+                wglMakeCurrent(NULL, NULL);
+#ifdef GGTP_LOADER_CONTEXT
+                _ggt_platform_stop_loader();
+                if(ggt_globals.loader_rc)
+                    wglDeleteContext(ggt_globals.loader_rc);
+#endif
+                wglDeleteContext(ggt_globals.hRC);
+                ReleaseDC(ggt_globals.hWnd, ggt_globals.hDC);
+                return GGT_C_SUCCESS;
+            }
+            
+            if(!_ggt_platform_should_draw(result)){
+                _ggt_platform_wait_for_redraw();
+                continue;
+            }
+            
+            GGTP_DRAW();
+            
+            _ggt_platform_before_swap();
+            SwapBuffers(ggt_globals.hDC);
+            _ggt_platform_after_swap();
+        }
+        
+        return GGT_C_SUCCESS;
+#endif
+    }
+    
+    int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevious, LPSTR lpCmdLine, int nCmdShow){
+        // Sleep() is too coarse for frame pacing otherwise
+        timeBeginPeriod(1);
+        int result = _ggt_platform_win_main(hInstance);
+        _ggt_platform_stop_file_io();
+        timeEndPeriod(1);
+        return result;
+    }
+    
+    void ggtp_set_cursor(ggt_platform_cursor cursor_id) {
+        LPCTSTR win_cursor = IDC_ARROW;
+        switch (cursor_id) {
+            case GGTP_CURSOR_ARROW:
+            win_cursor = IDC_ARROW;
+            break;
+            case GGTP_CURSOR_POINTER:
+            win_cursor = IDC_HAND;
+            break;
+            case GGTP_CURSOR_WAIT:
+            win_cursor = IDC_WAIT;
+            break;
+            case GGTP_CURSOR_WRITE:
+            win_cursor = IDC_IBEAM;
+            break;
+        }
+        HCURSOR cursor = (HCURSOR)LoadImageA(NULL, win_cursor, IMAGE_CURSOR, 0, 0, LR_DEFAULTSIZE | LR_DEFAULTCOLOR | LR_SHARED);
+        SetCursor(cursor);
+    }
+    
+    void ggtp_program_file_path(const char *name, char *dst){
+        sprintf(dst, "%s", name);
+    }
+    void ggtp_user_file_path(const char *name, char *dst){
+        sprintf(dst, "%s", name);
+    }
+    
+    ggt_u64 ggtp_file_modification_date(const char *path){
+        // In 100ns steps since 1601, _stat only has seconds, which misses
+        // rebuilds that happen within the same second
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if(!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+            return 0;
+        ggt_u64 time = ((ggt_u64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+        return (time - 116444736000000000ull) * 100;
+    }
+    
+#ifndef GGTP_MAX_WATCHES
+#define GGTP_MAX_WATCHES 64
+#endif
+    
+    typedef struct {
+        ggt_watch id;
+        HANDLE directory;
+        OVERLAPPED overlapped;
+        int recursive;
+        char path[_GGTP_PATH_SIZE];
+        DWORD buffer[16 * 1024 / sizeof(DWORD)]; // DWORD aligned, as ReadDirectoryChangesW wants
+    } _ggt_platform_watch;
+    
+    _ggt_platform_watch *ggt_platform_watches[GGTP_MAX_WATCHES];
+    ggt_watch ggt_platform_last_watch;
+    
+    int _ggt_platform_read_directory_changes(_ggt_platform_watch *watch){
+        DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+        return ReadDirectoryChangesW(watch->directory, watch->buffer, sizeof(watch->buffer), watch->recursive,
+                                     filter, NULL, &watch->overlapped, NULL) ? GGT_SUCCESS : GGT_FAILURE;
+    }
+    
+    ggt_watch ggtp_watch(const char *directory, int recursive){
+        int slot = 0;
+        while(slot < GGTP_MAX_WATCHES && ggt_platform_watches[slot])
+            slot++;
+        if(slot == GGTP_MAX_WATCHES){
+            printf("ggtp_watch error: Too many watches\n");
+            return 0;
+        }
+        
+        _ggt_platform_watch *watch = (_ggt_platform_watch *)calloc(1, sizeof(_ggt_platform_watch));
+        if(!watch){
+            printf("ggtp_watch error: Couldn't allocate the watch\n");
+            return 0;
+        }
+        ggtp_program_file_path(directory, watch->path);
+        watch->recursive = recursive;
+        watch->directory = CreateFileA(watch->path, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                       NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+        if(watch->directory == INVALID_HANDLE_VALUE){
+            printf("ggtp_watch error: Couldn't open %s\n", watch->path);
+            free(watch);
+            return 0;
+        }
+        watch->overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if(_ggt_platform_read_directory_changes(watch) == GGT_FAILURE){
+            printf("ggtp_watch error: Couldn't watch %s\n", watch->path);
+            CloseHandle(watch->overlapped.hEvent);
+            CloseHandle(watch->directory);
+            free(watch);
+            return 0;
+        }
+        
+        watch->id = ++ggt_platform_last_watch;
+        ggt_platform_watches[slot] = watch;
+        ggt_platform_watch_state.watches++;
+        return watch->id;
+    }
+    
+    void ggtp_unwatch(ggt_watch id){
+        for(int i = 0; i < GGTP_MAX_WATCHES; i++){
+            _ggt_platform_watch *watch = ggt_platform_watches[i];
+            if(watch && watch->id == id){
+                CancelIo(watch->directory);
+                CloseHandle(watch->directory);
+                CloseHandle(watch->overlapped.hEvent);
+                free(watch);
+                ggt_platform_watches[i] = NULL;
+                ggt_platform_watch_state.watches--;
+                return;
+            }
+        }
+    }
+    
+    void _ggt_platform_poll_watches(void){
+        for(int i = 0; i < GGTP_MAX_WATCHES; i++){
+            _ggt_platform_watch *watch = ggt_platform_watches[i];
+            if(!watch)
+                continue;
+            
+            DWORD size;
+            if(!GetOverlappedResult(watch->directory, &watch->overlapped, &size, FALSE))
+                continue; // ERROR_IO_INCOMPLETE, nothing new
+            
+            if(size == 0)
+                printf("ggtp_watch: Too many changes in %s, some were lost\n", watch->path);
+            
+            FILE_NOTIFY_INFORMATION *info = (FILE_NOTIFY_INFORMATION *)watch->buffer;
+            while(size){
+                char name[_GGTP_PATH_SIZE];
+                int length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, info->FileNameLength / sizeof(WCHAR),
+                                                 name, sizeof(name), NULL, NULL);
+                if(length > 0)
+                    _ggt_platform_file_changed(watch->path, name, length);
+                
+                if(!info->NextEntryOffset)
+                    break;
+                info = (FILE_NOTIFY_INFORMATION *)((char *)info + info->NextEntryOffset);
+            }
+            
+            ResetEvent(watch->overlapped.hEvent);
+            _ggt_platform_read_directory_changes(watch);
+        }
+    }
+    
+    int _ggt_platform_start_file_io(void){
+        return _ggt_platform_start_file_threads();
+    }
+    
+    const ggt_u8 *_ggt_platform_map_file(const char *path, ggt_u64 *size, void **handle){
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE)
+            return NULL;
+        LARGE_INTEGER file_size;
+        HANDLE mapping = NULL;
+        if(GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file); // The mapping keeps it open
+        if(!mapping)
+            return NULL;
+        
+        const ggt_u8 *data = (const ggt_u8 *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(!data){
+            CloseHandle(mapping);
+            return NULL;
+        }
+        *size = (ggt_u64)file_size.QuadPart;
+        *handle = (void *)mapping;
+        return data;
+    }
+    
+    void _ggt_platform_unmap_file(const ggt_u8 *data, ggt_u64 size, void *handle){
+        UnmapViewOfFile(data);
+        CloseHandle((HANDLE)handle);
+    }
+    
+    void _ggt_platform_kick_file_io(void){
+        ggtp_semaphore_post(ggt_platform_file_state.work);
+    }
+    
+    void _ggt_platform_stop_file_io(void){
+        _ggt_platform_stop_file_threads();
+    }
+    
+#ifdef GGTP_HOT_RELOAD
+    void *_ggt_platform_load_library(const char *path){
+        return (void *)LoadLibraryA(path);
+    }
+    
+    void *_ggt_platform_library_function(void *library, const char *name){
+        return (void *)GetProcAddress((HMODULE)library, name);
+    }
+    
+    void _ggt_platform_unload_library(void *library){
+        FreeLibrary((HMODULE)library);
+    }
+#endif
+    
+    ggt_u64 ggtp_time_microseconds(void){
+        LARGE_INTEGER counter, frequency;
+        QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        return (ggt_u64)(counter.QuadPart / frequency.QuadPart) * 1000000
+            + (ggt_u64)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+    }
+    
+    typedef struct {
+        ggt_thread_function *function;
+        void *data;
+    } _ggt_platform_thread_start;
+    
+    DWORD WINAPI _ggt_platform_thread_proc(LPVOID parameter){
+        _ggt_platform_thread_start start = *(_ggt_platform_thread_start *)parameter;
+        free(parameter);
+        return (DWORD)start.function(start.data);
+    }
+    
+    ggt_thread ggtp_create_thread(ggt_thread_function *function, void *data, const char *name){
+        _ggt_platform_thread_start *start = (_ggt_platform_thread_start *)malloc(sizeof(_ggt_platform_thread_start));
+        start->function = function;
+        start->data = data;
+        HANDLE thread = CreateThread(NULL, 0, _ggt_platform_thread_proc, start, 0, NULL);
+        if(!thread)
+            free(start);
+        return (ggt_thread)thread;
+    }
+    
+    int ggtp_wait_thread(ggt_thread thread){
+        DWORD result = 0;
+        WaitForSingleObject((HANDLE)thread, INFINITE);
+        GetExitCodeThread((HANDLE)thread, &result);
+        CloseHandle((HANDLE)thread);
+        return (int)result;
+    }
+    
+    void ggtp_sleep_microseconds(ggt_u64 microseconds){
+        // Rounded up, Sleep(0) would only yield and turn short waits into a spin
+        Sleep((DWORD)((microseconds + 999) / 1000));
+    }
+    
+    int _ggt_platform_reserve_memory(ggt_arena *arena, ggt_u64 size, int huge_pages){
+        if(huge_pages && size <= GGTP_LARGE_PAGES_MAX_SIZE){
+            // Large pages can't be committed lazily (hence the size limit) and
+            // need the "Lock pages in memory" privilege, so fall back to
+            // normal pages if it fails
+            SIZE_T large_page = GetLargePageMinimum();
+            if(large_page){
+                ggt_u64 large_size = (size + large_page - 1) / large_page * large_page;
+                void *memory = VirtualAlloc(NULL, (SIZE_T)large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+                if(memory){
+                    arena->base = (ggt_u8 *)memory;
+                    arena->reserved = arena->committed = large_size;
+                    return GGT_SUCCESS;
+                }
+            }
+        }
+        
+        void *memory = VirtualAlloc(NULL, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+        if(!memory)
+            return GGT_FAILURE;
+        arena->base = (ggt_u8 *)memory;
+        arena->reserved = size;
+        arena->committed = 0;
+        return GGT_SUCCESS;
+    }
+    
+    int _ggt_platform_commit_memory(void *address, ggt_u64 size){
+        return VirtualAlloc(address, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) ? GGT_SUCCESS : GGT_FAILURE;
+    }
+    
+    void _ggt_platform_release_memory(ggt_arena *arena){
+        VirtualFree(arena->base, 0, MEM_RELEASE);
+    }
+    
+    ggt_semaphore ggtp_create_semaphore(ggt_u32 initial_count){
+        return (ggt_semaphore)CreateSemaphore(NULL, (LONG)initial_count, 0x7fffffff, NULL);
+    }
+    
+    void ggtp_destroy_semaphore(ggt_semaphore semaphore){
+        CloseHandle((HANDLE)semaphore);
+    }
+    
+    void ggtp_semaphore_post(ggt_semaphore semaphore){
+        ReleaseSemaphore((HANDLE)semaphore, 1, NULL);
+    }
+    
+    int ggtp_semaphore_wait(ggt_semaphore semaphore, int timeout){
+        DWORD milliseconds = (timeout < 0) ? INFINITE : (DWORD)timeout;
+        return (WaitForSingleObject((HANDLE)semaphore, milliseconds) == WAIT_OBJECT_0) ? GGT_SUCCESS : GGT_FAILURE;
+    }
+    
+    int ggtp_thread_set_affinity(ggt_u64 core_mask){
+        return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)core_mask) ? GGT_SUCCESS : GGT_FAILURE;
+    }
+    
+    int ggtp_thread_set_priority(ggt_platform_priority priority){
+        int value = (priority == GGTP_PRIORITY_LOW) ? THREAD_PRIORITY_BELOW_NORMAL :
+            (priority == GGTP_PRIORITY_HIGH) ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_NORMAL;
+        return SetThreadPriority(GetCurrentThread(), value) ? GGT_SUCCESS : GGT_FAILURE;
+    }
+    
+    void _ggt_platform_detect_topology(ggt_system_info *info){
+        DWORD length = 0;
+        GetLogicalProcessorInformation(NULL, &length);
+        SYSTEM_LOGICAL_PROCESSOR_INFORMATION *processors = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION *)malloc(length);
+        if(!processors || !GetLogicalProcessorInformation(processors, &length)){
+            free(processors);
+            SYSTEM_INFO system;
+            GetSystemInfo(&system);
+            info->logical_cores = system.dwNumberOfProcessors;
+            return;
+        }
+        
+        for(DWORD i = 0; i < length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION); i++){
+            SYSTEM_LOGICAL_PROCESSOR_INFORMATION *processor = &processors[i];
+            switch(processor->Relationship){
+                case RelationProcessorCore: {
+                    info->physical_cores++;
+                    for(ULONG_PTR mask = processor->ProcessorMask; mask; mask &= mask - 1)
+                        info->logical_cores++;
+                } break;
+                case RelationNumaNode: {
+                    info->numa_nodes++;
+                } break;
+                case RelationCache: {
+                    CACHE_DESCRIPTOR *cache = &processor->Cache;
+                    if(cache->Type != CacheData && cache->Type != CacheUnified)
+                        break;
+                    if(cache->Level == 1 && !info->l1_cache_size){
+                        info->l1_cache_size = cache->Size;
+                        info->cache_line_size = cache->LineSize;
+                    }else if(cache->Level == 2 && !info->l2_cache_size){
+                        info->l2_cache_size = cache->Size;
+                    }else if(cache->Level == 3 && !info->l3_cache_size){
+                        info->l3_cache_size = cache->Size;
+                    }
+                } break;
+                default: {
+                } break;
+            }
+        }
+        free(processors);
+    }
+    
+#ifdef GGTP_LOADER_CONTEXT
+    void _ggt_platform_bind_loader_context(void){
+        wglMakeCurrent(ggt_globals.hDC, ggt_globals.loader_rc);
+    }
+    
+    void _ggt_platform_release_loader_context(void){
+        wglMakeCurrent(NULL, NULL);
+    }
+#endif
+    
+#ifndef WAVE_FORMAT_IEEE_FLOAT
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#endif
+#ifndef AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM
+#define AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM 0x80000000
+#endif
+#ifndef AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY
+#define AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY 0x08000000
+#endif
+    
+    // COM methods are called through lpVtbl in C, and GUIDs are passed by
+    // pointer instead of by reference
+#ifdef __cplusplus
+#define _GGTP_COM(object, method, ...) ((object)->method(__VA_ARGS__))
+#define _GGTP_COM0(object, method) ((object)->method())
+#define _GGTP_GUID(guid) (guid)
+#else
+#define _GGTP_COM(object, method, ...) ((object)->lpVtbl->method((object), __VA_ARGS__))
+#define _GGTP_COM0(object, method) ((object)->lpVtbl->method(object))
+#define _GGTP_GUID(guid) (&(guid))
+#endif
+#define _GGTP_RELEASE(object) if(object) _GGTP_COM0(object, Release)
+    
+    // Spelled out so that no uuid library has to be linked
+    static const GUID _ggt_platform_clsid_device_enumerator = {0xBCDE0395, 0xE52F, 0x467C, {0x8E, 0x3D, 0xC4, 0x57, 0x92, 0x91, 0x69, 0x2E}};
+    static const GUID _ggt_platform_iid_device_enumerator = {0xA95664D2, 0x9614, 0x4F35, {0xA7, 0x46, 0xDE, 0x8D, 0xB6, 0x36, 0x17, 0xE6}};
+    static const GUID _ggt_platform_iid_audio_client = {0x1CB9AD4C, 0xDBFA, 0x4C32, {0xB1, 0x78, 0xC2, 0xF5, 0x68, 0xA7, 0x03, 0xB2}};
+    static const GUID _ggt_platform_iid_render_client = {0xF294ACFC, 0x3146, 0x4483, {0xA7, 0xBF, 0xAD, 0xDC, 0xA7, 0xC2, 0x60, 0xE2}};
+    
+    // WASAPI in shared mode. The device signals the event every period and
+    // the audio thread refills what it played since the last one. The
+    // device is opened, used and released on that thread, which is the only
+    // one that touches COM
+    struct {
+        HANDLE event;
+        ggt_thread thread;
+        ggt_semaphore opened;
+        ggt_u32 sample_rate;
+        ggt_u32 buffer_frames;
+        int result; // Of opening the device, read once opened is posted
+        ggt_u32 running;
+    } ggt_platform_wasapi;
+    
+    int _ggt_platform_wasapi_thread(void *data){
+        ggtp_thread_set_priority(GGTP_PRIORITY_HIGH);
+        
+        IMMDeviceEnumerator *enumerator = NULL;
+        IMMDevice *device = NULL;
+        IAudioClient *client = NULL;
+        IAudioRenderClient *render = NULL;
+        UINT32 total_frames = 0;
+        BYTE *buffer;
+        
+        HRESULT result = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+        int com_initialized = SUCCEEDED(result);
+        if(SUCCEEDED(result))
+            result = CoCreateInstance(_GGTP_GUID(_ggt_platform_clsid_device_enumerator), NULL, CLSCTX_ALL,
+                                      _GGTP_GUID(_ggt_platform_iid_device_enumerator), (void **)&enumerator);
+        if(SUCCEEDED(result))
+            result = _GGTP_COM(enumerator, GetDefaultAudioEndpoint, eRender, eConsole, &device);
+        if(SUCCEEDED(result))
+            result = _GGTP_COM(device, Activate, _GGTP_GUID(_ggt_platform_iid_audio_client), CLSCTX_ALL, NULL, (void **)&client);
+        if(SUCCEEDED(result)){
+            WAVEFORMATEX format;
+            memset(&format, 0, sizeof(format));
+            format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+            format.nChannels = 2;
+            format.nSamplesPerSec = ggt_platform_wasapi.sample_rate;
+            format.wBitsPerSample = 32;
+            format.nBlockAlign = 2 * sizeof(float);
+            format.nAvgBytesPerSec = ggt_platform_wasapi.sample_rate * format.nBlockAlign;
+            
+            // The mixer resamples if the device runs at another rate. The
+            // buffer can't be shorter than the device period
+            REFERENCE_TIME duration = (REFERENCE_TIME)ggt_platform_wasapi.buffer_frames * 10000000 / ggt_platform_wasapi.sample_rate;
+            result = _GGTP_COM(client, Initialize, AUDCLNT_SHAREMODE_SHARED,
+                               AUDCLNT_STREAMFLAGS_EVENTCALLBACK | AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM |
+                               AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY, duration, 0, &format, NULL);
+        }
+        if(SUCCEEDED(result))
+            result = _GGTP_COM(client, SetEventHandle, ggt_platform_wasapi.event);
+        if(SUCCEEDED(result))
+            result = _GGTP_COM(client, GetBufferSize, &total_frames);
+        if(SUCCEEDED(result))
+            result = _GGTP_COM(client, GetService, _GGTP_GUID(_ggt_platform_iid_render_client), (void **)&render);
+        // Start from a buffer of silence so that the first period doesn't underrun
+        if(SUCCEEDED(result))
+            result = _GGTP_COM(render, GetBuffer, total_frames, &buffer);
+        if(SUCCEEDED(result))
+            result = _GGTP_COM(render, ReleaseBuffer, total_frames, AUDCLNT_BUFFERFLAGS_SILENT);
+        if(SUCCEEDED(result))
+            result = _GGTP_COM0(client, Start);
+        
+        if(FAILED(result))
+            printf("ggtp_audio_start error: Couldn't open the audio device (HRESULT 0x%08lx)\n", (unsigned long)result);
+        ggt_platform_wasapi.result = SUCCEEDED(result) ? GGT_SUCCESS : GGT_FAILURE;
+        ggtp_semaphore_post(ggt_platform_wasapi.opened);
+        
+        while(SUCCEEDED(result) && GGTP_ATOMIC_LOAD(&ggt_platform_wasapi.running)){
+            WaitForSingleObject(ggt_platform_wasapi.event, INFINITE);
+            UINT32 padding;
+            result = _GGTP_COM(client, GetCurrentPadding, &padding);
+            if(FAILED(result) || padding >= total_frames)
+                continue;
+            UINT32 frames = total_frames - padding;
+            result = _GGTP_COM(render, GetBuffer, frames, &buffer);
+            if(FAILED(result))
+                continue;
+            _ggt_platform_mix_audio((float *)buffer, frames);
+            result = _GGTP_COM(render, ReleaseBuffer, frames, 0);
+        }
+        if(ggt_platform_wasapi.result && FAILED(result))
+            printf("ggtp_audio error: Lost the audio device (HRESULT 0x%08lx)\n", (unsigned long)result);
+        
+        if(client)
+            _GGTP_COM0(client, Stop);
+        _GGTP_RELEASE(render);
+        _GGTP_RELEASE(client);
+        _GGTP_RELEASE(device);
+        _GGTP_RELEASE(enumerator);
+        if(com_initialized)
+            CoUninitialize();
+        return 0;
+    }
+    
+    int _ggt_platform_open_audio(ggt_u32 *sample_rate, ggt_u32 buffer_frames){
+        ggt_platform_wasapi.sample_rate = *sample_rate;
+        ggt_platform_wasapi.buffer_frames = buffer_frames;
+        ggt_platform_wasapi.event = CreateEvent(NULL, FALSE, FALSE, NULL);
+        ggt_platform_wasapi.opened = ggtp_create_semaphore(0);
+        ggt_platform_wasapi.result = GGT_FAILURE;
+        GGTP_ATOMIC_STORE(&ggt_platform_wasapi.running, 1);
+        ggt_platform_wasapi.thread = ggtp_create_thread(_ggt_platform_wasapi_thread, NULL, "ggtp_audio");
+        if(ggt_platform_wasapi.thread)
+            ggtp_semaphore_wait(ggt_platform_wasapi.opened, -1);
+        else
+            printf("ggtp_audio_start error: Couldn't create the audio thread\n");
+        ggtp_destroy_semaphore(ggt_platform_wasapi.opened);
+        
+        if(!ggt_platform_wasapi.result){
+            if(ggt_platform_wasapi.thread)
+                ggtp_wait_thread(ggt_platform_wasapi.thread);
+            CloseHandle(ggt_platform_wasapi.event);
+            return GGT_FAILURE;
+        }
+        return GGT_SUCCESS;
+    }
+    
+    void _ggt_platform_close_audio(void){
+        GGTP_ATOMIC_STORE(&ggt_platform_wasapi.running, 0);
+        SetEvent(ggt_platform_wasapi.event);
+        ggtp_wait_thread(ggt_platform_wasapi.thread);
+        CloseHandle(ggt_platform_wasapi.event);
+    }
+    
+#elif defined(__EMSCRIPTEN__)
+    
+#include <emscripten.h>
+#include <emscripten/html5.h>
+#include <emscripten/threading.h>
+    
+#ifdef GGTP_PROGRAM_STATE
+#ifdef GGTP_MEMORY
+#define GGTP_INIT() ggtp_init(ggt_globals.program_state, &ggt_platform_memory_state)
+#else
+#define GGTP_INIT() ggtp_init(ggt_globals.program_state)
+#endif
+#define GGTP_LOOP(a, b) _ggt_platform_end_loop(ggtp_loop(ggt_globals.program_state, a, (_ggt_platform_frame_events(a, &(b)), (b))))
+#ifdef GGTP_RENDER_THREAD
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw(_ggt_platform_acquire_snapshot(&ggt_globals.snapshots)))
+#else
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw(ggt_globals.program_state))
+#endif
+#else
+#ifdef GGTP_MEMORY
+#define GGTP_INIT() ggtp_init(&ggt_platform_memory_state)
+#else
+#define GGTP_INIT() ggtp_init()
+#endif
+#define GGTP_LOOP(a, b) _ggt_platform_end_loop(ggtp_loop(a, (_ggt_platform_frame_events(a, &(b)), (b))))
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw())
+#endif
+    
+    
+    struct {
+#ifdef GGTP_PROGRAM_STATE
+        GGTP_PROGRAM_STATE *program_state;
+#endif
+        ggt_u8 keys[GGTP_TOTAL_KEYS];
+        ggt_platform_events events;
+#ifdef GGTP_RENDER_THREAD
+        _ggt_platform_snapshots snapshots;
+#endif
+        
+        ggt_vec2i last_mouse_position;
+        int paused;
+    } ggt_globals;
+    
+    EM_JS(int, window_width, (), {
+          return window.innerWidth;
+          });
+    
+    EM_JS(int, window_height, (), {
+          return window.innerHeight;
+          });
+    
+    EM_BOOL key_callback(int eventType, const EmscriptenKeyboardEvent *e, void *userData)
+    {
+        char key = (char)e->keyCode;
+        if(key == 16)
+            key = GGTP_KEY_SHIFT;
+        
+        if(eventType == EMSCRIPTEN_EVENT_KEYUP){
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_KEY_UP, key, key);
+        }else{
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_KEY_DOWN, key, key);
+        }
+        
+        return 0;
+    }
+    
+    EM_BOOL mouse_callback(int eventType, const EmscriptenMouseEvent *e, void *userData){
+        ggt_vec2i position = {e->canvasX, e->canvasY};
+        switch(eventType){
+            case EMSCRIPTEN_EVENT_MOUSEDOWN:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_DOWN, coords, position);
+            break;
+            case EMSCRIPTEN_EVENT_MOUSEUP:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_UP, coords, position);
+            break;
+            case EMSCRIPTEN_EVENT_MOUSEMOVE:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_MOVE, mouse_movement, {position.x, position.y, position.x - ggt_globals.last_mouse_position.x, position.y - ggt_globals.last_mouse_position.y});
+            break;
+        }
+        ggt_globals.last_mouse_position = {e->canvasX, e->canvasY};
+        
+        return 0;
+    }
+    
+    
+    EM_BOOL resize_callback(int eventType, const EmscriptenUiEvent *e, void *userData){
+        if(eventType == EMSCRIPTEN_EVENT_RESIZE){
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_RESIZE, size, {e->windowInnerWidth, e->windowInnerHeight});
+            emscripten_set_canvas_element_size("canvas", e->windowInnerWidth, e->windowInnerHeight);
+        }
+        
+        return 0;
+    }
+    
+    void ggtp_set_cursor(ggt_platform_cursor cursor){
+    }
+    
+    void _ggt_platform_apply_frame_pacing(void){
+        // The browser decides when to present, we can only pick how frames are scheduled
+        if(ggt_platform_pacing_state.pacing == GGTP_PACING_LIMITED)
+            emscripten_set_main_loop_timing(EM_TIMING_SETTIMEOUT, 1000 / ggt_platform_pacing_state.target_hz);
+        else if(ggt_platform_pacing_state.pacing == GGTP_PACING_UNCAPPED)
+            emscripten_set_main_loop_timing(EM_TIMING_SETTIMEOUT, 0);
+        else
+            emscripten_set_main_loop_timing(EM_TIMING_RAF, 1);
+    }
+    
+    void _ggt_platform_wake(void){
+        if(ggt_globals.paused){
+            ggt_globals.paused = 0;
+            emscripten_resume_main_loop();
+        }
+    }
+    
+    void _ggt_platform_wake_callback(void *data){
+        _ggt_platform_wake();
+    }
+    
+    void _ggt_platform_wait_for_redraw(void){
+        // We can't block the browser, so stop the main loop until something happens
+        int timeout = _ggt_platform_redraw_timeout();
+        if(timeout != 0 && ggt_globals.events.size == 0){
+            ggt_globals.paused = 1;
+            emscripten_pause_main_loop();
+            if(timeout > 0)
+                emscripten_async_call(_ggt_platform_wake_callback, NULL, timeout);
+        }
+    }
+    
+    void main_loop(){
+        _ggt_platform_begin_frame();
+        
+        int result = GGTP_LOOP(ggt_globals.keys, ggt_globals.events);
+        ggt_globals.events.size = 0;
+        
+        if(!_ggt_platform_should_draw(result)){
+            _ggt_platform_wait_for_redraw();
+            return;
+        }
+        
+#ifdef GGTP_RENDER_THREAD
+        // No threads here, but ggtp_draw still expects a snapshot
+        _ggt_platform_publish_snapshot(&ggt_globals.snapshots, ggt_globals.program_state);
+#endif
+        GGTP_DRAW();
+        
+        // The browser presents when this returns
+        _ggt_platform_before_swap();
+        _ggt_platform_after_swap();
+    }
+    
+    int ggtp_create_window(int width, int height, const char *window_name){
+        return GGT_SUCCESS;
+    }
+    
+    int main(void) {
+        emscripten_set_mousedown_callback("#canvas", 0, 1, mouse_callback);
+        emscripten_set_mouseup_callback("#canvas", 0, 1, mouse_callback);
+        emscripten_set_mousemove_callback("#canvas", 0, 1, mouse_callback);
+        emscripten_set_resize_callback("#window", 0, 1, resize_callback);
+        emscripten_set_keydown_callback("#document", 0, 1, key_callback);
+        emscripten_set_keyup_callback("#document", 0, 1, key_callback);
+        
+        int width = window_width();
+        int height = window_height();
+        emscripten_set_canvas_element_size("canvas", width, height);
+        
+        EmscriptenWebGLContextAttributes attrs;
+        emscripten_webgl_init_context_attributes(&attrs);
+        attrs.alpha = 8;
+        attrs.depth = 24;
+        attrs.stencil = 8;
+        attrs.antialias = true;
+        attrs.premultipliedAlpha = false;
+        EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx = emscripten_webgl_create_context(NULL, &attrs);
+        if(ctx != NULL)
+            printf("Failed to create WebGL context");
+        emscripten_webgl_make_context_current(ctx);
+        
+        for(int i=0; i<GGTP_TOTAL_KEYS; i++)
+            ggt_globals.keys[i] = 0;
+        ggt_globals.events.size = 0;
+        
+#ifdef GGTP_MEMORY
+        if(_ggt_platform_init_memory() == GGT_FAILURE)
+            return GGT_C_FAILURE;
+#ifdef GGTP_PROGRAM_STATE
+        ggt_globals.program_state = ggtp_arena_push_struct(&ggt_platform_memory_state.permanent, GGTP_PROGRAM_STATE);
+#endif
+#elif defined(GGTP_PROGRAM_STATE)
+        // main returns once the loop is set up, so the state can't be a local
+        static GGTP_PROGRAM_STATE program_state;
+        ggt_globals.program_state = &program_state;
+#endif
+        
+        GGTP_INIT();
+#ifdef GGTP_RENDER_THREAD
+        _ggt_platform_init_snapshots(&ggt_globals.snapshots, ggt_globals.program_state);
+#endif
+        
+        GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_RESIZE, size, {width, height});
+        
+        // The loop timing can only be changed once the loop is set, so the
+        // first frame applies the pacing (GGTP_DEFAULT_PACING or whatever
+        // ggtp_init asked for)
+        GGTP_ATOMIC_STORE(&ggt_platform_pacing_state.changed, 1);
+        emscripten_set_main_loop(main_loop, 0, 1);
+        
+        return 0;
+    }
+    
+    void ggtp_program_file_path(const char *name, char *dst){
+        sprintf(dst, "../run_tree/%s", name);
+    }
+    void ggtp_user_file_path(const char *name, char *dst){
+        sprintf(dst, "../run_tree/%s", name);
+    }
+    
+    ggt_u64 ggtp_file_modification_date(const char *path){
+        return 0;
+    }
+    
+    ggt_watch ggtp_watch(const char *directory, int recursive){
+        printf("ggtp_watch error: Not supported in the browser\n");
+        return 0;
+    }
+    
+    void ggtp_unwatch(ggt_watch watch){
+    }
+    
+    void _ggt_platform_poll_watches(void){
+    }
+    
+    int _ggt_platform_start_file_io(void){
+        return GGT_SUCCESS; // Reads happen right before ggtp_loop
+    }
+    
+    const ggt_u8 *_ggt_platform_map_file(const char *path, ggt_u64 *size, void **handle){
+        return _ggt_platform_read_whole_file(path, size);
+    }
+    
+    void _ggt_platform_unmap_file(const ggt_u8 *data, ggt_u64 size, void *handle){
+        free((void *)data);
+    }
+    
+    void _ggt_platform_kick_file_io(void){
+    }
+    
+    void _ggt_platform_stop_file_io(void){
+    }
+    
+    ggt_u64 ggtp_time_microseconds(void){
+        return (ggt_u64)(emscripten_get_now() * 1000.0);
+    }
+    
+    ggt_thread ggtp_create_thread(ggt_thread_function *function, void *data, const char *name){
+        return NULL;
+    }
+    
+    int ggtp_wait_thread(ggt_thread thread){
+        return 0;
+    }
+    
+    void ggtp_sleep_microseconds(ggt_u64 microseconds){
+        // The browser thread can't block, so just spin
+        ggt_u64 end = ggtp_time_microseconds() + microseconds;
+        while(ggtp_time_microseconds() < end);
+    }
+    
+    int _ggt_platform_reserve_memory(ggt_arena *arena, ggt_u64 size, int huge_pages){
+        void *memory = calloc(1, (size_t)size);
+        if(!memory)
+            return GGT_FAILURE;
+        arena->base = (ggt_u8 *)memory;
+        arena->reserved = arena->committed = size;
+        return GGT_SUCCESS;
+    }
+    
+    int _ggt_platform_commit_memory(void *address, ggt_u64 size){
+        return GGT_SUCCESS;
+    }
+    
+    void _ggt_platform_release_memory(ggt_arena *arena){
+        free(arena->base);
+    }
+    
+    // Without threads a semaphore is just a counter that can't be waited on
+    ggt_semaphore ggtp_create_semaphore(ggt_u32 initial_count){
+        ggt_u32 *count = (ggt_u32 *)malloc(sizeof(ggt_u32));
+        *count = initial_count;
+        return (ggt_semaphore)count;
+    }
+    
+    void ggtp_destroy_semaphore(ggt_semaphore semaphore){
+        free(semaphore);
+    }
+    
+    void ggtp_semaphore_post(ggt_semaphore semaphore){
+        (*(ggt_u32 *)semaphore)++;
+    }
+    
+    int ggtp_semaphore_wait(ggt_semaphore semaphore, int timeout){
+        ggt_u32 *count = (ggt_u32 *)semaphore;
+        if(*count == 0)
+            return GGT_FAILURE;
+        (*count)--;
+        return GGT_SUCCESS;
+    }
+    
+    int ggtp_thread_set_affinity(ggt_u64 core_mask){
+        return GGT_FAILURE;
+    }
+    
+    int ggtp_thread_set_priority(ggt_platform_priority priority){
+        return GGT_FAILURE;
+    }
+    
+    void _ggt_platform_detect_topology(ggt_system_info *info){
+        info->logical_cores = (ggt_u32)emscripten_num_logical_cores();
+    }
+    
+    // Web Audio, with a ScriptProcessorNode that calls back into the mixer on
+    // the browser thread, the one that runs ggtp_loop too. Its buffers are
+    // a power of two from 256 to 16384 frames
+    struct {
+        float *samples;
+        ggt_u32 frames;
+    } ggt_platform_web_audio;
+    
+    EMSCRIPTEN_KEEPALIVE void _ggt_platform_web_audio_mix(int frames){
+        _ggt_platform_mix_audio(ggt_platform_web_audio.samples,
+                                ((ggt_u32)frames < ggt_platform_web_audio.frames) ? (ggt_u32)frames : ggt_platform_web_audio.frames);
+    }
+    
+    // Returns the sample rate of the context or 0
+    EM_JS(int, _ggt_platform_web_audio_open, (int sample_rate, int buffer_frames, float *samples), {
+          var AudioContext = window.AudioContext || window.webkitAudioContext;
+          if(!AudioContext)
+              return 0;
+          var context;
+          try{
+              context = new AudioContext({sampleRate: sample_rate});
+          }catch(error){
+              context = new AudioContext();
+          }
+          var node = context.createScriptProcessor(buffer_frames, 0, 2);
+          node.onaudioprocess = function(event){
+              var left = event.outputBuffer.getChannelData(0);
+              var right = event.outputBuffer.getChannelData(1);
+              var frames = Math.min(left.length, buffer_frames);
+              __ggt_platform_web_audio_mix(frames);
+              // Read after mixing, the heap may have grown
+              var mixed = HEAPF32.subarray(samples >> 2, (samples >> 2) + 2 * frames);
+              for(var i = 0; i < frames; i++){
+                  left[i] = mixed[2 * i];
+                  right[i] = mixed[2 * i + 1];
+              }
+          };
+          node.connect(context.destination);
+          // Browsers keep audio suspended until the page gets a gesture
+          var resume = function(){
+              if(context.state != "running")
+                  context.resume();
+          };
+          ["mousedown", "keydown", "touchstart"].forEach(function(type){
+              window.addEventListener(type, resume);
+          });
+          Module.ggtp_web_audio = {context: context, node: node, resume: resume};
+          return context.sampleRate;
+          });
+    
+    EM_JS(void, _ggt_platform_web_audio_close, (), {
+          var audio = Module.ggtp_web_audio;
+          if(!audio)
+              return;
+          audio.node.onaudioprocess = null;
+          audio.node.disconnect();
+          ["mousedown", "keydown", "touchstart"].forEach(function(type){
+              window.removeEventListener(type, audio.resume);
+          });
+          audio.context.close();
+          Module.ggtp_web_audio = null;
+          });
+    
+    int _ggt_platform_open_audio(ggt_u32 *sample_rate, ggt_u32 buffer_frames){
+        ggt_u32 frames = 256;
+        while(frames < buffer_frames && frames < 16384)
+            frames *= 2;
+        
+        ggt_platform_web_audio.samples = (float *)calloc(frames * 2, sizeof(float));
+        if(!ggt_platform_web_audio.samples){
+            printf("ggtp_audio_start error: Couldn't allocate the mixing buffer\n");
+            return GGT_FAILURE;
         }
-        ggt_globals.hWnd = CreateWindow(GGT_PLATFORM_WINDOW_CLASS_NAME, window_name, WS_OVERLAPPEDWINDOW | WS_VISIBLE, actualSize.left, actualSize.top, actualSize.right - actualSize.left, actualSize.bottom - actualSize.top, NULL, NULL, ggt_globals.hInstance, NULL);
+        ggt_platform_web_audio.frames = frames;
         
-        if(!ggt_globals.hWnd){
-            GGT_PLATFORM_ALERT_ERROR("Cannot create window.", "1");
+        int rate = _ggt_platform_web_audio_open((int)*sample_rate, (int)frames, ggt_platform_web_audio.samples);
+        if(!rate){
+            printf("ggtp_audio_start error: Web Audio isn't available\n");
+            free(ggt_platform_web_audio.samples);
+            ggt_platform_web_audio.samples = NULL;
+            return GGT_FAILURE;
+        }
+        *sample_rate = (ggt_u32)rate;
+        return GGT_SUCCESS;
+    }
+    
+    void _ggt_platform_close_audio(void){
+        _ggt_platform_web_audio_close();
+        free(ggt_platform_web_audio.samples);
+        ggt_platform_web_audio.samples = NULL;
+    }
+    
+#else // linux, etc.
+    //
+    // SDL implementation
+    //
+    
+#include <SDL2/SDL.h>
+#include <time.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+    
+#if defined(__linux__) && !defined(GGTP_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define _GGTP_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+#endif
+    
+#ifdef GGTP_PROGRAM_STATE
+#ifdef GGTP_MEMORY
+#define GGTP_INIT() ggtp_init(ggt_globals.program_state, &ggt_platform_memory_state)
+#else
+#define GGTP_INIT() ggtp_init(ggt_globals.program_state)
+#endif
+#define GGTP_LOOP(a, b) _ggt_platform_end_loop(ggtp_loop(ggt_globals.program_state, a, (_ggt_platform_frame_events(a, &(b)), (b))))
+#ifdef GGTP_RENDER_THREAD
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw(_ggt_platform_acquire_snapshot(&ggt_globals.snapshots)))
+#else
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw(ggt_globals.program_state))
+#endif
+#else
+#ifdef GGTP_MEMORY
+#define GGTP_INIT() ggtp_init(&ggt_platform_memory_state)
+#else
+#define GGTP_INIT() ggtp_init()
+#endif
+#define GGTP_LOOP(a, b) _ggt_platform_end_loop(ggtp_loop(a, (_ggt_platform_frame_events(a, &(b)), (b))))
+#define GGTP_DRAW() (_ggt_platform_begin_draw(), ggtp_draw())
+#endif
+    
+    struct {
+        ggt_platform_events events;
+        ggt_u8 keys[GGTP_TOTAL_KEYS];
+        ggt_vec2i last_mouse_position;
+#ifdef GGTP_PROGRAM_STATE
+        GGTP_PROGRAM_STATE *program_state;
+#endif
+#ifdef _GGTP_EVENT_RING
+        _ggt_platform_event_ring event_ring;
+        ggt_u32 running;
+#endif
+#ifdef GGTP_RENDER_THREAD
+        _ggt_platform_snapshots snapshots;
+#endif
+        
+        SDL_Window *window;
+        SDL_GLContext gl_context;
+#ifdef GGTP_LOADER_CONTEXT
+        SDL_GLContext loader_context;
+#endif
+        Uint32 wake_event;
+#ifdef GGTP_INPUT_THREAD
+        ggt_semaphore wake;
+#endif
+    } ggt_globals;
+    
+    void _ggt_platform_apply_frame_pacing(void){
+        int interval = _ggt_platform_swap_interval();
+        if(SDL_GL_SetSwapInterval(interval) < 0 && interval == -1)
+            SDL_GL_SetSwapInterval(1); // No late swap tearing, fall back to vsync
+    }
+    
+    void _ggt_platform_wake(void){
+#ifdef GGTP_INPUT_THREAD
+        ggtp_semaphore_post(ggt_globals.wake);
+#else
+        if(ggt_globals.wake_event){
+            SDL_Event e;
+            SDL_memset(&e, 0, sizeof(e));
+            e.type = ggt_globals.wake_event;
+            SDL_PushEvent(&e);
+        }
+#endif
+    }
+    
+    int ggtp_create_window(int width, int height, const char *window_name){
+        if(SDL_Init(SDL_INIT_VIDEO) < 0){
+            printf("Failed to init SDL\n");
             return GGT_FAILURE;
         }
         
-        ggt_globals.hDC = GetDC(ggt_globals.hWnd);
-        PIXELFORMATDESCRIPTOR pfd;
-        pfd.nSize = sizeof(PIXELFORMATDESCRIPTOR);
-        pfd.nVersion = 1;
-        pfd.iLayerType = PFD_MAIN_PLANE;
-        pfd.dwFlags = PFD_SUPPORT_OPENGL | PFD_DRAW_TO_WINDOW | PFD_DOUBLEBUFFER;
-        pfd.cDepthBits = 24;
-        pfd.cColorBits = 24;
-        pfd.iPixelType = PFD_TYPE_RGBA;
+        ggt_globals.window = SDL_CreateWindow(window_name, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
         
-        int PixelFormat = ChoosePixelFormat(ggt_globals.hDC, &pfd);
-        if (!SetPixelFormat(ggt_globals.hDC, PixelFormat, &pfd)) {
-            GGT_PLATFORM_ALERT_ERROR("Cannot set pixel format.", "2");
+        if(!ggt_globals.window){
+            printf("Unable to create window\n");
             return GGT_FAILURE;
         }
         
-        int attriblist[] = {
-            WGL_CONTEXT_MAJOR_VERSION_ARB, 2,
-            WGL_CONTEXT_MINOR_VERSION_ARB, 1,
-            0
-        };
+        ggt_globals.gl_context = SDL_GL_CreateContext(ggt_globals.window);
         
-        HGLRC hRCtmp = wglCreateContext(ggt_globals.hDC);
-        wglMakeCurrent(ggt_globals.hDC, hRCtmp);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
         
+        SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+        SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
+        SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
+        SDL_GL_SetAttribute(SDL_GL_ACCUM_RED_SIZE, 4);
+        SDL_GL_SetAttribute(SDL_GL_ACCUM_GREEN_SIZE, 4);
+        SDL_GL_SetAttribute(SDL_GL_ACCUM_BLUE_SIZE, 4);
+        SDL_GL_SetAttribute(SDL_GL_ACCUM_ALPHA_SIZE, 4);
         
-        PFNWGLCREATECONTEXTATTRIBSARBPROC wglCreateContextAttribsARB =
-            (PFNWGLCREATECONTEXTATTRIBSARBPROC)wglGetProcAddress("wglCreateContextAttribsARB");
-        ggt_globals.hRC = wglCreateContextAttribsARB(ggt_globals.hDC, 0, attriblist);
+        SDL_DisplayMode display_mode;
+        if(SDL_GetWindowDisplayMode(ggt_globals.window, &display_mode) == 0 && display_mode.refresh_rate > 0)
+            ggt_platform_pacing_state.refresh_period = 1000000 / display_mode.refresh_rate;
+        _ggt_platform_apply_frame_pacing();
         
-        PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT =
-            (PFNWGLSWAPINTERVALEXTPROC)wglGetProcAddress("wglSwapIntervalEXT");
-        if (wglSwapIntervalEXT) {
-            wglSwapIntervalEXT(1);
-        } else {
-            printf("Error: Could not find 'wglSwapIntervalEXT'\n");
-        }
+        // Pushed to wake up a thread waiting for events in on-demand redraw mode
+        ggt_globals.wake_event = SDL_RegisterEvents(1);
         
-        if (!ggt_globals.hRC) {
-            GGT_PLATFORM_ALERT_ERROR("Could not create OpenGL context.", "3");
+        glewExperimental = GL_TRUE;
+        GLenum error = glewInit();
+        if(error != GLEW_OK){
+            printf("Couldn't initialize glew\n");
+            return GGT_FAILURE;
+        }else if(!GLEW_VERSION_2_1){
+            printf("Glew doesn't support openGL 2.1\n");
             return GGT_FAILURE;
         }
         
-        wglMakeCurrent(NULL, NULL);
-        wglDeleteContext(hRCtmp);
-        wglMakeCurrent(ggt_globals.hDC, ggt_globals.hRC);
-        
-#define GL_FUNCTION(TYPE, NAME, ...) NAME = (_ggtp_gl_type_##NAME *)wglGetProcAddress(#NAME);
-        GGTP_GL_FUNCTION_LIST
-#undef GL_FUNCTION
+#ifdef GGTP_LOADER_CONTEXT
+        // Created while the main context is current, so that they share objects
+        SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+        ggt_globals.loader_context = SDL_GL_CreateContext(ggt_globals.window);
+        SDL_GL_MakeCurrent(ggt_globals.window, ggt_globals.gl_context);
+        if(ggt_globals.loader_context){
+            ggt_platform_loader_state.fences = GLEW_VERSION_3_2 || GLEW_ARB_sync;
+            _ggt_platform_start_loader();
+        }else{
+            printf("ggtp_create_window error: Couldn't create the loader context, GL jobs will run between frames: %s\n", SDL_GetError());
+        }
+#endif
         
-            return GGT_SUCCESS;
+        return GGT_SUCCESS;
+    }
+    
+    void _ggt_platform_handle_sdl_event(SDL_Event *e){
+        switch(e->type){
+            case SDL_KEYDOWN: {
+                //e->key.keysym.scancode;
+            }   break;
+            
+            case SDL_KEYUP: {
+            }   break;
+            
+            case SDL_MOUSEBUTTONDOWN:
+            if(e->button.button == SDL_BUTTON_LEFT)
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_DOWN, coords, {e->button.x, e->button.y});
+            else if(e->button.button == SDL_BUTTON_RIGHT)
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_RIGHT_DOWN, coords, {e->button.x, e->button.y});
+            break;
+            
+            case SDL_MOUSEBUTTONUP:
+            if(e->button.button == SDL_BUTTON_LEFT)
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_UP, coords, {e->button.x, e->button.y});
+            else if(e->button.button == SDL_BUTTON_RIGHT)
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_RIGHT_UP, coords, {e->button.x, e->button.y});
+            break;
+            
+            case SDL_MOUSEMOTION:
+            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_MOVE, mouse_movement, {{e->motion.x, e->motion.y}, {e->motion.xrel, e->motion.yrel}});
+            break;
+            
+            case SDL_WINDOWEVENT:
+            switch(e->window.event){
+                case SDL_WINDOWEVENT_RESIZED:
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_RESIZE, size, {e->window.data1, e->window.data2});
+                break;
+                
+                case SDL_WINDOWEVENT_CLOSE:
+                GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_CLOSE, key, 0);
+                break;
+                
+                //case SDL_WINDOWEVENT_FOCUS_LOST:
+                //
+                //break;
+            }
+            break;
+            
+            default:
+            break;
+        }
+    }
+    
+#ifdef _GGTP_EVENT_RING
+    // Ends the frame loops, waking up the threads that may be waiting
+    void _ggt_platform_stop(void){
+        GGTP_ATOMIC_STORE(&ggt_globals.running, 0);
+        _ggt_platform_wake();
+        _ggt_platform_wake_simulation();
+        if(ggt_globals.wake_event){
+            SDL_Event e;
+            SDL_memset(&e, 0, sizeof(e));
+            e.type = ggt_globals.wake_event;
+            SDL_PushEvent(&e);
+        }
     }
+#endif
     
+    void _ggt_platform_wait_for_redraw(void){
+#ifdef GGTP_INPUT_THREAD
+        // Input reaches this thread through the ring, which posts ggt_globals.wake
+        while(ggtp_semaphore_wait(ggt_globals.wake, 0) == GGT_SUCCESS);
+#ifndef GGTP_RENDER_THREAD
+        if(!_ggt_platform_ring_empty(&ggt_globals.event_ring))
+            return;
+#endif
+        int timeout = _ggt_platform_redraw_timeout();
+        if(timeout != 0)
+            ggtp_semaphore_wait(ggt_globals.wake, timeout);
+#else
+        SDL_Event e;
+        int timeout = _ggt_platform_redraw_timeout();
+        if(timeout < 0){
+            if(SDL_WaitEvent(&e))
+                _ggt_platform_handle_sdl_event(&e);
+        }else if(timeout > 0){
+            if(SDL_WaitEventTimeout(&e, timeout))
+                _ggt_platform_handle_sdl_event(&e);
+        }
+#endif
+    }
     
-    int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevious, LPSTR lpCmdLine, int nCmdShow){
-        ggt_globals.events.size = 0;
+#ifdef GGTP_INPUT_THREAD
+    int _ggt_platform_gl_thread(void *data){
+        SDL_GL_MakeCurrent(ggt_globals.window, ggt_globals.gl_context);
         
-        // We register the window class
-        WNDCLASS wc;
-        wc.cbClsExtra = 0;
-        wc.cbWndExtra = 0;
-        wc.hbrBackground = (HBRUSH)GetStockObject(LTGRAY_BRUSH);
-        wc.hCursor = LoadCursor(hInstance, IDC_ARROW);
-        wc.hIcon = LoadIcon(hInstance, IDI_APPLICATION);
-        wc.lpfnWndProc = WndProc;
-        wc.lpszClassName = GGT_PLATFORM_WINDOW_CLASS_NAME;
-        wc.lpszMenuName = NULL;
-        wc.style = CS_VREDRAW | CS_HREDRAW;
-        wc.hInstance = hInstance;
-        if(!RegisterClass(&wc)){
-            GGT_PLATFORM_ALERT_ERROR("Cannot register window.", "0");
-            return GGT_C_FAILURE;
+        while(GGTP_ATOMIC_LOAD(&ggt_globals.running)){
+            _ggt_platform_begin_frame();
+            
+#ifdef GGTP_RENDER_THREAD
+            // ggtp_loop runs on the simulation thread, only draw what it publishes
+            if(!_ggt_platform_snapshot_ready(&ggt_globals.snapshots) && !_ggt_platform_should_draw(GGTP_NO_REDRAW)){
+                _ggt_platform_wait_for_redraw();
+                continue;
+            }
+#else
+            ggt_platform_events events;
+            _ggt_platform_drain_event_ring(&ggt_globals.event_ring, &events, ggt_globals.keys);
+            
+            int result = GGTP_LOOP(ggt_globals.keys, events);
+            if(result == GGT_FAILURE)
+                break;
+            
+            if(!_ggt_platform_should_draw(result)){
+                _ggt_platform_wait_for_redraw();
+                continue;
+            }
+#endif
+            
+            GGTP_DRAW();
+            _ggt_platform_before_swap();
+            SDL_GL_SwapWindow(ggt_globals.window);
+            _ggt_platform_after_swap();
         }
         
-        ggt_globals.hInstance = hInstance;
+        SDL_GL_MakeCurrent(ggt_globals.window, NULL);
+        _ggt_platform_stop();
+        return 0;
+    }
+#endif
+    
+    int _ggt_platform_main(void){
+#ifdef GGTP_HOT_RELOAD
+        if(_ggt_platform_load_code() == GGT_FAILURE){
+            printf("Couldn't load the GGTP_HOT_RELOAD library.\n");
+            return GGT_C_FAILURE;
+        }
+#endif
         
+#ifdef GGTP_MEMORY
+        if(_ggt_platform_init_memory() == GGT_FAILURE){
+            printf("Couldn't reserve memory.\n");
+            return GGT_C_FAILURE;
+        }
 #ifdef GGTP_PROGRAM_STATE
-        //GGTP_PROGRAM_STATE* program_state = (GGTP_PROGRAM_STATE *)malloc(sizeof(GGTP_PROGRAM_STATE));
+        ggt_globals.program_state = ggtp_arena_push_struct(&ggt_platform_memory_state.permanent, GGTP_PROGRAM_STATE);
+#endif
+#elif defined(GGTP_PROGRAM_STATE)
         GGTP_PROGRAM_STATE program_state;
+        ggt_globals.program_state = &program_state;
 #endif
         
-        if(GGTP_INIT() == GGT_FAILURE)
+        if(GGTP_INIT() == GGT_FAILURE){
             return GGT_C_FAILURE;
+        }
         
-        if(!ggt_globals.hWnd){
-            GGT_PLATFORM_ALERT_ERROR("Window was not created in ggtp_init().", "4");
+        if(!ggt_globals.window){
+            printf("Window was not created in ggtp_init().\n");
             return GGT_C_FAILURE;
         }
         
@@ -559,390 +5028,915 @@ extern "C" {
         }
         ggt_globals.events.size = 0;
         
-        MSG msg;
-        while (1){
-            while (PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE)){
-                if (!GetMessage(&msg, NULL, 0, 0)){
-                    break;
-                }
-                DispatchMessage(&msg);
-                TranslateMessage(&msg);
+#ifdef _GGTP_EVENT_RING
+        GGTP_ATOMIC_STORE(&ggt_globals.running, 1);
+        
+#ifdef GGTP_RENDER_THREAD
+        _ggt_platform_init_snapshots(&ggt_globals.snapshots, ggt_globals.program_state);
+        _ggt_platform_simulation_semaphore = ggtp_create_semaphore(0);
+        ggt_thread simulation_thread = ggtp_create_thread(_ggt_platform_simulation_thread, NULL, "ggtp_simulation");
+        if(!simulation_thread){
+            printf("Couldn't create the simulation thread\n");
+            return GGT_C_FAILURE;
+        }
+#endif
+        
+        SDL_Event e;
+#ifdef GGTP_INPUT_THREAD
+        // SDL wants events pumped on the thread that created the window, so
+        // the context moves to its own thread and this one only handles input
+        ggt_globals.wake = ggtp_create_semaphore(0);
+        SDL_GL_MakeCurrent(ggt_globals.window, NULL);
+        ggt_thread gl_thread = ggtp_create_thread(_ggt_platform_gl_thread, NULL, "ggtp_gl");
+        if(!gl_thread){
+            printf("Couldn't create the OpenGL thread\n");
+            return GGT_C_FAILURE;
+        }
+        
+        while(GGTP_ATOMIC_LOAD(&ggt_globals.running)){
+            // Sleep until there is new input, only polling while key events
+            // wait for room in the ring
+            int got_event = ggt_globals.event_ring.stashed_count ? SDL_WaitEventTimeout(&e, 1000 / GGTP_INPUT_THREAD_HZ) : SDL_WaitEvent(&e);
+            if(got_event){
+                _ggt_platform_handle_sdl_event(&e);
+                while(SDL_PollEvent(&e))
+                    _ggt_platform_handle_sdl_event(&e);
+            }
+            if(ggt_globals.event_ring.stashed_count > 0 && _ggt_platform_ring_flush(&ggt_globals.event_ring) == GGT_SUCCESS)
+                _ggt_platform_wake();
+        }
+        
+        ggtp_wait_thread(gl_thread);
+#else
+        // Pump events and draw the newest snapshot here
+        while(GGTP_ATOMIC_LOAD(&ggt_globals.running)){
+            _ggt_platform_begin_frame();
+            
+            while(SDL_PollEvent(&e))
+                _ggt_platform_handle_sdl_event(&e);
+            if(ggt_globals.event_ring.stashed_count > 0)
+                _ggt_platform_ring_flush(&ggt_globals.event_ring);
+            
+            if(!_ggt_platform_snapshot_ready(&ggt_globals.snapshots) && !_ggt_platform_should_draw(GGTP_NO_REDRAW)){
+                _ggt_platform_wait_for_redraw();
+                continue;
             }
             
+            GGTP_DRAW();
+            _ggt_platform_before_swap();
+            SDL_GL_SwapWindow(ggt_globals.window);
+            _ggt_platform_after_swap();
+        }
+#endif
+        
+#ifdef GGTP_RENDER_THREAD
+        ggtp_wait_thread(simulation_thread);
+#endif
+#ifdef GGTP_LOADER_CONTEXT
+        _ggt_platform_stop_loader();
+        if(ggt_globals.loader_context)
+            SDL_GL_DeleteContext(ggt_globals.loader_context);
+#endif
+        SDL_GL_DeleteContext(ggt_globals.gl_context);
+        SDL_DestroyWindow(ggt_globals.window);
+        SDL_Quit();
+        return GGT_C_SUCCESS;
+#else
+        while(1){
+            _ggt_platform_begin_frame();
+            
+            SDL_Event e;
+            while(SDL_PollEvent(&e))
+                _ggt_platform_handle_sdl_event(&e);
+            
+            
             ggt_platform_events events;
             events.size = ggt_globals.events.size;
             for(ggt_u32 i=0; i<events.size; i++)
                 events.data[i] = ggt_globals.events.data[i];
             ggt_globals.events.size = 0;
             
-            if(GGTP_LOOP(ggt_globals.keys, events) == GGT_FAILURE){
+            int result = GGTP_LOOP(ggt_globals.keys, events);
+            if(result == GGT_FAILURE){
                 // Exit the program
-                wglMakeCurrent(NULL, NULL);
-                wglDeleteContext(ggt_globals.hRC);
-                ReleaseDC(ggt_globals.hWnd, ggt_globals.hDC);
+#ifdef GGTP_LOADER_CONTEXT
+                _ggt_platform_stop_loader();
+                if(ggt_globals.loader_context)
+                    SDL_GL_DeleteContext(ggt_globals.loader_context);
+#endif
+                SDL_GL_DeleteContext(ggt_globals.gl_context);
+                SDL_DestroyWindow(ggt_globals.window);
+                SDL_Quit();
                 return GGT_C_SUCCESS;
             }
             
-            GGTP_DRAW();
+            if(!_ggt_platform_should_draw(result)){
+                _ggt_platform_wait_for_redraw();
+                continue;
+            }
             
-            SwapBuffers(ggt_globals.hDC);
+            GGTP_DRAW();
+            _ggt_platform_before_swap();
+            SDL_GL_SwapWindow(ggt_globals.window);
+            _ggt_platform_after_swap();
         }
         
         return GGT_C_SUCCESS;
+#endif
     }
     
-    void ggtp_set_cursor(ggt_platform_cursor cursor_id) {
-        LPCTSTR win_cursor = IDC_ARROW;
-        switch (cursor_id) {
-            case GGTP_CURSOR_ARROW:
-            win_cursor = IDC_ARROW;
-            break;
-            case GGTP_CURSOR_POINTER:
-            win_cursor = IDC_HAND;
-            break;
-            case GGTP_CURSOR_WAIT:
-            win_cursor = IDC_WAIT;
-            break;
-            case GGTP_CURSOR_WRITE:
-            win_cursor = IDC_IBEAM;
-            break;
-        }
-        HCURSOR cursor = (HCURSOR)LoadImageA(NULL, win_cursor, IMAGE_CURSOR, 0, 0, LR_DEFAULTSIZE | LR_DEFAULTCOLOR | LR_SHARED);
-        SetCursor(cursor);
+    int main(){
+        int result = _ggt_platform_main();
+        _ggt_platform_stop_file_io();
+        return result;
+    }
+    
+    void ggtp_set_cursor(ggt_platform_cursor cursor_id){
+        
     }
     
+    
     void ggtp_program_file_path(const char *name, char *dst){
-        sprintf(dst, "%s", name);
+        sprintf(dst, "../run_tree/%s", name);
     }
     void ggtp_user_file_path(const char *name, char *dst){
-        sprintf(dst, "%s", name);
+        sprintf(dst, "../run_tree/%s", name);
     }
     
-#include <sys/types.h>
-#include <sys/stat.h>
-    //#include <unistd.h>
     ggt_u64 ggtp_file_modification_date(const char *path){
-        struct _stat result;
-        if(_stat(path, &result) == 0)
-            return result.st_mtime;
+#if defined(__unix__) || defined(__APPLE__)
+        struct stat result;
+        if(stat(path, &result) == 0){
+#ifdef __APPLE__
+            return (ggt_u64)result.st_mtimespec.tv_sec * 1000000000ull + (ggt_u64)result.st_mtimespec.tv_nsec;
+#else
+            return (ggt_u64)result.st_mtim.tv_sec * 1000000000ull + (ggt_u64)result.st_mtim.tv_nsec;
+#endif
+        }
+#endif
         return 0;
     }
     
-#elif defined(__EMSCRIPTEN__)
+#ifdef __linux__
+#ifndef GGTP_MAX_WATCHED_DIRECTORIES
+#define GGTP_MAX_WATCHED_DIRECTORIES 4096
+#endif
     
-#include <emscripten.h>
-#include <emscripten/html5.h>
+    // inotify isn't recursive, so every subdirectory gets its own descriptor
+    typedef struct {
+        int descriptor; // -1 if unused
+        ggt_watch watch;
+        int recursive;
+        char *path;
+    } _ggt_platform_watched_directory;
     
-#ifdef GGTP_PROGRAM_STATE
-#define GGTP_INIT() ggtp_init(&ggt_globals.program_state)
-#define GGTP_LOOP(a, b) ggtp_loop(&ggt_globals.program_state, a, b)
-#define GGTP_DRAW() ggtp_draw(&ggt_globals.program_state)
+    struct {
+        int inotify;
+        ggt_watch last_watch;
+        int directory_count; // Used slots, some may be free again
+        _ggt_platform_watched_directory directories[GGTP_MAX_WATCHED_DIRECTORIES];
+    } ggt_platform_inotify = {-1};
+    
+    const ggt_u32 _GGTP_INOTIFY_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+    
+    int _ggt_platform_watch_directory(ggt_watch watch, const char *path, int recursive){
+        int descriptor = inotify_add_watch(ggt_platform_inotify.inotify, path, _GGTP_INOTIFY_MASK);
+        if(descriptor < 0)
+            return GGT_FAILURE;
+        
+        int slot = 0;
+        while(slot < ggt_platform_inotify.directory_count && ggt_platform_inotify.directories[slot].descriptor >= 0)
+            slot++;
+        if(slot == GGTP_MAX_WATCHED_DIRECTORIES){
+            printf("ggtp_watch error: Too many directories, %s isn't watched\n", path);
+            inotify_rm_watch(ggt_platform_inotify.inotify, descriptor);
+            return GGT_FAILURE;
+        }
+        if(slot == ggt_platform_inotify.directory_count)
+            ggt_platform_inotify.directory_count++;
+        
+        _ggt_platform_watched_directory *directory = &ggt_platform_inotify.directories[slot];
+        directory->descriptor = descriptor;
+        directory->watch = watch;
+        directory->recursive = recursive;
+        directory->path = strdup(path);
+        
+        if(recursive){
+            DIR *dir = opendir(path);
+            if(dir){
+                struct dirent *entry;
+                while((entry = readdir(dir))){
+                    if(entry->d_name[0] == '.' && (!entry->d_name[1] || (entry->d_name[1] == '.' && !entry->d_name[2])))
+                        continue;
+                    
+                    char child[_GGTP_PATH_SIZE];
+                    snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+                    struct stat info;
+                    if(entry->d_type == DT_DIR || (entry->d_type == DT_UNKNOWN && stat(child, &info) == 0 && S_ISDIR(info.st_mode)))
+                        _ggt_platform_watch_directory(watch, child, recursive);
+                }
+                closedir(dir);
+            }
+        }
+        return GGT_SUCCESS;
+    }
+    
+    void _ggt_platform_forget_directory(_ggt_platform_watched_directory *directory){
+        free(directory->path);
+        directory->path = NULL;
+        directory->descriptor = -1;
+    }
+    
+    ggt_watch ggtp_watch(const char *directory, int recursive){
+        if(ggt_platform_inotify.inotify < 0){
+            ggt_platform_inotify.inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if(ggt_platform_inotify.inotify < 0){
+                printf("ggtp_watch error: Couldn't initialize inotify\n");
+                return 0;
+            }
+        }
+        
+        char path[_GGTP_PATH_SIZE];
+        ggtp_program_file_path(directory, path);
+        ggt_watch watch = ++ggt_platform_inotify.last_watch;
+        if(_ggt_platform_watch_directory(watch, path, recursive) == GGT_FAILURE){
+            printf("ggtp_watch error: Couldn't watch %s\n", path);
+            return 0;
+        }
+        ggt_platform_watch_state.watches++;
+        return watch;
+    }
+    
+    void ggtp_unwatch(ggt_watch watch){
+        int found = 0;
+        for(int i = 0; i < ggt_platform_inotify.directory_count; i++){
+            _ggt_platform_watched_directory *directory = &ggt_platform_inotify.directories[i];
+            if(directory->descriptor >= 0 && directory->watch == watch){
+                inotify_rm_watch(ggt_platform_inotify.inotify, directory->descriptor);
+                _ggt_platform_forget_directory(directory);
+                found = 1;
+            }
+        }
+        if(found)
+            ggt_platform_watch_state.watches--;
+    }
+    
+    void _ggt_platform_poll_watches(void){
+        char buffer[16 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t size;
+        while((size = read(ggt_platform_inotify.inotify, buffer, sizeof(buffer))) > 0){
+            char *position = buffer;
+            while(position < buffer + size){
+                struct inotify_event *event = (struct inotify_event *)position;
+                position += sizeof(struct inotify_event) + event->len;
+                
+                if(event->mask & IN_Q_OVERFLOW){
+                    printf("ggtp_watch: Too many changes, some were lost\n");
+                    continue;
+                }
+                
+                _ggt_platform_watched_directory *directory = NULL;
+                for(int i = 0; i < ggt_platform_inotify.directory_count; i++){
+                    if(ggt_platform_inotify.directories[i].descriptor == event->wd){
+                        directory = &ggt_platform_inotify.directories[i];
+                        break;
+                    }
+                }
+                if(!directory)
+                    continue;
+                
+                if(event->mask & IN_IGNORED){
+                    // The directory was deleted or unwatched
+                    _ggt_platform_forget_directory(directory);
+                }else if(event->len){
+                    if(!(event->mask & IN_ISDIR)){
+                        _ggt_platform_file_changed(directory->path, event->name, (int)strlen(event->name));
+                    }else if(directory->recursive && (event->mask & (IN_CREATE | IN_MOVED_TO))){
+                        char child[_GGTP_PATH_SIZE];
+                        snprintf(child, sizeof(child), "%s/%s", directory->path, event->name);
+                        _ggt_platform_watch_directory(directory->watch, child, 1);
+                    }
+                }
+            }
+        }
+    }
 #else
-#define GGTP_INIT() ggtp_init()
-#define GGTP_LOOP(a, b) ggtp_loop(a, b)
-#define GGTP_DRAW() ggtp_draw()
+    ggt_watch ggtp_watch(const char *directory, int recursive){
+        printf("ggtp_watch error: Not supported on this platform\n");
+        return 0;
+    }
+    
+    void ggtp_unwatch(ggt_watch watch){
+    }
+    
+    void _ggt_platform_poll_watches(void){
+    }
+#endif
+    
+#ifdef _GGTP_IO_URING
+    //
+    // io_uring file reads, talking to the kernel directly. A single thread
+    // owns the ring: it opens and reads up to GGTP_FILE_QUEUE_DEPTH files at
+    // once, and hears about new requests through a read on an eventfd that is
+    // always queued
+    //
+    
+#define _GGTP_URING_KICK 0xffffffffffffffffull
+    
+    enum {
+        _GGTP_URING_OPENING,
+        _GGTP_URING_READING,
+    };
+    
+    struct {
+        int ring;
+        int eventfd; // -1 once the thread backend takes over
+        ggt_u64 eventfd_value;
+        unsigned to_submit;
+        ggt_thread thread;
+        
+        unsigned *sq_tail, *sq_mask, *sq_array;
+        struct io_uring_sqe *sqes;
+        unsigned *cq_head, *cq_tail, *cq_mask;
+        struct io_uring_cqe *cqes;
+    } ggt_platform_uring = {-1, -1};
+    
+    void _ggt_platform_uring_submit(ggt_u8 opcode, int fd, void *address, ggt_u32 length, ggt_u64 offset, ggt_u64 user_data){
+        unsigned tail = *ggt_platform_uring.sq_tail;
+        unsigned index = tail & *ggt_platform_uring.sq_mask;
+        struct io_uring_sqe *sqe = &ggt_platform_uring.sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = (ggt_u64)(size_t)address;
+        sqe->len = length;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+        if(opcode == IORING_OP_OPENAT)
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        
+        ggt_platform_uring.sq_array[index] = index;
+        GGTP_ATOMIC_STORE(ggt_platform_uring.sq_tail, tail + 1);
+        ggt_platform_uring.to_submit++;
+    }
+    
+    void _ggt_platform_uring_read_next(_ggt_platform_file_request *request, ggt_u64 index){
+        ggt_u64 remaining = request->size - request->done;
+        ggt_u32 length = (remaining > (1u << 30)) ? (1u << 30) : (ggt_u32)remaining;
+        _ggt_platform_uring_submit(IORING_OP_READ, request->fd, (ggt_u8 *)request->dst + request->done, length, request->done, index);
+    }
+    
+    // Returns whether the request is finished
+    int _ggt_platform_uring_complete(_ggt_platform_file_request *request, ggt_u64 index, int result){
+        if(request->stage == _GGTP_URING_OPENING){
+            if(result < 0){
+                _ggt_platform_finish_file_request(request, (result == -ENOENT) ? GGTP_FILE_NOT_FOUND : GGTP_FILE_ERROR, 0);
+                return 1;
+            }
+            
+            request->fd = result;
+            struct stat info;
+            if(fstat(request->fd, &info) != 0){
+                close(request->fd);
+                _ggt_platform_finish_file_request(request, GGTP_FILE_ERROR, 0);
+                return 1;
+            }
+            request->size = (ggt_u64)info.st_size;
+            if(request->size > request->capacity || request->size == 0){
+                close(request->fd);
+                _ggt_platform_finish_file_request(request, request->size ? GGTP_FILE_TOO_BIG : GGTP_FILE_OK, request->size);
+                return 1;
+            }
+            
+            request->stage = _GGTP_URING_READING;
+            _ggt_platform_uring_read_next(request, index);
+            return 0;
+        }
+        
+        if(result < 0){
+            close(request->fd);
+            _ggt_platform_finish_file_request(request, GGTP_FILE_ERROR, request->done);
+            return 1;
+        }
+        request->done += (ggt_u64)result;
+        if(result > 0 && request->done < request->size){
+            _ggt_platform_uring_read_next(request, index); // Short read
+            return 0;
+        }
+        close(request->fd);
+        _ggt_platform_finish_file_request(request, GGTP_FILE_OK, request->done);
+        return 1;
+    }
+    
+    // After an error the ring can't be trusted: what it was working on fails
+    // and the rest goes to the thread backend
+    void _ggt_platform_uring_fall_back(void){
+        for(int i = 0; i < GGTP_MAX_FILE_REQUESTS; i++){
+            _ggt_platform_file_request *request = &ggt_platform_file_state.requests[i];
+            if(GGTP_ATOMIC_LOAD(&request->state) != _GGTP_FILE_READING)
+                continue;
+            if(request->stage == _GGTP_URING_READING)
+                close(request->fd);
+            _ggt_platform_finish_file_request(request, GGTP_FILE_ERROR, 0);
+        }
+        close(ggt_platform_uring.ring);
+        
+        if(_ggt_platform_start_file_threads() == GGT_FAILURE){
+            printf("ggtp_read_file_async error: Couldn't start the file reading threads\n");
+            _ggt_platform_file_request *request;
+            while((request = _ggt_platform_next_file_request()))
+                _ggt_platform_finish_file_request(request, GGTP_FILE_ERROR, 0);
+            return;
+        }
+        // From here on _ggt_platform_kick_file_io posts to the threads, which
+        // also need a post for every request queued so far
+        GGTP_ATOMIC_STORE(&ggt_platform_uring.eventfd, -1);
+        for(int i = 0; i < GGTP_MAX_FILE_REQUESTS; i++){
+            if(GGTP_ATOMIC_LOAD(&ggt_platform_file_state.requests[i].state) == _GGTP_FILE_PENDING)
+                ggtp_semaphore_post(ggt_platform_file_state.work);
+        }
+    }
+    
+    int _ggt_platform_uring_thread(void *data){
+        int in_flight = 0;
+        _ggt_platform_uring_submit(IORING_OP_READ, ggt_platform_uring.eventfd, &ggt_platform_uring.eventfd_value, 8, 0, _GGTP_URING_KICK);
+        
+        while(!GGTP_ATOMIC_LOAD(&ggt_platform_file_state.stopping)){
+            _ggt_platform_file_request *request;
+            while(in_flight < GGTP_FILE_QUEUE_DEPTH && (request = _ggt_platform_next_file_request())){
+                request->stage = _GGTP_URING_OPENING;
+                request->done = 0;
+                _ggt_platform_uring_submit(IORING_OP_OPENAT, AT_FDCWD, request->path, 0, 0, request - ggt_platform_file_state.requests);
+                in_flight++;
+            }
+            
+            int submitted = (int)syscall(__NR_io_uring_enter, ggt_platform_uring.ring, ggt_platform_uring.to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            if(submitted < 0){
+                if(errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                    continue;
+                printf("ggtp_read_file_async error: io_uring_enter failed (%i), falling back to threads\n", errno);
+                _ggt_platform_uring_fall_back();
+                return 1;
+            }
+            ggt_platform_uring.to_submit -= (unsigned)submitted;
+            
+            unsigned head = *ggt_platform_uring.cq_head;
+            unsigned tail = GGTP_ATOMIC_LOAD(ggt_platform_uring.cq_tail);
+            for(; head != tail; head++){
+                struct io_uring_cqe *cqe = &ggt_platform_uring.cqes[head & *ggt_platform_uring.cq_mask];
+                if(cqe->user_data == _GGTP_URING_KICK){
+                    _ggt_platform_uring_submit(IORING_OP_READ, ggt_platform_uring.eventfd, &ggt_platform_uring.eventfd_value, 8, 0, _GGTP_URING_KICK);
+                    continue;
+                }
+                if(_ggt_platform_uring_complete(&ggt_platform_file_state.requests[cqe->user_data], cqe->user_data, cqe->res))
+                    in_flight--;
+            }
+            GGTP_ATOMIC_STORE(ggt_platform_uring.cq_head, head);
+        }
+        return 0;
+    }
+    
+    int _ggt_platform_start_uring(void){
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int ring = (int)syscall(__NR_io_uring_setup, GGTP_FILE_QUEUE_DEPTH * 2, &params);
+        if(ring < 0)
+            return GGT_FAILURE;
+        // IORING_OP_OPENAT and IORING_OP_READ came with this one (linux 5.6)
+        if(!(params.features & IORING_FEAT_RW_CUR_POS)){
+            close(ring);
+            return GGT_FAILURE;
+        }
+        
+        size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if(single_mmap && cq_size > sq_size)
+            sq_size = cq_size;
+        
+        ggt_u8 *sq = (ggt_u8 *)mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+        ggt_u8 *cq = single_mmap ? sq : (ggt_u8 *)mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+        void *sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+        int eventfd_id = eventfd(0, EFD_CLOEXEC);
+        if(sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED || eventfd_id < 0){
+            close(ring); // Mappings stay until exit, it's a one time thing
+            return GGT_FAILURE;
+        }
+        
+        ggt_platform_uring.ring = ring;
+        ggt_platform_uring.eventfd = eventfd_id;
+        ggt_platform_uring.sq_tail = (unsigned *)(sq + params.sq_off.tail);
+        ggt_platform_uring.sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+        ggt_platform_uring.sq_array = (unsigned *)(sq + params.sq_off.array);
+        ggt_platform_uring.sqes = (struct io_uring_sqe *)sqes;
+        ggt_platform_uring.cq_head = (unsigned *)(cq + params.cq_off.head);
+        ggt_platform_uring.cq_tail = (unsigned *)(cq + params.cq_off.tail);
+        ggt_platform_uring.cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+        ggt_platform_uring.cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+        
+        ggt_platform_uring.thread = ggtp_create_thread(_ggt_platform_uring_thread, NULL, "ggtp_io_uring");
+        if(!ggt_platform_uring.thread){
+            ggt_platform_uring.eventfd = -1;
+            return GGT_FAILURE;
+        }
+        return GGT_SUCCESS;
+    }
+#endif
+    
+    int _ggt_platform_start_file_io(void){
+#ifdef _GGTP_IO_URING
+        if(_ggt_platform_start_uring() == GGT_SUCCESS)
+            return GGT_SUCCESS;
+        // Old kernel or not allowed (e.g. seccomp in containers)
+#endif
+        return _ggt_platform_start_file_threads();
+    }
+    
+#if defined(__unix__) || defined(__APPLE__)
+    const ggt_u8 *_ggt_platform_map_file(const char *path, ggt_u64 *size, void **handle){
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return NULL;
+        struct stat info;
+        void *data = MAP_FAILED;
+        if(fstat(fd, &info) == 0 && info.st_size > 0)
+            data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // The mapping keeps it open
+        if(data == MAP_FAILED)
+            return NULL;
+        *size = (ggt_u64)info.st_size;
+        return (const ggt_u8 *)data;
+    }
+    
+    void _ggt_platform_unmap_file(const ggt_u8 *data, ggt_u64 size, void *handle){
+        munmap((void *)data, (size_t)size);
+    }
+#else
+    const ggt_u8 *_ggt_platform_map_file(const char *path, ggt_u64 *size, void **handle){
+        return _ggt_platform_read_whole_file(path, size);
+    }
+    
+    void _ggt_platform_unmap_file(const ggt_u8 *data, ggt_u64 size, void *handle){
+        free((void *)data);
+    }
+#endif
+    
+    void _ggt_platform_kick_file_io(void){
+#ifdef _GGTP_IO_URING
+        int eventfd_id = GGTP_ATOMIC_LOAD(&ggt_platform_uring.eventfd);
+        if(eventfd_id >= 0){
+            ggt_u64 one = 1;
+            if(write(eventfd_id, &one, sizeof(one)) < 0)
+                printf("ggtp_read_file_async error: Couldn't wake the io_uring thread\n");
+            return;
+        }
 #endif
+        ggtp_semaphore_post(ggt_platform_file_state.work);
+    }
     
+    void _ggt_platform_stop_file_io(void){
+#ifdef _GGTP_IO_URING
+        if(ggt_platform_uring.thread){
+            // The kick wakes the thread up to see the flag
+            GGTP_ATOMIC_STORE(&ggt_platform_file_state.stopping, 1);
+            int eventfd_id = GGTP_ATOMIC_LOAD(&ggt_platform_uring.eventfd);
+            if(eventfd_id >= 0){
+                ggt_u64 one = 1;
+                if(write(eventfd_id, &one, sizeof(one)) < 0)
+                    printf("ggtp_read_file_async error: Couldn't wake the io_uring thread\n");
+            }
+            ggtp_wait_thread(ggt_platform_uring.thread);
+            ggt_platform_uring.thread = 0;
+        }
+#endif
+        _ggt_platform_stop_file_threads();
+    }
     
-    struct {
-        GGTP_PROGRAM_STATE program_state;
-        ggt_u8 keys[GGTP_TOTAL_KEYS];
-        ggt_platform_events events;
-        
-        ggt_vec2i last_mouse_position;
-    } ggt_globals;
+#ifdef GGTP_HOT_RELOAD
+    void *_ggt_platform_load_library(const char *path){
+        void *library = SDL_LoadObject(path);
+        if(!library)
+            printf("Couldn't load %s: %s\n", path, SDL_GetError());
+        return library;
+    }
     
-    EM_JS(int, window_width, (), {
-          return window.innerWidth;
-          });
+    void *_ggt_platform_library_function(void *library, const char *name){
+        return SDL_LoadFunction(library, name);
+    }
     
-    EM_JS(int, window_height, (), {
-          return window.innerHeight;
-          });
+    void _ggt_platform_unload_library(void *library){
+        SDL_UnloadObject(library);
+    }
+#endif
     
-    EM_BOOL key_callback(int eventType, const EmscriptenKeyboardEvent *e, void *userData)
-    {
-        char key = (char)e->keyCode;
-        if(key == 16)
-            key = GGTP_KEY_SHIFT;
-        
-        if(eventType == EMSCRIPTEN_EVENT_KEYUP){
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_KEY_UP, key, key);
-            ggt_globals.keys[key] = 0;
-        }else{
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_KEY_DOWN, key, key);
-            ggt_globals.keys[key] = 1;
-        }
-        
-        return 0;
+    ggt_u64 ggtp_time_microseconds(void){
+        ggt_u64 counter = SDL_GetPerformanceCounter();
+        ggt_u64 frequency = SDL_GetPerformanceFrequency();
+        return (counter / frequency) * 1000000 + (counter % frequency) * 1000000 / frequency;
     }
     
-    EM_BOOL mouse_callback(int eventType, const EmscriptenMouseEvent *e, void *userData){
-        ggt_vec2i position = {e->canvasX, e->canvasY};
-        switch(eventType){
-            case EMSCRIPTEN_EVENT_MOUSEDOWN:
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_DOWN, coords, position);
-            break;
-            case EMSCRIPTEN_EVENT_MOUSEUP:
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_UP, coords, position);
-            break;
-            case EMSCRIPTEN_EVENT_MOUSEMOVE:
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_MOVE, mouse_movement, {position.x, position.y, position.x - ggt_globals.last_mouse_position.x, position.y - ggt_globals.last_mouse_position.y});
-            break;
-        }
-        ggt_globals.last_mouse_position = {e->canvasX, e->canvasY};
-        
-        return 0;
+    ggt_thread ggtp_create_thread(ggt_thread_function *function, void *data, const char *name){
+        return (ggt_thread)SDL_CreateThread(function, name, data);
     }
     
+    int ggtp_wait_thread(ggt_thread thread){
+        int result = 0;
+        SDL_WaitThread((SDL_Thread *)thread, &result);
+        return result;
+    }
     
-    EM_BOOL resize_callback(int eventType, const EmscriptenUiEvent *e, void *userData){
-        if(eventType == EMSCRIPTEN_EVENT_RESIZE){
-            GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_RESIZE, size, {e->windowInnerWidth, e->windowInnerHeight});
-            emscripten_set_canvas_element_size("canvas", e->windowInnerWidth, e->windowInnerHeight);
-        }
-        
-        return 0;
+    void ggtp_sleep_microseconds(ggt_u64 microseconds){
+#if defined(__unix__) || defined(__APPLE__)
+        struct timespec duration;
+        duration.tv_sec = (time_t)(microseconds / 1000000);
+        duration.tv_nsec = (long)(microseconds % 1000000) * 1000;
+        nanosleep(&duration, NULL);
+#else
+        SDL_Delay((Uint32)(microseconds / 1000));
+#endif
     }
     
-    void ggtp_set_cursor(ggt_platform_cursor cursor){
+#if defined(__unix__) || defined(__APPLE__)
+    int _ggt_platform_reserve_memory(ggt_arena *arena, ggt_u64 size, int huge_pages){
+        void *memory = mmap(NULL, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(memory == MAP_FAILED)
+            return GGT_FAILURE;
+#ifdef MADV_HUGEPAGE
+        // Transparent huge pages, the kernel may or may not honour it
+        if(huge_pages)
+            madvise(memory, (size_t)size, MADV_HUGEPAGE);
+#endif
+        arena->base = (ggt_u8 *)memory;
+        arena->reserved = size;
+        arena->committed = 0;
+        return GGT_SUCCESS;
     }
     
-    void main_loop(){
-        GGTP_LOOP(ggt_globals.keys, ggt_globals.events);
-        ggt_globals.events.size = 0;
-        GGTP_DRAW();
+    int _ggt_platform_commit_memory(void *address, ggt_u64 size){
+        return (mprotect(address, (size_t)size, PROT_READ | PROT_WRITE) == 0) ? GGT_SUCCESS : GGT_FAILURE;
     }
     
-    int ggtp_create_window(int width, int height, const char *window_name){
+    void _ggt_platform_release_memory(ggt_arena *arena){
+        munmap(arena->base, (size_t)arena->reserved);
+    }
+#else
+    int _ggt_platform_reserve_memory(ggt_arena *arena, ggt_u64 size, int huge_pages){
+        void *memory = SDL_calloc(1, (size_t)size);
+        if(!memory)
+            return GGT_FAILURE;
+        arena->base = (ggt_u8 *)memory;
+        arena->reserved = arena->committed = size;
         return GGT_SUCCESS;
     }
     
-    int main(void) {
-        emscripten_set_mousedown_callback("#canvas", 0, 1, mouse_callback);
-        emscripten_set_mouseup_callback("#canvas", 0, 1, mouse_callback);
-        emscripten_set_mousemove_callback("#canvas", 0, 1, mouse_callback);
-        emscripten_set_resize_callback("#window", 0, 1, resize_callback);
-        emscripten_set_keydown_callback("#document", 0, 1, key_callback);
-        emscripten_set_keyup_callback("#document", 0, 1, key_callback);
-        
-        int width = window_width();
-        int height = window_height();
-        emscripten_set_canvas_element_size("canvas", width, height);
-        
-        EmscriptenWebGLContextAttributes attrs;
-        emscripten_webgl_init_context_attributes(&attrs);
-        attrs.alpha = 8;
-        attrs.depth = 24;
-        attrs.stencil = 8;
-        attrs.antialias = true;
-        attrs.premultipliedAlpha = false;
-        EMSCRIPTEN_WEBGL_CONTEXT_HANDLE ctx = emscripten_webgl_create_context(NULL, &attrs);
-        if(ctx != NULL)
-            printf("Failed to create WebGL context");
-        emscripten_webgl_make_context_current(ctx);
-        
-        for(int i=0; i<GGTP_TOTAL_KEYS; i++)
-            ggt_globals.keys[i] = 0;
-        ggt_globals.events.size = 0;
-        
-        GGTP_INIT();
-        
-        GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_RESIZE, size, {width, height});
-        
-        emscripten_set_main_loop(main_loop, 0, 1);
-        
-        return 0;
+    int _ggt_platform_commit_memory(void *address, ggt_u64 size){
+        return GGT_SUCCESS;
     }
     
-    void ggtp_program_file_path(const char *name, char *dst){
-        sprintf(dst, "../run_tree/%s", name);
+    void _ggt_platform_release_memory(ggt_arena *arena){
+        SDL_free(arena->base);
     }
-    void ggtp_user_file_path(const char *name, char *dst){
-        sprintf(dst, "../run_tree/%s", name);
+#endif
+    
+    ggt_semaphore ggtp_create_semaphore(ggt_u32 initial_count){
+        return (ggt_semaphore)SDL_CreateSemaphore(initial_count);
     }
     
-    ggt_u64 ggtp_file_modification_date(const char *path){
-        return 0;
+    void ggtp_destroy_semaphore(ggt_semaphore semaphore){
+        SDL_DestroySemaphore((SDL_sem *)semaphore);
     }
     
-#else // linux, etc.
-    //
-    // SDL implementation
-    //
+    void ggtp_semaphore_post(ggt_semaphore semaphore){
+        SDL_SemPost((SDL_sem *)semaphore);
+    }
     
-#include <SDL2/SDL.h>
+    int ggtp_semaphore_wait(ggt_semaphore semaphore, int timeout){
+        int result;
+        if(timeout < 0)
+            result = SDL_SemWait((SDL_sem *)semaphore);
+        else if(timeout == 0)
+            result = SDL_SemTryWait((SDL_sem *)semaphore);
+        else
+            result = SDL_SemWaitTimeout((SDL_sem *)semaphore, (Uint32)timeout);
+        return (result == 0) ? GGT_SUCCESS : GGT_FAILURE;
+    }
     
-#ifdef GGTP_PROGRAM_STATE
-#define GGTP_INIT() ggtp_init(&program_state)
-#define GGTP_LOOP(a, b) ggtp_loop(&program_state, a, b)
-#define GGTP_DRAW() ggtp_draw(&program_state)
+    int ggtp_thread_set_affinity(ggt_u64 core_mask){
+#ifdef __linux__
+        unsigned long mask[8 / sizeof(unsigned long)];
+        for(ggt_u32 i = 0; i < sizeof(mask) / sizeof(mask[0]); i++)
+            mask[i] = (unsigned long)(core_mask >> (i * 8 * sizeof(unsigned long)));
+        return (syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0) ? GGT_SUCCESS : GGT_FAILURE;
 #else
-#define GGTP_INIT() ggtp_init()
-#define GGTP_LOOP(a, b) ggtp_loop(a, b)
-#define GGTP_DRAW() ggtp_draw()
+        return GGT_FAILURE; // macOS only takes affinity hints between threads
+#endif
+    }
+    
+    int ggtp_thread_set_priority(ggt_platform_priority priority){
+        SDL_ThreadPriority value = (priority == GGTP_PRIORITY_LOW) ? SDL_THREAD_PRIORITY_LOW :
+            (priority == GGTP_PRIORITY_HIGH) ? SDL_THREAD_PRIORITY_HIGH : SDL_THREAD_PRIORITY_NORMAL;
+        return (SDL_SetThreadPriority(value) == 0) ? GGT_SUCCESS : GGT_FAILURE;
+    }
+    
+#ifdef GGTP_LOADER_CONTEXT
+    void _ggt_platform_bind_loader_context(void){
+        SDL_GL_MakeCurrent(ggt_globals.window, ggt_globals.loader_context);
+    }
+    
+    void _ggt_platform_release_loader_context(void){
+        SDL_GL_MakeCurrent(ggt_globals.window, NULL);
+    }
 #endif
     
     struct {
-        ggt_platform_events events;
-        ggt_u8 keys[GGTP_TOTAL_KEYS];
-        ggt_vec2i last_mouse_position;
-        
-        SDL_Window *window;
-        SDL_GLContext gl_context;
-    } ggt_globals;
+        SDL_AudioDeviceID device;
+    } ggt_platform_sdl_audio;
     
-    int ggtp_create_window(int width, int height, const char *window_name){
-        if(SDL_Init(SDL_INIT_VIDEO) < 0){
-            printf("Failed to init SDL\n");
-            return GGT_FAILURE;
-        }
-        
-        ggt_globals.window = SDL_CreateWindow(window_name, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
-        
-        if(!ggt_globals.window){
-            printf("Unable to create window\n");
+    void _ggt_platform_audio_callback(void *data, Uint8 *stream, int length){
+        _ggt_platform_mix_audio((float *)stream, (ggt_u32)length / (2 * sizeof(float)));
+    }
+    
+    int _ggt_platform_open_audio(ggt_u32 *sample_rate, ggt_u32 buffer_frames){
+        if(SDL_InitSubSystem(SDL_INIT_AUDIO) < 0){
+            printf("ggtp_audio_start error: SDL_InitSubSystem failed: %s\n", SDL_GetError());
             return GGT_FAILURE;
         }
         
-        ggt_globals.gl_context = SDL_GL_CreateContext(ggt_globals.window);
-        
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
-        
-        SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-        SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-        SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
-        SDL_GL_SetAttribute(SDL_GL_ACCUM_RED_SIZE, 4);
-        SDL_GL_SetAttribute(SDL_GL_ACCUM_GREEN_SIZE, 4);
-        SDL_GL_SetAttribute(SDL_GL_ACCUM_BLUE_SIZE, 4);
-        SDL_GL_SetAttribute(SDL_GL_ACCUM_ALPHA_SIZE, 4);
-        
-        SDL_GL_SetSwapInterval(1);
-        
-        glewExperimental = GL_TRUE;
-        GLenum error = glewInit();
-        if(error != GLEW_OK){
-            printf("Couldn't initialize glew\n");
-            return GGT_FAILURE;
-        }else if(!GLEW_VERSION_2_1){
-            printf("Glew doesn't support openGL 2.1\n");
+        SDL_AudioSpec wanted, obtained;
+        SDL_memset(&wanted, 0, sizeof(wanted));
+        wanted.freq = (int)*sample_rate;
+        wanted.format = AUDIO_F32SYS;
+        wanted.channels = 2;
+        wanted.samples = (Uint16)buffer_frames;
+        wanted.callback = _ggt_platform_audio_callback;
+        ggt_platform_sdl_audio.device = SDL_OpenAudioDevice(NULL, 0, &wanted, &obtained, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+        if(!ggt_platform_sdl_audio.device){
+            printf("ggtp_audio_start error: Couldn't open the audio device: %s\n", SDL_GetError());
             return GGT_FAILURE;
         }
         
+        *sample_rate = (ggt_u32)obtained.freq;
+        SDL_PauseAudioDevice(ggt_platform_sdl_audio.device, 0);
         return GGT_SUCCESS;
     }
     
-    int main(){
-#ifdef GGTP_PROGRAM_STATE
-        //GGTP_PROGRAM_STATE* program_state = (GGTP_PROGRAM_STATE *)malloc(sizeof(GGTP_PROGRAM_STATE));
-        GGTP_PROGRAM_STATE program_state;
-#endif
-        
-        if(GGTP_INIT() == GGT_FAILURE){
-            return GGT_C_FAILURE;
+    void _ggt_platform_close_audio(void){
+        SDL_CloseAudioDevice(ggt_platform_sdl_audio.device);
+        ggt_platform_sdl_audio.device = 0;
+    }
+    
+#ifdef __linux__
+    // Reads a number from sysfs, with the K/M suffix of cache sizes applied
+    ggt_u32 _ggt_platform_read_sysfs_number(const char *path){
+        FILE *file = fopen(path, "r");
+        if(!file)
+            return 0;
+        unsigned int value = 0;
+        char suffix = 0;
+        int read = fscanf(file, "%u%c", &value, &suffix);
+        fclose(file);
+        if(read < 1)
+            return 0;
+        if(suffix == 'K')
+            value *= 1024;
+        else if(suffix == 'M')
+            value *= 1024 * 1024;
+        return value;
+    }
+    
+    // Counts the cpus or nodes in a list like "0-3,8-11"
+    ggt_u32 _ggt_platform_read_sysfs_count(const char *path){
+        FILE *file = fopen(path, "r");
+        if(!file)
+            return 0;
+        ggt_u32 count = 0;
+        unsigned int first, last;
+        while(fscanf(file, "%u", &first) == 1){
+            last = first;
+            int separator = fgetc(file);
+            if(separator == '-'){
+                if(fscanf(file, "%u", &last) != 1)
+                    break;
+                separator = fgetc(file);
+            }
+            count += (last >= first) ? last - first + 1 : 0;
+            if(separator != ',')
+                break;
         }
+        fclose(file);
+        return count;
+    }
+#endif
+    
+    void _ggt_platform_detect_topology(ggt_system_info *info){
+        info->logical_cores = (ggt_u32)SDL_GetCPUCount();
+        int line_size = SDL_GetCPUCacheLineSize();
+        if(line_size > 0)
+            info->cache_line_size = (ggt_u32)line_size;
         
-        if(!ggt_globals.window){
-            printf("Window was not created in ggtp_init().\n");
-            return GGT_C_FAILURE;
-        }
+#ifdef __linux__
+        char path[_GGTP_PATH_SIZE];
         
-        for(int i=0; i<GGTP_TOTAL_KEYS; i++) {
-            ggt_globals.keys[i] = 0;
+        // A core is a distinct (package, core id) pair
+        ggt_u32 cpu_count = (ggt_u32)sysconf(_SC_NPROCESSORS_CONF);
+        ggt_u32 cores[1024];
+        ggt_u32 core_count = 0;
+        for(ggt_u32 cpu = 0; cpu < cpu_count; cpu++){
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/core_id", cpu);
+            FILE *file = fopen(path, "r"); // Offline cpus have no topology
+            if(!file)
+                continue;
+            fclose(file);
+            ggt_u32 core_id = _ggt_platform_read_sysfs_number(path);
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+            ggt_u32 core = (_ggt_platform_read_sysfs_number(path) << 16) | core_id;
+            
+            ggt_u32 i = 0;
+            while(i < core_count && cores[i] != core)
+                i++;
+            if(i == core_count && core_count < sizeof(cores) / sizeof(cores[0]))
+                cores[core_count++] = core;
         }
-        ggt_globals.events.size = 0;
+        info->physical_cores = core_count;
         
-        while(1){
+        for(ggt_u32 index = 0; index < 16; index++){
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/type", index);
+            FILE *file = fopen(path, "r");
+            if(!file)
+                break;
+            char type[32] = {0};
+            int read = fscanf(file, "%31s", type);
+            fclose(file);
+            if(read != 1 || !strcmp(type, "Instruction"))
+                continue;
             
-            SDL_Event e;
-            while(SDL_PollEvent(&e)){
-                switch(e.type){
-                    case SDL_KEYDOWN: {
-                        //e.key.keysym.scancode;
-                    }   break;
-                    
-                    case SDL_KEYUP: {
-                    }   break;
-                    
-                    case SDL_MOUSEBUTTONDOWN:
-                    if(e.button.button == SDL_BUTTON_LEFT)
-                        GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_UP, coords, {e.button.x, e.button.y});
-                    else if(e.button.button == SDL_BUTTON_RIGHT)
-                        GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_RIGHT_DOWN, coords, {e.button.x, e.button.y});
-                    break;
-                    
-                    case SDL_MOUSEBUTTONUP:
-                    if(e.button.button == SDL_BUTTON_LEFT)
-                        GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_LEFT_UP, coords, {e.button.x, e.button.y});
-                    else if(e.button.button == SDL_BUTTON_RIGHT)
-                        GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_RIGHT_UP, coords, {e.button.x, e.button.y});
-                    break;
-                    
-                    case SDL_MOUSEMOTION:
-                    GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_MOUSE_MOVE, mouse_movement, {{e.button.x, e.button.y}, {e.motion.xrel, e.motion.yrel}});
-                    break;
-                    
-                    case SDL_WINDOWEVENT:
-                    switch(e.window.event){
-                        case SDL_WINDOWEVENT_RESIZED:
-                        GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_RESIZE, size, {e.window.data1, e.window.data2});
-                        break;
-                        
-                        case SDL_WINDOWEVENT_CLOSE:
-                        GGT_PLATFORM_ADD_EVENT(GGTP_EVENT_CLOSE, key, 0);
-                        break;
-                        
-                        //case SDL_WINDOWEVENT_FOCUS_LOST:
-                        //
-                        //break;
-                    }
-                    break;
-                    
-                    default:
-                    break;
-                }
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/level", index);
+            ggt_u32 level = _ggt_platform_read_sysfs_number(path);
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/size", index);
+            ggt_u32 size = _ggt_platform_read_sysfs_number(path);
+            if(level == 1){
+                info->l1_cache_size = size;
+                snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/coherency_line_size", index);
+                ggt_u32 line = _ggt_platform_read_sysfs_number(path);
+                if(line)
+                    info->cache_line_size = line;
+            }else if(level == 2){
+                info->l2_cache_size = size;
+            }else if(level == 3){
+                info->l3_cache_size = size;
             }
+        }
+        
+        info->numa_nodes = _ggt_platform_read_sysfs_count("/sys/devices/system/node/online");
+#endif
+    }
+    
+#endif
+    
+#if defined(GGTP_RENDER_THREAD) && !defined(__EMSCRIPTEN__)
+    int _ggt_platform_simulation_thread(void *data){
+        const ggt_u64 tick = 1000000 / GGTP_SIMULATION_HZ;
+        ggt_u64 next_tick = ggtp_time_microseconds();
+        
+        ggt_platform_events events;
+        while(GGTP_ATOMIC_LOAD(&ggt_globals.running)){
+            _ggt_platform_drain_event_ring(&ggt_globals.event_ring, &events, ggt_globals.keys);
             
+            int result = GGTP_LOOP(ggt_globals.keys, events);
+            if(result == GGT_FAILURE)
+                break;
             
-            ggt_platform_events events;
-            events.size = ggt_globals.events.size;
-            for(ggt_u32 i=0; i<events.size; i++)
-                events.data[i] = ggt_globals.events.data[i];
-            ggt_globals.events.size = 0;
+            int idle = (result == GGTP_NO_REDRAW && !GGTP_ATOMIC_LOAD(&ggt_platform_redraw_state.requested));
+            if(!idle){
+                _ggt_platform_publish_snapshot(&ggt_globals.snapshots, ggt_globals.program_state);
+                _ggt_platform_wake();
+            }
+            // Once the snapshot is taken nothing refers to this tick's frame memory
+            GGT_PLATFORM_RESET_FRAME_MEMORY();
             
-            if(GGTP_LOOP(ggt_globals.keys, events) == GGT_FAILURE){
-                // Exit the program
-                SDL_GL_DeleteContext(ggt_globals.gl_context);
-                SDL_DestroyWindow(ggt_globals.window);
-                SDL_Quit();
-                return GGT_C_SUCCESS;
+            if(idle){
+                // Nothing changed, sleep until there is input or a redraw is due
+                while(ggtp_semaphore_wait(_ggt_platform_simulation_semaphore, 0) == GGT_SUCCESS);
+                if(_ggt_platform_ring_empty(&ggt_globals.event_ring)){
+                    int timeout = _ggt_platform_redraw_timeout();
+                    if(timeout != 0)
+                        ggtp_semaphore_wait(_ggt_platform_simulation_semaphore, timeout);
+                    next_tick = ggtp_time_microseconds();
+                    continue;
+                }
             }
             
-            GGTP_DRAW();
-            SDL_GL_SwapWindow(ggt_globals.window);
+            next_tick += tick;
+            ggt_u64 now = ggtp_time_microseconds();
+            if(now < next_tick)
+                ggtp_sleep_microseconds(next_tick - now);
+            else if(now - next_tick > tick)
+                next_tick = now; // Too far behind, don't try to catch up
         }
         
-        return GGT_C_SUCCESS;
-    }
-    
-    void ggtp_set_cursor(ggt_platform_cursor cursor_id){
-        
-    }
-    
-    
-    void ggtp_program_file_path(const char *name, char *dst){
-        sprintf(dst, "../run_tree/%s", name);
-    }
-    void ggtp_user_file_path(const char *name, char *dst){
-        sprintf(dst, "../run_tree/%s", name);
-    }
-    
-    ggt_u64 ggtp_file_modification_date(const char *path){
+        _ggt_platform_stop();
         return 0;
     }
-    
 #endif
     
 #undef ggt_globals
@@ -0,0 +1,330 @@
+//
+// GGT PACKER
+//
+// Builds a pack (see ggtp_pack_open in ggt_platform.h) out of every file in a
+// directory, named by their path relative to it.
+//
+// Usage:
+//  ggt_packer [-lz4 | -zstd] [-level N] output.pack directory
+//
+// Compression needs the library, e.g. for linux:
+//  gcc ggt_packer.c -o ggt_packer
+//  gcc ggt_packer.c -o ggt_packer -DGGT_PACKER_LZ4 -llz4
+//  gcc ggt_packer.c -o ggt_packer -DGGT_PACKER_ZSTD -lzstd
+// Entries that don't shrink by at least 10% are stored as they are.
+//
+
+// 64-bit off_t for fseeko/ftello on 32-bit systems
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef GGT_PACKER_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+#ifdef GGT_PACKER_ZSTD
+#include <zstd.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#define file_seek _fseeki64
+#define file_tell _ftelli64
+#else
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#define file_seek fseeko
+#define file_tell ftello
+#endif
+
+#define GGTP_NO_GL
+#include "../ggt_platform.h"
+
+typedef struct {
+    char **names;
+    ggt_u32 count, capacity;
+} file_list;
+
+void add_file(file_list *list, const char *name){
+    if(list->count == list->capacity){
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->names = (char **)realloc(list->names, list->capacity * sizeof(char *));
+    }
+    list->names[list->count] = (char *)malloc(strlen(name) + 1);
+    strcpy(list->names[list->count], name);
+    list->count++;
+}
+
+// Absolute path to compare files by, empty if it can't be found
+void full_path(const char *path, char *result, size_t size){
+#ifdef _WIN32
+    if(!GetFullPathNameA(path, (DWORD)size, result, NULL))
+        result[0] = 0;
+#else
+    char resolved[PATH_MAX];
+    if(realpath(path, resolved))
+        snprintf(result, size, "%s", resolved);
+    else
+        result[0] = 0;
+#endif
+}
+
+int same_path(const char *a, const char *b){
+#ifdef _WIN32
+    return a[0] && !_stricmp(a, b);
+#else
+    return a[0] && !strcmp(a, b);
+#endif
+}
+
+// relative is "" for the root, otherwise ends with '/'. skip is the full
+// path of the pack being written, which may be inside the directory
+void list_files(file_list *list, const char *root, const char *relative, const char *skip){
+    char path[1024], child[1024], full[2048], absolute[2048];
+    snprintf(path, sizeof(path), "%s/%s", root, relative);
+
+#ifdef _WIN32
+    char pattern[1024];
+    snprintf(pattern, sizeof(pattern), "%s*", path);
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA(pattern, &data);
+    if(find == INVALID_HANDLE_VALUE)
+        return;
+    do{
+        if(!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, ".."))
+            continue;
+        if(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY){
+            snprintf(child, sizeof(child), "%s%s/", relative, data.cFileName);
+            list_files(list, root, child, skip);
+        }else{
+            snprintf(full, sizeof(full), "%s%s", path, data.cFileName);
+            full_path(full, absolute, sizeof(absolute));
+            if(same_path(absolute, skip))
+                continue;
+            snprintf(child, sizeof(child), "%s%s", relative, data.cFileName);
+            add_file(list, child);
+        }
+    }while(FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR *dir = opendir(path);
+    if(!dir)
+        return;
+    struct dirent *entry;
+    while((entry = readdir(dir))){
+        if(!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
+        snprintf(full, sizeof(full), "%s%s", path, entry->d_name);
+        struct stat info;
+        if(stat(full, &info) != 0)
+            continue;
+        if(S_ISDIR(info.st_mode)){
+            snprintf(child, sizeof(child), "%s%s/", relative, entry->d_name);
+            list_files(list, root, child, skip);
+        }else if(S_ISREG(info.st_mode)){
+            full_path(full, absolute, sizeof(absolute));
+            if(same_path(absolute, skip))
+                continue;
+            snprintf(child, sizeof(child), "%s%s", relative, entry->d_name);
+            add_file(list, child);
+        }
+    }
+    closedir(dir);
+#endif
+}
+
+int compare_names(const void *a, const void *b){
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+ggt_u8 *read_file(const char *path, ggt_u64 *size){
+    FILE *file = fopen(path, "rb");
+    if(!file)
+        return NULL;
+    file_seek(file, 0, SEEK_END);
+    long long length = (long long)file_tell(file);
+    file_seek(file, 0, SEEK_SET);
+    ggt_u8 *data = (length >= 0) ? (ggt_u8 *)malloc(length > 0 ? (size_t)length : 1) : NULL;
+    if(data && fread(data, 1, (size_t)length, file) != (size_t)length){
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = (ggt_u64)length;
+    return data;
+}
+
+// Returns the compressed size, or 0 to store the data as it is
+ggt_u64 compress_data(ggt_pack_compression compression, int level, const ggt_u8 *data, ggt_u64 size, ggt_u8 **compressed){
+    (void)level; // Unused without any compression library
+    (void)data;
+    *compressed = NULL;
+    ggt_u64 result = 0;
+    switch(compression){
+#ifdef GGT_PACKER_LZ4
+        case GGTP_PACK_LZ4: {
+            if(size > LZ4_MAX_INPUT_SIZE)
+                return 0;
+            int bound = LZ4_compressBound((int)size);
+            *compressed = (ggt_u8 *)malloc(bound);
+            result = (ggt_u64)LZ4_compress_HC((const char *)data, (char *)*compressed, (int)size, bound, level ? level : LZ4HC_CLEVEL_DEFAULT);
+        } break;
+#endif
+#ifdef GGT_PACKER_ZSTD
+        case GGTP_PACK_ZSTD: {
+            size_t bound = ZSTD_compressBound((size_t)size);
+            *compressed = (ggt_u8 *)malloc(bound);
+            size_t written = ZSTD_compress(*compressed, bound, data, (size_t)size, level ? level : 19);
+            result = ZSTD_isError(written) ? 0 : (ggt_u64)written;
+        } break;
+#endif
+        default: {
+        } break;
+    }
+
+    if(result == 0 || result > size - size / 10){
+        free(*compressed);
+        *compressed = NULL;
+        return 0;
+    }
+    return result;
+}
+
+void write_padding(FILE *file, ggt_u64 alignment){
+    static const ggt_u8 zeros[GGTP_PACK_ALIGNMENT] = {0};
+    long long position = (long long)file_tell(file);
+    ggt_u64 padding = (alignment - (ggt_u64)position % alignment) % alignment;
+    fwrite(zeros, 1, (size_t)padding, file);
+}
+
+int main(int argc, char **argv){
+    ggt_pack_compression compression = GGTP_PACK_NONE;
+    int level = 0;
+    const char *output = NULL, *directory = NULL;
+
+    for(int i = 1; i < argc; i++){
+        if(!strcmp(argv[i], "-lz4")){
+            compression = GGTP_PACK_LZ4;
+        }else if(!strcmp(argv[i], "-zstd")){
+            compression = GGTP_PACK_ZSTD;
+        }else if(!strcmp(argv[i], "-level") && i + 1 < argc){
+            level = atoi(argv[++i]);
+        }else if(!output){
+            output = argv[i];
+        }else if(!directory){
+            directory = argv[i];
+        }
+    }
+
+    if(!output || !directory){
+        printf("Usage: %s [-lz4 | -zstd] [-level N] output.pack directory\n", argv[0]);
+        return 1;
+    }
+#ifndef GGT_PACKER_LZ4
+    if(compression == GGTP_PACK_LZ4){
+        printf("LZ4 support wasn't compiled in (GGT_PACKER_LZ4)\n");
+        return 1;
+    }
+#endif
+#ifndef GGT_PACKER_ZSTD
+    if(compression == GGTP_PACK_ZSTD){
+        printf("Zstd support wasn't compiled in (GGT_PACKER_ZSTD)\n");
+        return 1;
+    }
+#endif
+
+    // Created first, so that it can be left out if it is inside the directory
+    FILE *file = fopen(output, "wb");
+    if(!file){
+        printf("Couldn't create %s\n", output);
+        return 1;
+    }
+    char output_path[2048];
+    full_path(output, output_path, sizeof(output_path));
+
+    file_list files = {NULL, 0, 0};
+    list_files(&files, directory, "", output_path);
+    if(files.count)
+        qsort(files.names, files.count, sizeof(char *), compare_names);
+
+    // Layout: header, entries, slots, names, then the aligned data
+    ggt_pack_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = GGTP_PACK_MAGIC;
+    header.version = GGTP_PACK_VERSION;
+    header.entry_count = files.count;
+    header.slot_count = 1;
+    while(header.slot_count < files.count * 2)
+        header.slot_count *= 2;
+    header.entries_offset = sizeof(ggt_pack_header);
+    header.slots_offset = header.entries_offset + (ggt_u64)files.count * sizeof(ggt_pack_entry);
+    header.names_offset = header.slots_offset + (ggt_u64)header.slot_count * sizeof(ggt_u32);
+
+    ggt_pack_entry *entries = (ggt_pack_entry *)calloc(files.count ? files.count : 1, sizeof(ggt_pack_entry));
+    ggt_u32 *slots = (ggt_u32 *)calloc(header.slot_count, sizeof(ggt_u32));
+    ggt_u32 names_size = 0;
+    for(ggt_u32 i = 0; i < files.count; i++){
+        ggt_u32 length = (ggt_u32)strlen(files.names[i]);
+        entries[i].hash = ggtp_pack_hash(files.names[i], length);
+        entries[i].name_offset = names_size;
+        entries[i].name_length = length;
+        names_size += length;
+
+        // Linear probing, same as ggtp_pack_find
+        ggt_u32 mask = header.slot_count - 1;
+        ggt_u32 probe = 0;
+        while(slots[(ggt_u32)(entries[i].hash + probe) & mask])
+            probe++;
+        slots[(ggt_u32)(entries[i].hash + probe) & mask] = i + 1;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(entries, sizeof(ggt_pack_entry), files.count, file); // Rewritten at the end with the offsets
+    fwrite(slots, sizeof(ggt_u32), header.slot_count, file);
+    for(ggt_u32 i = 0; i < files.count; i++)
+        fwrite(files.names[i], 1, entries[i].name_length, file);
+
+    ggt_u64 total_size = 0, total_stored = 0;
+    for(ggt_u32 i = 0; i < files.count; i++){
+        char path[2048];
+        snprintf(path, sizeof(path), "%s/%s", directory, files.names[i]);
+        ggt_u64 size;
+        ggt_u8 *data = read_file(path, &size);
+        if(!data){
+            printf("Couldn't read %s\n", path);
+            fclose(file);
+            return 1;
+        }
+
+        ggt_u8 *compressed;
+        ggt_u64 compressed_size = compress_data(compression, level, data, size, &compressed);
+
+        write_padding(file, GGTP_PACK_ALIGNMENT);
+        entries[i].offset = (ggt_u64)file_tell(file);
+        entries[i].size = size;
+        if(compressed_size){
+            entries[i].compression = compression;
+            entries[i].stored_size = compressed_size;
+            fwrite(compressed, 1, (size_t)compressed_size, file);
+        }else{
+            entries[i].compression = GGTP_PACK_NONE;
+            entries[i].stored_size = size;
+            fwrite(data, 1, (size_t)size, file);
+        }
+        total_size += size;
+        total_stored += entries[i].stored_size;
+        free(compressed);
+        free(data);
+    }
+
+    file_seek(file, (long long)header.entries_offset, SEEK_SET);
+    fwrite(entries, sizeof(ggt_pack_entry), files.count, file);
+    fclose(file);
+
+    printf("Packed %u files into %s (%llu bytes, %llu stored)\n", files.count, output, total_size, total_stored);
+    return 0;
+}